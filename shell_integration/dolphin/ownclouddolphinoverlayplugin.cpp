@@ -22,7 +22,9 @@
 #include <QtNetwork/QLocalSocket>
 #include <KFileItem>
 #include <QDir>
+#include <QSet>
 #include <QTimer>
+#include <QVersionNumber>
 #include "ownclouddolphinpluginhelper.h"
 
 class OwncloudDolphinPlugin : public KOverlayIconPlugin
@@ -32,6 +34,8 @@ class OwncloudDolphinPlugin : public KOverlayIconPlugin
 
     using StatusMap = QHash<QByteArray, QByteArray>;
     StatusMap m_status;
+    // Directories whose entries were requested at once, pushes keep them up to date afterwards
+    QSet<QByteArray> m_requestedDirectories;
 
 public:
 
@@ -50,9 +54,19 @@ public:
         QDir localPath(url.toLocalFile());
         const QByteArray localFile = localPath.canonicalPath().toUtf8();
 
-        helper->sendCommand(QByteArray("RETRIEVE_FILE_STATUS:" + localFile + "\n").constData());
-
         StatusMap::iterator it = m_status.find(localFile);
+        if (supportsDirectoryStatus()) {
+            const QByteArray directory = localFile.left(localFile.lastIndexOf('/'));
+            if (!m_requestedDirectories.contains(directory)) {
+                m_requestedDirectories.insert(directory);
+                helper->sendCommand(QByteArray("RETRIEVE_DIRECTORY_STATUS:" + directory + "\n").constData());
+            } else if (it == m_status.end()) {
+                helper->sendCommand(QByteArray("RETRIEVE_FILE_STATUS:" + localFile + "\n").constData());
+            }
+        } else {
+            helper->sendCommand(QByteArray("RETRIEVE_FILE_STATUS:" + localFile + "\n").constData());
+        }
+
         if (it != m_status.constEnd()) {
             return  overlaysForString(*it);
         }
@@ -60,6 +74,12 @@ public:
     }
 
 private:
+    static bool supportsDirectoryStatus()
+    {
+        const auto version = QVersionNumber::fromString(QString::fromUtf8(OwncloudDolphinPluginHelper::instance()->version()));
+        return version >= QVersionNumber(1, 2);
+    }
+
     QStringList overlaysForString(const QByteArray &status) {
         QStringList r;
         if (status.startsWith("NOP"))
@@ -82,6 +102,12 @@ private:
 
     void slotCommandRecieved(const QByteArray &line) {
 
+        if (line.startsWith("VERSION:")) {
+            // New connection, the client doesn't know which directories we look at
+            m_requestedDirectories.clear();
+            return;
+        }
+
         QList<QByteArray> tokens = line.split(':');
         if (tokens.count() < 3)
             return;
@@ -18,10 +18,17 @@
 #include <QCryptographicHash>
 #include <QFile>
 #include <QLoggingCategory>
+#include <QtConcurrentMap>
+
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
 
 namespace
 {
-constexpr qint64 bufSize = 500 * 1024;
+constexpr qint64 bufSize = 1024 * 1024;
 }
 
 namespace OCC {
@@ -48,21 +55,14 @@ static QCryptographicHash::Algorithm algorithmTypeToQCryptoHashAlgorithm(Checksu
 }
 
 ChecksumCalculator::ChecksumCalculator(const QString &filePath, const QByteArray &checksumTypeName)
-    : _device(new QFile(filePath))
+    : ChecksumCalculator(filePath, QList<QByteArray>{checksumTypeName})
 {
-    if (checksumTypeName == checkSumMD5C) {
-        _algorithmType = AlgorithmType::MD5;
-    } else if (checksumTypeName == checkSumSHA1C) {
-        _algorithmType = AlgorithmType::SHA1;
-    } else if (checksumTypeName == checkSumSHA2C) {
-        _algorithmType = AlgorithmType::SHA256;
-    } else if (checksumTypeName == checkSumSHA3C) {
-        _algorithmType = AlgorithmType::SHA3_256;
-    } else if (checksumTypeName == checkSumAdlerC) {
-        _algorithmType = AlgorithmType::Adler32;
-    }
+}
 
-    initChecksumAlgorithm();
+ChecksumCalculator::ChecksumCalculator(const QString &filePath, const QList<QByteArray> &checksumTypeNames)
+    : _device(new QFile(filePath))
+{
+    initChecksumAlgorithms(checksumTypeNames);
 }
 
 ChecksumCalculator::~ChecksumCalculator()
@@ -73,12 +73,34 @@ ChecksumCalculator::~ChecksumCalculator()
     }
 }
 
+ChecksumCalculator::AlgorithmType ChecksumCalculator::algorithmTypeFromName(const QByteArray &checksumTypeName)
+{
+    if (checksumTypeName == checkSumMD5C) {
+        return AlgorithmType::MD5;
+    } else if (checksumTypeName == checkSumSHA1C) {
+        return AlgorithmType::SHA1;
+    } else if (checksumTypeName == checkSumSHA2C) {
+        return AlgorithmType::SHA256;
+    } else if (checksumTypeName == checkSumSHA3C) {
+        return AlgorithmType::SHA3_256;
+    } else if (checksumTypeName == checkSumAdlerC) {
+        return AlgorithmType::Adler32;
+    }
+    return AlgorithmType::Undefined;
+}
+
 QByteArray ChecksumCalculator::calculate()
 {
-    QByteArray result;
+    const auto results = calculateAll();
+    return results.isEmpty() ? QByteArray() : results.first();
+}
+
+QList<QByteArray> ChecksumCalculator::calculateAll()
+{
+    QList<QByteArray> results;
 
     if (!_isInitialized) {
-        return result;
+        return results;
     }
 
     Q_ASSERT(!_device->isOpen());
@@ -86,30 +108,34 @@ QByteArray ChecksumCalculator::calculate()
         qCWarning(lcChecksumCalculator) << "Device already open. Ignoring.";
     }
 
-    if (!_device->isOpen() && !_device->open(QIODevice::ReadOnly)) {
+    // The buffer below is big enough, QIODevice's own buffering would only add a copy
+    if (!_device->isOpen() && !_device->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
         if (auto file = qobject_cast<QFile *>(_device.data())) {
             qCWarning(lcChecksumCalculator) << "Could not open file" << file->fileName() << "for reading to compute a checksum" << file->errorString();
         } else {
             qCWarning(lcChecksumCalculator) << "Could not open device" << _device.data() << "for reading to compute a checksum" << _device->errorString();
         }
-        return result;
+        return results;
+    }
+
+#ifdef Q_OS_LINUX
+    if (auto file = qobject_cast<QFile *>(_device.data()); file && file->handle() != -1) {
+        posix_fadvise(file->handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
     }
+#endif
 
+    // Read into the same buffer over and over, large files would otherwise allocate once per chunk
+    QByteArray buf(bufSize, Qt::Uninitialized);
     for (;;) {
         QMutexLocker locker(&_deviceMutex);
         if (!_device->isOpen() || _device->atEnd()) {
             break;
         }
-        const auto toRead = qMin(_device->bytesAvailable(), bufSize);
-        if (toRead <= 0) {
-            break;
-        }
-        QByteArray buf(toRead, Qt::Uninitialized);
-        const auto sizeRead = _device->read(buf.data(), toRead);
+        const auto sizeRead = _device->read(buf.data(), bufSize);
         if (sizeRead <= 0) {
             break;
         }
-        if (!addChunk(buf, sizeRead)) {
+        if (!addChunk(buf.constData(), sizeRead)) {
             break;
         }
     }
@@ -117,16 +143,16 @@ QByteArray ChecksumCalculator::calculate()
     {
         QMutexLocker locker(&_deviceMutex);
         if (!_device->isOpen()) {
-            return result;
+            return results;
         }
     }
 
-    if (_algorithmType == AlgorithmType::Adler32) {
-        result = QByteArray::number(_adlerHash, 16);
-    } else {
-        Q_ASSERT(_cryptographicHash);
-        if (_cryptographicHash) {
-            result = _cryptographicHash->result().toHex();
+    for (const auto &algorithm : _algorithms) {
+        if (algorithm.type == AlgorithmType::Adler32) {
+            results.append(QByteArray::number(algorithm.adlerHash, 16));
+        } else {
+            Q_ASSERT(algorithm.cryptographicHash);
+            results.append(algorithm.cryptographicHash ? algorithm.cryptographicHash->result().toHex() : QByteArray());
         }
     }
 
@@ -137,40 +163,63 @@ QByteArray ChecksumCalculator::calculate()
         }
     }
 
-    return result;
+    return results;
 }
 
-void ChecksumCalculator::initChecksumAlgorithm()
+void ChecksumCalculator::initChecksumAlgorithms(const QList<QByteArray> &checksumTypeNames)
 {
-    if (_algorithmType == AlgorithmType::Undefined) {
-        qCWarning(lcChecksumCalculator) << "_algorithmType is Undefined, impossible to init Checksum Algorithm";
-        return;
+    _algorithms.reserve(checksumTypeNames.size());
+    for (const auto &checksumTypeName : checksumTypeNames) {
+        Algorithm algorithm;
+        algorithm.type = algorithmTypeFromName(checksumTypeName);
+        if (algorithm.type == AlgorithmType::Undefined) {
+            qCWarning(lcChecksumCalculator) << "Unknown checksum type" << checksumTypeName << ", impossible to init Checksum Algorithm";
+            _algorithms.clear();
+            return;
+        }
+
+        if (algorithm.type == AlgorithmType::Adler32) {
+            algorithm.adlerHash = adler32(0L, Z_NULL, 0);
+        } else {
+            algorithm.cryptographicHash = std::make_unique<QCryptographicHash>(algorithmTypeToQCryptoHashAlgorithm(algorithm.type));
+        }
+        _algorithms.push_back(std::move(algorithm));
     }
 
-    if (_algorithmType == AlgorithmType::Adler32) {
-        _adlerHash = adler32(0L, Z_NULL, 0);
-    } else {
-        _cryptographicHash.reset(new QCryptographicHash(algorithmTypeToQCryptoHashAlgorithm(_algorithmType)));
+    _isInitialized = !_algorithms.empty();
+}
+
+bool ChecksumCalculator::addChunk(const char *data, const qint64 size)
+{
+    if (_algorithms.size() == 1) {
+        return addChunk(_algorithms.front(), data, size);
     }
 
-    _isInitialized = true;
+    // The chunk is read only, so every algorithm can hash it on its own core
+    std::atomic<bool> success = true;
+    QtConcurrent::blockingMap(_algorithms, [&](Algorithm &algorithm) {
+        if (!addChunk(algorithm, data, size)) {
+            success = false;
+        }
+    });
+    return success;
 }
 
-bool ChecksumCalculator::addChunk(const QByteArray &chunk, const qint64 size)
+bool ChecksumCalculator::addChunk(Algorithm &algorithm, const char *data, const qint64 size)
 {
-    Q_ASSERT(_algorithmType != AlgorithmType::Undefined);
-    if (_algorithmType == AlgorithmType::Undefined) {
+    Q_ASSERT(algorithm.type != AlgorithmType::Undefined);
+    if (algorithm.type == AlgorithmType::Undefined) {
         qCWarning(lcChecksumCalculator) << "_algorithmType is Undefined, impossible to add a chunk!";
         return false;
     }
 
-    if (_algorithmType == AlgorithmType::Adler32) {
-        _adlerHash = adler32(_adlerHash, (const Bytef *)chunk.data(), size);
+    if (algorithm.type == AlgorithmType::Adler32) {
+        algorithm.adlerHash = adler32(algorithm.adlerHash, reinterpret_cast<const Bytef *>(data), static_cast<uInt>(size));
         return true;
     } else {
-        Q_ASSERT(_cryptographicHash);
-        if (_cryptographicHash) {
-            _cryptographicHash->addData(chunk);
+        Q_ASSERT(algorithm.cryptographicHash);
+        if (algorithm.cryptographicHash) {
+            algorithm.cryptographicHash->addData(QByteArrayView(data, size));
             return true;
         }
     }
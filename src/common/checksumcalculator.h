@@ -24,6 +24,9 @@
 #include <QMutex>
 #include <QScopedPointer>
 
+#include <memory>
+#include <vector>
+
 class QCryptographicHash;
 
 namespace OCC {
@@ -42,17 +45,35 @@ public:
     };
 
     ChecksumCalculator(const QString &filePath, const QByteArray &checksumTypeName);
+    /**
+     * Computes several checksums in one pass over the file.
+     *
+     * All types must be known, otherwise nothing gets calculated.
+     */
+    ChecksumCalculator(const QString &filePath, const QList<QByteArray> &checksumTypeNames);
     ~ChecksumCalculator();
+
+    /// Returns the checksum of the first requested type
     [[nodiscard]] QByteArray calculate();
 
+    /// Returns the checksums in the order of the requested types, empty on failure
+    [[nodiscard]] QList<QByteArray> calculateAll();
+
+    [[nodiscard]] static AlgorithmType algorithmTypeFromName(const QByteArray &checksumTypeName);
+
 private:
-    void initChecksumAlgorithm();
-    bool addChunk(const QByteArray &chunk, const qint64 size);
+    struct Algorithm {
+        AlgorithmType type = AlgorithmType::Undefined;
+        std::unique_ptr<QCryptographicHash> cryptographicHash;
+        unsigned int adlerHash = 0;
+    };
+
+    void initChecksumAlgorithms(const QList<QByteArray> &checksumTypeNames);
+    bool addChunk(const char *data, const qint64 size);
+    static bool addChunk(Algorithm &algorithm, const char *data, const qint64 size);
     QScopedPointer<QIODevice> _device;
-    QScopedPointer<QCryptographicHash> _cryptographicHash;
-    unsigned int _adlerHash = 0;
+    std::vector<Algorithm> _algorithms;
     bool _isInitialized = false;
-    AlgorithmType _algorithmType = AlgorithmType::Undefined;
     QMutex _deviceMutex;
 };
 }
@@ -199,9 +199,19 @@ QByteArray ComputeChecksum::checksumType() const
     return _checksumType;
 }
 
+void ComputeChecksum::setAdditionalChecksumTypes(const QList<QByteArray> &types)
+{
+    _additionalChecksumTypes = types;
+}
+
+QByteArray ComputeChecksum::checksum(const QByteArray &type) const
+{
+    return _checksums.value(type);
+}
+
 void ComputeChecksum::start(const QString &filePath)
 {
-    qCInfo(lcChecksums) << "Computing" << checksumType() << "checksum of" << filePath << "in a thread";
+    qCInfo(lcChecksums) << "Computing" << checksumType() << _additionalChecksumTypes << "checksum of" << filePath << "in a thread";
     startImpl(filePath);
 }
 
@@ -211,9 +221,9 @@ void ComputeChecksum::startImpl(const QString &filePath)
         this, &ComputeChecksum::slotCalculationDone,
         Qt::UniqueConnection);
 
-    _checksumCalculator.reset(new ChecksumCalculator(filePath, _checksumType));
+    _checksumCalculator.reset(new ChecksumCalculator(filePath, QList<QByteArray>{_checksumType} + _additionalChecksumTypes));
     _watcher.setFuture(QtConcurrent::run([this]() {
-        return _checksumCalculator->calculate();
+        return _checksumCalculator->calculateAll();
     }));
 }
 
@@ -235,7 +245,13 @@ QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray
 
 void ComputeChecksum::slotCalculationDone()
 {
-    QByteArray checksum = _watcher.future().result();
+    const auto checksums = _watcher.future().result();
+    _checksums.clear();
+    for (int i = 0; i < checksums.size(); ++i) {
+        _checksums.insert(i == 0 ? _checksumType : _additionalChecksumTypes.at(i - 1), checksums.at(i));
+    }
+
+    const auto checksum = checksums.value(0);
     if (!checksum.isNull()) {
         emit done(_checksumType, checksum);
     } else {
@@ -24,6 +24,7 @@
 #include <QObject>
 #include <QByteArray>
 #include <QFutureWatcher>
+#include <QHash>
 
 #include <memory>
 
@@ -76,6 +77,19 @@ public:
 
     QByteArray checksumType() const;
 
+    /**
+     * Sets checksum types that get computed in the same pass over the file
+     * as the main checksum type. Their values are available through
+     * checksum() once done() was emitted.
+     */
+    void setAdditionalChecksumTypes(const QList<QByteArray> &types);
+
+    /**
+     * Returns the computed checksum of the given type, empty if it was not
+     * requested or could not be computed.
+     */
+    [[nodiscard]] QByteArray checksum(const QByteArray &type) const;
+
     /**
      * Computes the checksum for the given file path.
      *
@@ -103,9 +117,11 @@ private:
     void startImpl(const QString &filePath);
 
     QByteArray _checksumType;
+    QList<QByteArray> _additionalChecksumTypes;
+    QHash<QByteArray, QByteArray> _checksums;
 
     // watcher for the checksum calculation thread
-    QFutureWatcher<QByteArray> _watcher;
+    QFutureWatcher<QList<QByteArray>> _watcher;
 
     QScopedPointer<ChecksumCalculator> _checksumCalculator;
 };
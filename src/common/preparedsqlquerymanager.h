@@ -63,6 +63,8 @@ public:
         GetFileRecordQueryByMangledName,
         GetFileRecordQueryByInode,
         GetFileRecordQueryByFileId,
+        GetFileRecordQueryByInodes,
+        GetFileRecordQueryByFileIds,
         GetFilesBelowPathQuery,
         GetAllFilesQuery,
         ListFilesInPathQuery,
@@ -100,6 +102,7 @@ public:
         GetRawPinStateQuery,
         GetEffectivePinStateQuery,
         GetSubPinsQuery,
+        GetChildPinStatesQuery,
         CountDehydratedFilesQuery,
         SetPinStateQuery,
         WipePinStateQuery,
@@ -108,6 +111,10 @@ public:
         GetE2EeLockedFoldersQuery,
         DeleteE2EeLockedFolderQuery,
         ListAllTopLevelE2eeFoldersStatusLessThanQuery,
+        GetLocalDirectoryDigestQuery,
+        SetLocalDirectoryDigestQuery,
+        DeleteLocalDirectoryDigestQuery,
+        DeleteLocalDirectoryDigestsRecursively,
 
         PreparedQueryCount
     };
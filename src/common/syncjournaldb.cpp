@@ -24,7 +24,9 @@
 #include <QUrl>
 #include <QDir>
 #include <sqlite3.h>
+#include <chrono>
 #include <cstring>
+#include <mutex>
 
 #include "common/syncjournaldb.h"
 #include "version.h"
@@ -54,6 +56,14 @@ Q_LOGGING_CATEGORY(lcDb, "nextcloud.sync.database", QtInfoMsg)
         " FROM metadata" \
         "  LEFT JOIN checksumtype as contentchecksumtype ON metadata.contentChecksumTypeId == contentchecksumtype.id"
 
+// Number of keys bound to one query by the batched getFileRecordsBy*() lookups
+static constexpr int fileRecordBatchSize = 64;
+
+// Bounds for grouping the commits of the propagation: the number of commit()
+// requests in one transaction and how long the first of them may wait
+static constexpr int maxDeferredCommits = 500;
+static constexpr std::chrono::milliseconds deferredCommitLatency(1000);
+
 static void fillFileRecordFromGetQuery(SyncJournalFileRecord &rec, SqlQuery &query)
 {
     rec._path = query.baValue(0);
@@ -116,6 +126,9 @@ SyncJournalDb::SyncJournalDb(const QString &dbFilePath, QObject *parent)
     if (_journalMode.isEmpty()) {
         _journalMode = defaultJournalMode(_dbFile);
     }
+
+    _commitThread.setMaxThreadCount(1);
+    _commitThread.setObjectName(QStringLiteral("SyncJournalDb commit thread"));
 }
 
 QString SyncJournalDb::makeDbName(const QString &localPath,
@@ -277,6 +290,11 @@ void SyncJournalDb::startTransaction()
 
 void SyncJournalDb::commitTransaction()
 {
+    if (_deferredCommits > 0) {
+        _deferredCommits = 0;
+        _deferredCommitsChanged.notify_all();
+    }
+
     if (_transaction == 1) {
         if (!_db.commit()) {
             qCWarning(lcDb) << "ERROR committing to the database:" << _db.error();
@@ -457,6 +475,7 @@ bool SyncJournalDb::checkConnect()
                         "tmpfile VARCHAR(4096),"
                         "etag VARCHAR(32),"
                         "errorcount INTEGER,"
+                        "segments TEXT,"
                         "PRIMARY KEY(path)"
                         ");");
 
@@ -472,6 +491,9 @@ bool SyncJournalDb::checkConnect()
                         "size INTEGER(8),"
                         "modtime INTEGER(8),"
                         "contentChecksum TEXT,"
+                        "e2eEncryptionKey TEXT,"
+                        "e2eInitializationVector TEXT,"
+                        "e2eEncryptedFileName TEXT,"
                         "PRIMARY KEY(path)"
                         ");");
 
@@ -571,6 +593,15 @@ bool SyncJournalDb::checkConnect()
         return sqlFail(QStringLiteral("Create table version"), createQuery);
     }
 
+    // create the localdirectorydigests table.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS localdirectorydigests("
+                        "path TEXT PRIMARY KEY,"
+                        "digest BLOB"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table localdirectorydigests"), createQuery);
+    }
+
      // create the e2EeLockedFolders table.
     createQuery.prepare(
         "CREATE TABLE IF NOT EXISTS e2EeLockedFolders("
@@ -701,6 +732,7 @@ void SyncJournalDb::close()
     _db.close();
     clearEtagStorageFilter();
     _metadataTableIsEmpty = false;
+    _localDirectoryDigestPathsLoaded = false;
 }
 
 
@@ -802,6 +834,38 @@ bool SyncJournalDb::updateMetadataTableStructure()
         }
         commitInternal(QStringLiteral("update database structure: add contentChecksum col for uploadinfo"));
     }
+    if (!uploadInfoColumns.contains("e2eEncryptionKey")) {
+        SqlQuery query(_db);
+        query.prepare("ALTER TABLE uploadinfo ADD COLUMN e2eEncryptionKey TEXT;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: add e2eEncryptionKey column"), query);
+            re = false;
+        }
+        query.prepare("ALTER TABLE uploadinfo ADD COLUMN e2eInitializationVector TEXT;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: add e2eInitializationVector column"), query);
+            re = false;
+        }
+        query.prepare("ALTER TABLE uploadinfo ADD COLUMN e2eEncryptedFileName TEXT;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: add e2eEncryptedFileName column"), query);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add e2e encryption cols for uploadinfo"));
+    }
+
+    auto downloadInfoColumns = tableColumns("downloadinfo");
+    if (downloadInfoColumns.isEmpty())
+        return false;
+    if (!downloadInfoColumns.contains("segments")) {
+        SqlQuery query(_db);
+        query.prepare("ALTER TABLE downloadinfo ADD COLUMN segments TEXT;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: add segments column"), query);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add segments col for downloadinfo"));
+    }
 
     auto conflictsColumns = tableColumns("conflicts");
     if (conflictsColumns.isEmpty())
@@ -1048,6 +1112,11 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
     // Can't be true anymore.
     _metadataTableIsEmpty = false;
 
+    // Discovery always reads the records of subdirectories, only files are covered by the listing digest
+    if (!record.isDirectory()) {
+        dropParentDirectoryDigest(QString::fromUtf8(record._path));
+    }
+
     return {};
 }
 
@@ -1261,6 +1330,40 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
                 return false;
             }
         }
+
+        // The listing digests of removed directories are stale now
+        if (hasLocalDirectoryDigest(filename)) {
+            const auto query = _queryManager.get(PreparedSqlQueryManager::DeleteLocalDirectoryDigestQuery, QByteArrayLiteral("DELETE FROM localdirectorydigests WHERE path=?1"), _db);
+            if (!query) {
+                qCDebug(lcDb) << "database error:" << query->error();
+                return false;
+            }
+
+            query->bindValue(1, filename);
+            if (!query->exec()) {
+                qCDebug(lcDb) << "database error:" << query->error();
+                return false;
+            }
+        }
+
+        if (recursively) {
+            const auto query = _queryManager.get(PreparedSqlQueryManager::DeleteLocalDirectoryDigestsRecursively, QByteArrayLiteral("DELETE FROM localdirectorydigests WHERE " IS_PREFIX_PATH_OF("?1", "path")), _db);
+            if (!query) {
+                qCDebug(lcDb) << "database error:" << query->error();
+                return false;
+            }
+
+            query->bindValue(1, filename);
+            if (!query->exec()) {
+                qCDebug(lcDb) << "database error:" << query->error();
+                return false;
+            }
+            const auto prefix = filename + QLatin1Char('/');
+            _localDirectoryDigestPaths.removeIf([&prefix](const QString &path) {
+                return path.startsWith(prefix);
+            });
+        }
+        _localDirectoryDigestPaths.remove(filename);
         return true;
     } else {
         qCWarning(lcDb) << "Failed to connect database.";
@@ -1447,6 +1550,92 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
     return true;
 }
 
+bool SyncJournalDb::getFileRecordsByInodes(const QVector<quint64> &inodes, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QVariantList keys;
+    keys.reserve(inodes.size());
+    for (const auto inode : inodes) {
+        if (inode) {
+            keys.append(inode);
+        }
+    }
+    return getFileRecordsBatched(PreparedSqlQueryManager::GetFileRecordQueryByInodes, "inode", keys, rowCallback);
+}
+
+bool SyncJournalDb::getFileRecordsByFileIds(const QVector<QByteArray> &fileIds, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QVariantList keys;
+    keys.reserve(fileIds.size());
+    for (const auto &fileId : fileIds) {
+        if (!fileId.isEmpty()) {
+            keys.append(fileId);
+        }
+    }
+    return getFileRecordsBatched(PreparedSqlQueryManager::GetFileRecordQueryByFileIds, "fileid", keys, rowCallback);
+}
+
+bool SyncJournalDb::getFileRecordsBatched(PreparedSqlQueryManager::Key queryKey, const char *column, const QVariantList &keys,
+    const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (keys.isEmpty() || _metadataTableIsEmpty) {
+        return true; // no error, yet nothing found
+    }
+
+    if (!checkConnect()) {
+        return false;
+    }
+
+    // The statement always has fileRecordBatchSize placeholders so it can be prepared once;
+    // a short last batch repeats its first key in the unused slots.
+    auto sql = QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE ");
+    sql.append(column);
+    sql.append(" IN (");
+    for (int i = 1; i <= fileRecordBatchSize; ++i) {
+        sql.append('?');
+        sql.append(QByteArray::number(i));
+        sql.append(i < fileRecordBatchSize ? ',' : ')');
+    }
+
+    const auto query = _queryManager.get(queryKey, sql, _db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return false;
+    }
+
+    for (qsizetype batchStart = 0; batchStart < keys.size(); batchStart += fileRecordBatchSize) {
+        query->reset_and_clear_bindings();
+        for (int i = 0; i < fileRecordBatchSize; ++i) {
+            const auto keyIndex = batchStart + i < keys.size() ? batchStart + i : batchStart;
+            query->bindValue(i + 1, keys.at(keyIndex));
+        }
+
+        if (!query->exec()) {
+            qCDebug(lcDb) << "database error:" << query->error();
+            return false;
+        }
+
+        forever {
+            auto next = query->next();
+            if (!next.ok) {
+                qCDebug(lcDb) << "database error:" << query->error();
+                return false;
+            }
+
+            if (!next.hasData) {
+                break;
+            }
+
+            SyncJournalFileRecord rec;
+            fillFileRecordFromGetQuery(rec, *query);
+            rowCallback(rec);
+        }
+    }
+
+    return true;
+}
+
 bool SyncJournalDb::getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback)
 {
     QMutexLocker locker(&_mutex);
@@ -1656,6 +1845,8 @@ bool SyncJournalDb::updateLocalMetadata(const QString &filename,
         qCDebug(lcDb) << "database error:" << query->error();
         return false;
     }
+
+    dropParentDirectoryDigest(filename);
     return true;
 }
 
@@ -1702,12 +1893,41 @@ Optional<SyncJournalDb::HasHydratedDehydrated> SyncJournalDb::hasHydratedOrDehyd
     return result;
 }
 
+// Segments are stored as "start:end:received" triples separated by ','
+static QByteArray downloadSegmentsToString(const QVector<SyncJournalDb::DownloadInfo::Segment> &segments)
+{
+    QByteArrayList parts;
+    parts.reserve(segments.size());
+    for (const auto &segment : segments) {
+        parts.append(QByteArray::number(segment._start) + ':' + QByteArray::number(segment._end) + ':' + QByteArray::number(segment._received));
+    }
+    return parts.join(',');
+}
+
+static QVector<SyncJournalDb::DownloadInfo::Segment> downloadSegmentsFromString(const QByteArray &string)
+{
+    QVector<SyncJournalDb::DownloadInfo::Segment> segments;
+    if (string.isEmpty()) {
+        return segments;
+    }
+    for (const auto &part : string.split(',')) {
+        const auto values = part.split(':');
+        if (values.size() != 3) {
+            qCWarning(lcDb) << "Ignoring malformed download segments" << string;
+            return {};
+        }
+        segments.append({values.at(0).toLongLong(), values.at(1).toLongLong(), values.at(2).toLongLong()});
+    }
+    return segments;
+}
+
 static void toDownloadInfo(SqlQuery &query, SyncJournalDb::DownloadInfo *res)
 {
     bool ok = true;
     res->_tmpfile = query.stringValue(0);
     res->_etag = query.baValue(1);
     res->_errorCount = query.intValue(2);
+    res->_segments = downloadSegmentsFromString(query.baValue(3));
     res->_valid = ok;
 }
 
@@ -1736,7 +1956,7 @@ SyncJournalDb::DownloadInfo SyncJournalDb::getDownloadInfo(const QString &file)
     DownloadInfo res;
 
     if (checkConnect()) {
-        const auto query = _queryManager.get(PreparedSqlQueryManager::GetDownloadInfoQuery, QByteArrayLiteral("SELECT tmpfile, etag, errorcount FROM downloadinfo WHERE path=?1"), _db);
+        const auto query = _queryManager.get(PreparedSqlQueryManager::GetDownloadInfoQuery, QByteArrayLiteral("SELECT tmpfile, etag, errorcount, segments FROM downloadinfo WHERE path=?1"), _db);
         if (!query) {
             qCDebug(lcDb) << "database error:" << query->error();
             return res;
@@ -1767,8 +1987,8 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
 
     if (i._valid) {
         const auto query = _queryManager.get(PreparedSqlQueryManager::SetDownloadInfoQuery, QByteArrayLiteral("INSERT OR REPLACE INTO downloadinfo "
-                                                                                                              "(path, tmpfile, etag, errorcount) "
-                                                                                                              "VALUES ( ?1 , ?2, ?3, ?4 )"),
+                                                                                                              "(path, tmpfile, etag, errorcount, segments) "
+                                                                                                              "VALUES ( ?1 , ?2, ?3, ?4, ?5 )"),
             _db);
         if (!query) {
             qCDebug(lcDb) << "database error:" << query->error();
@@ -1778,6 +1998,7 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
         query->bindValue(2, i._tmpfile);
         query->bindValue(3, i._etag);
         query->bindValue(4, i._errorCount);
+        query->bindValue(5, downloadSegmentsToString(i._segments));
         if (!query->exec()) {
             qCDebug(lcDb) << "database error:" << query->error();
         }
@@ -1805,7 +2026,7 @@ QVector<SyncJournalDb::DownloadInfo> SyncJournalDb::getAndDeleteStaleDownloadInf
 
     SqlQuery query(_db);
     // The selected values *must* match the ones expected by toDownloadInfo().
-    query.prepare("SELECT tmpfile, etag, errorcount, path FROM downloadinfo");
+    query.prepare("SELECT tmpfile, etag, errorcount, segments, path FROM downloadinfo");
 
     if (!query.exec()) {
         qCDebug(lcDb) << "database error:" << query.error();
@@ -1816,7 +2037,7 @@ QVector<SyncJournalDb::DownloadInfo> SyncJournalDb::getAndDeleteStaleDownloadInf
     QVector<SyncJournalDb::DownloadInfo> deleted_entries;
 
     while (query.next().hasData) {
-        const QString file = query.stringValue(3); // path
+        const QString file = query.stringValue(4); // path
         if (!keep.contains(file)) {
             superfluousPaths.append(file);
             DownloadInfo info;
@@ -1864,7 +2085,8 @@ SyncJournalDb::UploadInfo SyncJournalDb::getUploadInfo(const QString &file)
     UploadInfo res;
 
     if (checkConnect()) {
-        const auto query = _queryManager.get(PreparedSqlQueryManager::GetUploadInfoQuery, QByteArrayLiteral("SELECT chunk, transferid, errorcount, size, modtime, contentChecksum FROM "
+        const auto query = _queryManager.get(PreparedSqlQueryManager::GetUploadInfoQuery, QByteArrayLiteral("SELECT chunk, transferid, errorcount, size, modtime, contentChecksum, "
+                                                                                                            "e2eEncryptionKey, e2eInitializationVector, e2eEncryptedFileName FROM "
                                                                                                             "uploadinfo WHERE path=?1"),
             _db);
         if (!query) {
@@ -1886,6 +2108,9 @@ SyncJournalDb::UploadInfo SyncJournalDb::getUploadInfo(const QString &file)
             res._size = query->int64Value(3);
             res._modtime = query->int64Value(4);
             res._contentChecksum = query->baValue(5);
+            res._e2eEncryptionKey = QByteArray::fromBase64(query->baValue(6));
+            res._e2eInitializationVector = QByteArray::fromBase64(query->baValue(7));
+            res._e2eEncryptedFileName = query->stringValue(8);
             res._valid = ok;
         }
     }
@@ -1902,8 +2127,9 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
 
     if (i._valid) {
         const auto query = _queryManager.get(PreparedSqlQueryManager::SetUploadInfoQuery, QByteArrayLiteral("INSERT OR REPLACE INTO uploadinfo "
-                                                                                                            "(path, chunk, transferid, errorcount, size, modtime, contentChecksum) "
-                                                                                                            "VALUES ( ?1 , ?2, ?3 , ?4 ,  ?5, ?6 , ?7 )"),
+                                                                                                            "(path, chunk, transferid, errorcount, size, modtime, contentChecksum, "
+                                                                                                            "e2eEncryptionKey, e2eInitializationVector, e2eEncryptedFileName) "
+                                                                                                            "VALUES ( ?1 , ?2, ?3 , ?4 ,  ?5, ?6 , ?7 , ?8 , ?9 , ?10 )"),
             _db);
         if (!query) {
             qCDebug(lcDb) << "database error:" << query->error();
@@ -1917,6 +2143,9 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
         query->bindValue(5, i._size);
         query->bindValue(6, i._modtime);
         query->bindValue(7, i._contentChecksum);
+        query->bindValue(8, i._e2eEncryptionKey.toBase64());
+        query->bindValue(9, i._e2eInitializationVector.toBase64());
+        query->bindValue(10, i._e2eEncryptedFileName);
 
         if (!query->exec()) {
             qCDebug(lcDb) << "database error:" << query->error();
@@ -2292,6 +2521,14 @@ void SyncJournalDb::avoidRenamesOnNextSync(const QByteArray &path)
         sqlFail(QStringLiteral("avoidRenamesOnNextSync path: %1").arg(QString::fromUtf8(path)), query);
     }
 
+    SqlQuery digestQuery(_db);
+    digestQuery.prepare("DELETE FROM localdirectorydigests WHERE " IS_PREFIX_PATH_OR_EQUAL("?1", "path"));
+    digestQuery.bindValue(1, path);
+    if (!digestQuery.exec()) {
+        sqlFail(QStringLiteral("avoidRenamesOnNextSync digests path: %1").arg(QString::fromUtf8(path)), digestQuery);
+    }
+    _localDirectoryDigestPathsLoaded = false;
+
     // We also need to remove the ETags so the update phase refreshes the directory paths
     // on the next sync
     schedulePathForRemoteDiscovery(path);
@@ -2725,6 +2962,97 @@ void SyncJournalDb::clearFileTable()
         qCDebug(lcDb) << "database error:" << query.error();
         sqlFail(QStringLiteral("clearFileTable"), query);
     }
+
+    query.prepare("DELETE FROM localdirectorydigests;");
+    if (!query.exec()) {
+        qCDebug(lcDb) << "database error:" << query.error();
+        sqlFail(QStringLiteral("clearFileTable"), query);
+    }
+    _localDirectoryDigestPathsLoaded = false;
+}
+
+QByteArray SyncJournalDb::localDirectoryDigest(const QString &path)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return {};
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetLocalDirectoryDigestQuery, QByteArrayLiteral("SELECT digest FROM localdirectorydigests WHERE path=?1;"), _db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return {};
+    }
+    query->bindValue(1, path);
+    if (!query->exec()) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return {};
+    }
+    if (!query->next().hasData) {
+        return {};
+    }
+    return query->baValue(0);
+}
+
+void SyncJournalDb::setLocalDirectoryDigest(const QString &path, const QByteArray &digest)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return;
+    }
+
+    const auto query = digest.isEmpty()
+        ? _queryManager.get(PreparedSqlQueryManager::DeleteLocalDirectoryDigestQuery, QByteArrayLiteral("DELETE FROM localdirectorydigests WHERE path=?1"), _db)
+        : _queryManager.get(PreparedSqlQueryManager::SetLocalDirectoryDigestQuery, QByteArrayLiteral("INSERT OR REPLACE INTO localdirectorydigests (path, digest) VALUES (?1, ?2);"), _db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return;
+    }
+    query->bindValue(1, path);
+    if (!digest.isEmpty()) {
+        query->bindValue(2, digest);
+    }
+    if (!query->exec()) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        _localDirectoryDigestPathsLoaded = false;
+        return;
+    }
+
+    if (digest.isEmpty()) {
+        _localDirectoryDigestPaths.remove(path);
+    } else {
+        _localDirectoryDigestPaths.insert(path);
+    }
+}
+
+bool SyncJournalDb::hasLocalDirectoryDigest(const QString &path)
+{
+    if (!_localDirectoryDigestPathsLoaded) {
+        SqlQuery query(_db);
+        query.prepare("SELECT path FROM localdirectorydigests");
+        if (!query.exec()) {
+            qCDebug(lcDb) << "database error:" << query.error();
+            // can't tell, assume there is one
+            return true;
+        }
+
+        _localDirectoryDigestPaths.clear();
+        while (query.next().hasData) {
+            _localDirectoryDigestPaths.insert(query.stringValue(0));
+        }
+        _localDirectoryDigestPathsLoaded = true;
+    }
+    return _localDirectoryDigestPaths.contains(path);
+}
+
+void SyncJournalDb::dropParentDirectoryDigest(const QString &path)
+{
+    // Nothing to do in the common case: the digests of directories with changed files
+    // were already dropped by discovery
+    const auto slash = path.lastIndexOf(QLatin1Char('/'));
+    if (slash > 0 && hasLocalDirectoryDigest(path.left(slash))) {
+        setLocalDirectoryDigest(path.left(slash), {});
+    }
 }
 
 void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path)
@@ -2959,6 +3287,48 @@ Optional<PinState> SyncJournalDb::PinStateInterface::effectiveForPathRecursive(c
     return *basePin;
 }
 
+Optional<QHash<QByteArray, PinState>> SyncJournalDb::PinStateInterface::rawForChildren(const QByteArray &path)
+{
+    QMutexLocker lock(&_db->_mutex);
+    if (!_db->checkConnect()) {
+        return {};
+    }
+
+    // Deeper entries are filtered out below, there usually are few of them
+    const auto query = _db->_queryManager.get(PreparedSqlQueryManager::GetChildPinStatesQuery, QByteArrayLiteral("SELECT path, pinState FROM flags WHERE"
+                                                                                                                 " (" IS_PREFIX_PATH_OF("?1", "path") " OR (?1 == '' AND path != ''))"
+                                                                                                                 " AND pinState is not null AND pinState != 0;"),
+        _db->_db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return {};
+    }
+    query->bindValue(1, path);
+    if (!query->exec()) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return {};
+    }
+
+    const auto prefixLength = path.isEmpty() ? 0 : path.size() + 1;
+    QHash<QByteArray, PinState> result;
+    forever {
+        auto next = query->next();
+        if (!next.ok) {
+            qCDebug(lcDb) << "database error:" << query->error();
+            return {};
+        }
+        if (!next.hasData) {
+            break;
+        }
+        const auto name = query->baValue(0).mid(prefixLength);
+        if (name.isEmpty() || name.contains('/')) {
+            continue;
+        }
+        result.insert(name, static_cast<PinState>(query->intValue(1)));
+    }
+    return result;
+}
+
 void SyncJournalDb::PinStateInterface::setForPath(const QByteArray &path, PinState state)
 {
     QMutexLocker lock(&_db->_mutex);
@@ -3045,9 +3415,48 @@ SyncJournalDb::PinStateInterface SyncJournalDb::internalPinStates()
 void SyncJournalDb::commit(const QString &context, bool startTrans)
 {
     QMutexLocker lock(&_mutex);
+    if (_groupCommit && startTrans && _transaction == 1) {
+        deferCommitInternal();
+        return;
+    }
     commitInternal(context, startTrans);
 }
 
+void SyncJournalDb::setGroupCommit(bool enabled)
+{
+    QMutexLocker lock(&_mutex);
+    _groupCommit = enabled;
+    if (!enabled && _deferredCommits > 0) {
+        commitInternal(QStringLiteral("end of group commit"));
+    }
+}
+
+void SyncJournalDb::deferCommitInternal()
+{
+    ++_deferredCommits;
+    if (_deferredCommits >= maxDeferredCommits) {
+        _deferredCommitsChanged.notify_all();
+    }
+    if (!_groupCommitScheduled) {
+        _groupCommitScheduled = true;
+        _commitThread.start([this] { runGroupCommit(); });
+    }
+}
+
+void SyncJournalDb::runGroupCommit()
+{
+    std::unique_lock lock(_mutex);
+    // Waiting releases the mutex, the propagation keeps using the database meanwhile
+    _deferredCommitsChanged.wait_for(lock, deferredCommitLatency, [this] {
+        return _deferredCommits == 0 || _deferredCommits >= maxDeferredCommits;
+    });
+    if (_deferredCommits > 0 && _db.isOpen()) {
+        commitInternal(QStringLiteral("group of %1 commits").arg(_deferredCommits));
+    }
+    _deferredCommits = 0;
+    _groupCommitScheduled = false;
+}
+
 void SyncJournalDb::commitIfNeededAndStartNewTransaction(const QString &context)
 {
     QMutexLocker lock(&_mutex);
@@ -3085,6 +3494,14 @@ SyncJournalDb::~SyncJournalDb()
     if (isOpen()) {
         close();
     }
+
+    {
+        QMutexLocker lock(&_mutex);
+        _groupCommit = false;
+        _deferredCommits = 0;
+        _deferredCommitsChanged.notify_all();
+    }
+    _commitThread.waitForDone();
 }
 
 
@@ -3094,14 +3511,17 @@ bool operator==(const SyncJournalDb::DownloadInfo &lhs,
     return lhs._errorCount == rhs._errorCount
         && lhs._etag == rhs._etag
         && lhs._tmpfile == rhs._tmpfile
-        && lhs._valid == rhs._valid;
+        && lhs._valid == rhs._valid
+        && lhs._segments == rhs._segments;
 }
 
 bool operator==(const SyncJournalDb::UploadInfo &lhs,
     const SyncJournalDb::UploadInfo &rhs)
 {
     return lhs._errorCount == rhs._errorCount && lhs._chunkUploadV1 == rhs._chunkUploadV1 && lhs._modtime == rhs._modtime && lhs._valid == rhs._valid
-        && lhs._size == rhs._size && lhs._transferid == rhs._transferid && lhs._contentChecksum == rhs._contentChecksum;
+        && lhs._size == rhs._size && lhs._transferid == rhs._transferid && lhs._contentChecksum == rhs._contentChecksum
+        && lhs._e2eEncryptionKey == rhs._e2eEncryptionKey && lhs._e2eInitializationVector == rhs._e2eInitializationVector
+        && lhs._e2eEncryptedFileName == rhs._e2eEncryptedFileName;
 }
 
 QDebug& operator<<(QDebug &stream, const SyncJournalFileRecord::EncryptionStatus status)
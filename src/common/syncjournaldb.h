@@ -23,7 +23,10 @@
 #include <QDateTime>
 #include <QHash>
 #include <QMutex>
+#include <QSet>
+#include <QThreadPool>
 #include <QVariant>
+#include <condition_variable>
 #include <functional>
 
 #include "common/utility.h"
@@ -67,6 +70,14 @@ public:
     [[nodiscard]] bool getFileRecordByE2eMangledName(const QString &mangledName, SyncJournalFileRecord *rec);
     [[nodiscard]] bool getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec);
     [[nodiscard]] bool getFileRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+    /**
+     * Batched variants of getFileRecordByInode() and getFileRecordsByFileId().
+     *
+     * Look up many keys with a few IN (...) queries instead of one query each.
+     * The callback is called once for every matching record, in no particular order.
+     */
+    [[nodiscard]] bool getFileRecordsByInodes(const QVector<quint64> &inodes, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+    [[nodiscard]] bool getFileRecordsByFileIds(const QVector<QByteArray> &fileIds, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
     [[nodiscard]] bool getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     [[nodiscard]] bool listFilesInPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     [[nodiscard]] Result<void, QString> setFileRecord(const SyncJournalFileRecord &record);
@@ -111,10 +122,21 @@ public:
 
     struct DownloadInfo
     {
+        /// A byte range of a segmented download and how much of it is on disk
+        struct Segment
+        {
+            qint64 _start = 0;
+            qint64 _end = 0; /// exclusive
+            qint64 _received = 0;
+
+            friend bool operator==(const Segment &, const Segment &) = default;
+        };
+
         QString _tmpfile;
         QByteArray _etag;
         int _errorCount = 0;
         bool _valid = false;
+        QVector<Segment> _segments; /// empty for single stream downloads
     };
     struct UploadInfo
     {
@@ -125,6 +147,10 @@ public:
         int _errorCount = 0;
         bool _valid = false;
         QByteArray _contentChecksum;
+        /// Key, IV and name of the data of an end-to-end encrypted file, a resumed upload has to send the same data
+        QByteArray _e2eEncryptionKey;
+        QByteArray _e2eInitializationVector;
+        QString _e2eEncryptedFileName;
         /**
          * Returns true if this entry refers to a chunked upload that can be continued.
          * (As opposed to a small file transfer which is stored in the db so we can detect the case
@@ -220,6 +246,16 @@ public:
     void commit(const QString &context, bool startTrans = true);
     void commitIfNeededAndStartNewTransaction(const QString &context);
 
+    /** Group the commits requested while propagating
+     *
+     * Every finished item asks for a commit(). While grouping is enabled these requests
+     * only get counted; the transaction is committed on the journal's commit thread once
+     * enough requests piled up or the first of them waited long enough. commit() without
+     * starting a new transaction, close() and disabling the grouping commit everything
+     * synchronously.
+     */
+    void setGroupCommit(bool enabled);
+
     /** Open the db if it isn't already.
      *
      * This usually creates some temporary files next to the db file, like
@@ -278,6 +314,18 @@ public:
      */
     QByteArray conflictFileBaseName(const QByteArray &conflictName);
 
+    /**
+     * Digest of the local listing of a directory, as of the last sync that found all
+     * of its files unchanged. See ProcessDirectoryJob for how it is computed and used.
+     *
+     * Returns an empty array if none is stored.
+     */
+    QByteArray localDirectoryDigest(const QString &path);
+
+    /// Store the digest of a directory's local listing; an empty digest removes it.
+    /// setFileRecord() and deleteFileRecord() remove the digests they make stale.
+    void setLocalDirectoryDigest(const QString &path, const QByteArray &digest);
+
     /**
      * Delete any file entry. This will force the next sync to re-sync everything as if it was new,
      * restoring everyfile on every remote. If a file is there both on the client and server side,
@@ -355,6 +403,17 @@ public:
          */
         Optional<PinState> effectiveForPathRecursive(const QByteArray &path);
 
+        /**
+         * Gets the explicit PinStates of the direct children of a path, by name.
+         *
+         * Children that are not in the result inherit the path's effective
+         * pin state. Used to avoid a query per item when listing a directory.
+         *
+         * It's valid to use the root path "".
+         * Returns none on db error.
+         */
+        Optional<QHash<QByteArray, PinState>> rawForChildren(const QByteArray &path);
+
         /**
          * Sets a path's pin state.
          *
@@ -414,9 +473,15 @@ private:
     void commitInternal(const QString &context, bool startTrans = true);
     void startTransaction();
     void commitTransaction();
+    void deferCommitInternal();
+    void runGroupCommit();
     QVector<QByteArray> tableColumns(const QByteArray &table);
     bool checkConnect();
 
+    // Shared implementation of getFileRecordsByInodes() and getFileRecordsByFileIds()
+    bool getFileRecordsBatched(PreparedSqlQueryManager::Key queryKey, const char *column, const QVariantList &keys,
+        const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+
     // Same as forceRemoteDiscoveryNextSync but without acquiring the lock
     void forceRemoteDiscoveryNextSyncLocked();
 
@@ -425,12 +490,26 @@ private:
     // Returns 0 on failure and for empty checksum types.
     [[nodiscard]] int mapChecksumType(const QByteArray &checksumType);
 
+    // Whether a listing digest is stored for the path, served from _localDirectoryDigestPaths
+    [[nodiscard]] bool hasLocalDirectoryDigest(const QString &path);
+    // Drops the listing digest of the directory containing path, if it has one
+    void dropParentDirectoryDigest(const QString &path);
+
     SqlDatabase _db;
     QString _dbFile;
     QRecursiveMutex _mutex; // Public functions are protected with the mutex.
     QMap<QByteArray, int> _checksymTypeCache;
     int _transaction = 0;
     bool _metadataTableIsEmpty = false;
+    // Paths with a stored listing digest, loaded on first use
+    QSet<QString> _localDirectoryDigestPaths;
+    bool _localDirectoryDigestPathsLoaded = false;
+
+    bool _groupCommit = false;
+    int _deferredCommits = 0; // commit() requests not committed yet
+    bool _groupCommitScheduled = false;
+    std::condition_variable_any _deferredCommitsChanged;
+    QThreadPool _commitThread;
 
     /* Storing etags to these folders, or their parent folders, is filtered out.
      *
@@ -112,6 +112,11 @@ Optional<PinState> Vfs::pinStateInDb(const QString &folderPath)
     return pin;
 }
 
+Optional<QHash<QByteArray, PinState>> Vfs::childPinStatesInDb(const QString &folderPath)
+{
+    return _setupParams.journal->internalPinStates().rawForChildren(folderPath.toUtf8());
+}
+
 Vfs::AvailabilityResult Vfs::availabilityInDb(const QString &folderPath)
 {
     auto path = folderPath.toUtf8();
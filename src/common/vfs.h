@@ -18,6 +18,7 @@
 #include "syncfilestatus.h"
 #include "pinstate.h"
 
+#include <QHash>
 #include <QObject>
 #include <QScopedPointer>
 #include <QSharedPointer>
@@ -77,6 +78,26 @@ struct OCSYNC_EXPORT VfsSetupParams
     bool multipleAccountsRegistered = false;
 };
 
+/** The directory being listed by local discovery on Unix.
+ *
+ * Passed as stat_data to Vfs::statTypeVirtualFile(). Lives as long as the
+ * listing, so plugins can keep per-directory lookups in it.
+ */
+struct LocalDirectoryStatData
+{
+    /// Absolute path, without trailing slash
+    QByteArray path;
+    /// The open directory, for *at() calls on its entries
+    int fd = -1;
+
+    /// Set once pinState and childPinStates were loaded
+    bool pinStatesLoaded = false;
+    /// Effective pin state of the directory, none on db error
+    Optional<PinState> pinState;
+    /// Explicit pin states of the entries by name, the others inherit pinState
+    QHash<QByteArray, PinState> childPinStates;
+};
+
 /** Interface describing how to deal with virtual/placeholder files.
  *
  * There are different ways of representing files locally that will only
@@ -234,7 +255,8 @@ public:
     /** Similar to isDehydratedPlaceholder() but used from sync discovery.
      *
      * This function shall set stat->type if appropriate.
-     * It may rely on stat->path and stat_data (platform specific data).
+     * It may rely on stat->path and stat_data (platform specific data,
+     * a LocalDirectoryStatData on Unix).
      *
      * Returning true means that type was fully determined.
      */
@@ -303,6 +325,7 @@ protected:
     // Db-backed pin state handling. Derived classes may use it to implement pin states.
     bool setPinStateInDb(const QString &folderPath, PinState state);
     Optional<PinState> pinStateInDb(const QString &folderPath);
+    Optional<QHash<QByteArray, PinState>> childPinStatesInDb(const QString &folderPath);
     AvailabilityResult availabilityInDb(const QString &folderPath);
 
     // the parameters passed to start()
@@ -38,6 +38,9 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QVariant>
+#include <QCryptographicHash>
+
+#include <algorithm>
 
 /** Expands C-like escape sequences (in place)
  */
@@ -291,6 +294,22 @@ void ExcludedFiles::setClientVersion(ExcludedFiles::Version version)
     _clientVersion = version;
 }
 
+QByteArray ExcludedFiles::rulesFingerprint() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (auto it = _allExcludes.cbegin(); it != _allExcludes.cend(); ++it) {
+        hash.addData(it.key().toUtf8());
+        for (const auto &pattern : it.value()) {
+            hash.addData("\n");
+            hash.addData(pattern.toUtf8());
+        }
+        hash.addData("\n");
+    }
+    hash.addData(_excludeConflictFiles ? "c" : "-");
+    hash.addData(_wildcardsMatchSlash ? "w" : "-");
+    return hash.result();
+}
+
 void ExcludedFiles::loadExcludeFilePatterns(const QString &basePath, QFile &file)
 {
     QStringList patterns;
@@ -317,6 +336,9 @@ bool ExcludedFiles::reloadExcludeFiles()
 {
     _allExcludes.clear();
     // clear all regex
+    _bnameLookupFile.clear();
+    _bnameLookupDir.clear();
+    _directoryRules.clear();
     _bnameTraversalRegexFile.clear();
     _bnameTraversalRegexDir.clear();
     _fullTraversalRegexFile.clear();
@@ -425,6 +447,95 @@ bool ExcludedFiles::isExcluded(
     return fullPatternMatch(relativePath, type) != CSYNC_NOT_EXCLUDED;
 }
 
+bool ExcludedFiles::BnameLookup::add(Kind kind, const QString &pattern)
+{
+    auto isGlobChar = [](QChar c) {
+        return c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('[') || c == QLatin1Char('\\');
+    };
+    auto addLength = [](QList<qsizetype> &lengths, qsizetype length) {
+        if (!lengths.contains(length))
+            lengths.append(length);
+    };
+
+    const auto firstGlob = std::find_if(pattern.cbegin(), pattern.cend(), isGlobChar) - pattern.cbegin();
+    if (pattern.isEmpty()) {
+        // leave it to the regex
+    } else if (firstGlob == pattern.size()) {
+        _names[kind].insert(pattern);
+        return true;
+    } else if (firstGlob == 0 && pattern.size() > 1 && std::none_of(pattern.cbegin() + 1, pattern.cend(), isGlobChar)) {
+        _suffixes[kind].insert(pattern.mid(1));
+        addLength(_suffixLengths, pattern.size() - 1);
+        return true;
+    } else if (firstGlob == pattern.size() - 1 && pattern.endsWith(QLatin1Char('*'))) {
+        _prefixes[kind].insert(pattern.left(firstGlob));
+        addLength(_prefixLengths, firstGlob);
+        return true;
+    }
+    _hasGlobs = true;
+    return false;
+}
+
+bool ExcludedFiles::BnameLookup::contains(Kind kind, const QString &bname) const
+{
+    if (_names[kind].contains(bname))
+        return true;
+    if (!_prefixes[kind].isEmpty()) {
+        for (const auto length : _prefixLengths) {
+            if (length <= bname.size() && _prefixes[kind].contains(bname.left(length)))
+                return true;
+        }
+    }
+    if (!_suffixes[kind].isEmpty()) {
+        for (const auto length : _suffixLengths) {
+            if (length <= bname.size() && _suffixes[kind].contains(bname.right(length)))
+                return true;
+        }
+    }
+    return false;
+}
+
+const ExcludedFiles::DirectoryRules &ExcludedFiles::directoryRules(const QString &parentPath)
+{
+    auto it = _directoryRules.constFind(parentPath);
+    if (it != _directoryRules.cend())
+        return *it;
+
+    // Discovery handles one directory at a time, so a small cache is enough.
+    static constexpr auto maximumCachedDirectories = 1024;
+    if (_directoryRules.size() >= maximumCachedDirectories)
+        _directoryRules.clear();
+
+    DirectoryRules rules;
+    QString basePath(_localPath + parentPath);
+    if (!parentPath.isEmpty())
+        basePath += QLatin1Char('/');
+    while (true) {
+        if (_bnameTraversalRegexFile.contains(basePath))
+            rules._basePaths.append(basePath);
+        if (basePath.size() <= _localPath.size())
+            break;
+        basePath = leftIncludeLast(basePath, QLatin1Char('/'));
+    }
+
+    // Full path patterns are anchored to the start of the path. If none of them
+    // can match "parentPath/..." the full traversal regexes can be skipped for all
+    // items in this directory.
+    if (!parentPath.isEmpty()) {
+        const QString prefix = parentPath + QLatin1Char('/');
+        auto mayMatchBelow = [&](const QMap<BasePathString, QRegularExpression> &regexes) {
+            return std::any_of(rules._basePaths.cbegin(), rules._basePaths.cend(), [&](const QString &base) {
+                const auto m = regexes.constFind(base)->match(prefix, 0, QRegularExpression::PartialPreferFirstMatch);
+                return m.hasMatch() || m.hasPartialMatch();
+            });
+        };
+        rules._fullPatternsFile = mayMatchBelow(_fullTraversalRegexFile);
+        rules._fullPatternsDir = mayMatchBelow(_fullTraversalRegexDir);
+    }
+
+    return *_directoryRules.insert(parentPath, rules);
+}
+
 CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(const QString &path, ItemType filetype)
 {
     auto match = _csync_excluded_common(path, _excludeConflictFiles);
@@ -438,8 +549,16 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(const QString &path, Ite
         const auto basePath = QString(_localPath + path + QLatin1Char('/'));
         const QString absolutePath = basePath + QStringLiteral(".sync-exclude.lst");
         if (FileSystem::isReadable(absolutePath)) {
-            addExcludeFilePath(absolutePath);
-            reloadExcludeFiles();
+            // Only the new file needs to be loaded, the others are reloaded once per sync run
+            if (!_excludeFiles.value(basePath).contains(absolutePath)) {
+                addExcludeFilePath(absolutePath);
+                QFile file(absolutePath);
+                if (file.open(QIODevice::ReadOnly)) {
+                    loadExcludeFilePatterns(basePath, file);
+                } else {
+                    qWarning() << "System exclude list file could not be opened:" << absolutePath;
+                }
+            }
         } else {
 #if !defined QT_NO_DEBUG
             qWarning() << "System exclude list file could not be read:" << absolutePath;
@@ -450,49 +569,42 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(const QString &path, Ite
     // Check the bname part of the path to see whether the full
     // regex should be run.
     QStringView bnameStr(path);
+    QString parentPath;
     int lastSlash = path.lastIndexOf(QLatin1Char('/'));
     if (lastSlash >= 0) {
         bnameStr = bnameStr.mid(lastSlash + 1);
+        parentPath = path.left(lastSlash);
+    } else if (path.isEmpty()) {
+        return CSYNC_NOT_EXCLUDED;
     }
+    const auto bname = _caseInsensitive ? bnameStr.toString().toCaseFolded() : bnameStr.toString();
+
+    const auto &rules = directoryRules(parentPath);
+    const auto &bnameLookups = filetype == ItemTypeDirectory ? _bnameLookupDir : _bnameLookupFile;
+    const auto &bnameRegexes = filetype == ItemTypeDirectory ? _bnameTraversalRegexDir : _bnameTraversalRegexFile;
+    for (const auto &basePath : rules._basePaths) {
+        const auto &lookup = *bnameLookups.constFind(basePath);
+        if (lookup.contains(BnameLookup::Exclude, bname))
+            return CSYNC_FILE_EXCLUDE_LIST;
 
-    QString basePath(_localPath + path);
-    while (basePath.size() > _localPath.size()) {
-        basePath = leftIncludeLast(basePath, QLatin1Char('/'));
         QRegularExpressionMatch m;
-        if (filetype == ItemTypeDirectory
-            && _bnameTraversalRegexDir.contains(basePath)) {
-            m = _bnameTraversalRegexDir[basePath].matchView(bnameStr);
-        } else if (filetype == ItemTypeFile
-            && _bnameTraversalRegexFile.contains(basePath)) {
-            m = _bnameTraversalRegexFile[basePath].matchView(bnameStr);
-        } else {
-            continue;
+        if (lookup._hasGlobs) {
+            m = bnameRegexes.constFind(basePath)->matchView(bnameStr);
+            if (m.capturedStart(QStringLiteral("exclude")) != -1)
+                return CSYNC_FILE_EXCLUDE_LIST;
         }
-
-        if (!m.hasMatch())
-            return CSYNC_NOT_EXCLUDED;
-        if (m.capturedStart(QStringLiteral("exclude")) != -1) {
-            return CSYNC_FILE_EXCLUDE_LIST;
-        } else if (m.capturedStart(QStringLiteral("excluderemove")) != -1) {
+        if (lookup.contains(BnameLookup::ExcludeRemove, bname) || m.capturedStart(QStringLiteral("excluderemove")) != -1)
             return CSYNC_FILE_EXCLUDE_AND_REMOVE;
-        }
+        if (!m.hasMatch() && !lookup.contains(BnameLookup::Trigger, bname))
+            return CSYNC_NOT_EXCLUDED;
     }
 
     // third capture: full path matching is triggered
-    basePath = _localPath + path;
-    while (basePath.size() > _localPath.size()) {
-        basePath = leftIncludeLast(basePath, QLatin1Char('/'));
-        QRegularExpressionMatch m;
-        if (filetype == ItemTypeDirectory
-            && _fullTraversalRegexDir.contains(basePath)) {
-            m = _fullTraversalRegexDir[basePath].match(path);
-        } else if (filetype == ItemTypeFile
-            && _fullTraversalRegexFile.contains(basePath)) {
-            m = _fullTraversalRegexFile[basePath].match(path);
-        } else {
-            continue;
-        }
-
+    if (!(filetype == ItemTypeDirectory ? rules._fullPatternsDir : rules._fullPatternsFile))
+        return CSYNC_NOT_EXCLUDED;
+    const auto &fullRegexes = filetype == ItemTypeDirectory ? _fullTraversalRegexDir : _fullTraversalRegexFile;
+    for (const auto &basePath : rules._basePaths) {
+        const auto m = fullRegexes.constFind(basePath)->match(path);
         if (m.hasMatch()) {
             if (m.capturedStart(QStringLiteral("exclude")) != -1) {
                 return CSYNC_FILE_EXCLUDE_LIST;
@@ -678,6 +790,9 @@ QString ExcludedFiles::extractBnameTrigger(const QString &exclude, bool wildcard
 void ExcludedFiles::prepare()
 {
     // clear all regex
+    _bnameLookupFile.clear();
+    _bnameLookupDir.clear();
+    _directoryRules.clear();
     _bnameTraversalRegexFile.clear();
     _bnameTraversalRegexDir.clear();
     _fullTraversalRegexFile.clear();
@@ -706,6 +821,9 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
     //   patterns must be anchored to the front, these don't need it)
     // * The "bnameTrigger" group contains the bname part of all patterns in the
     //   "full" group. These and the "bname" group become _bnameTraversalRegex.
+    // * Plain name, prefix and suffix patterns of the "bname" and "bnameTrigger"
+    //   groups go into _bnameLookup instead, only the remaining globs are
+    //   collected in the "glob" group for the _bnameTraversalRegex.
     //
     // To complicate matters, the exclude patterns have two binary attributes
     // meaning we'll end up with 4 variants:
@@ -725,9 +843,27 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
     QString bnameDirKeep;
     QString bnameDirRemove;
 
+    QString globFileDirKeep;
+    QString globFileDirRemove;
+    QString globDirKeep;
+    QString globDirRemove;
+
     QString bnameTriggerFileDir;
     QString bnameTriggerDir;
 
+    _caseInsensitive = OCC::Utility::fsCasePreserving();
+    _directoryRules.clear();
+    auto &lookupFile = _bnameLookupFile[basePath];
+    auto &lookupDir = _bnameLookupDir[basePath];
+    lookupFile = {};
+    lookupDir = {};
+    auto lookupAdd = [&](BnameLookup::Kind kind, const QString &pattern, bool dirOnly) {
+        const auto key = _caseInsensitive ? pattern.toCaseFolded() : pattern;
+        if (!dirOnly)
+            lookupFile.add(kind, key);
+        return lookupDir.add(kind, key);
+    };
+
     auto regexAppend = [](QString &fileDirPattern, QString &dirPattern, const QString &appendMe, bool dirOnly) {
         QString &pattern = dirOnly ? dirPattern : fileDirPattern;
         if (!pattern.isEmpty())
@@ -756,6 +892,8 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
         auto &bnameDir = removeExcluded ? bnameDirRemove : bnameDirKeep;
         auto &fullFileDir = removeExcluded ? fullFileDirRemove : fullFileDirKeep;
         auto &fullDir = removeExcluded ? fullDirRemove : fullDirKeep;
+        auto &globFileDir = removeExcluded ? globFileDirRemove : globFileDirKeep;
+        auto &globDir = removeExcluded ? globDirRemove : globDirKeep;
 
         if (fullPath) {
             // The full pattern is matched against a path relative to _localPath, however exclude is
@@ -769,13 +907,17 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
         auto regexExclude = convertToRegexpSyntax(exclude, _wildcardsMatchSlash);
         if (!fullPath) {
             regexAppend(bnameFileDir, bnameDir, regexExclude, matchDirOnly);
+            if (!lookupAdd(removeExcluded ? BnameLookup::ExcludeRemove : BnameLookup::Exclude, exclude, matchDirOnly))
+                regexAppend(globFileDir, globDir, regexExclude, matchDirOnly);
         } else {
             regexAppend(fullFileDir, fullDir, regexExclude, matchDirOnly);
 
             // For activation, trigger on the 'bname' part of the full pattern.
             QString bnameExclude = extractBnameTrigger(exclude, _wildcardsMatchSlash);
-            auto regexBname = convertToRegexpSyntax(bnameExclude, true);
-            regexAppend(bnameTriggerFileDir, bnameTriggerDir, regexBname, matchDirOnly);
+            if (!lookupAdd(BnameLookup::Trigger, bnameExclude, matchDirOnly)) {
+                auto regexBname = convertToRegexpSyntax(bnameExclude, true);
+                regexAppend(bnameTriggerFileDir, bnameTriggerDir, regexBname, matchDirOnly);
+            }
         }
     }
 
@@ -794,6 +936,11 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
     emptyMatchNothing(bnameDirKeep);
     emptyMatchNothing(bnameDirRemove);
 
+    emptyMatchNothing(globFileDirKeep);
+    emptyMatchNothing(globFileDirRemove);
+    emptyMatchNothing(globDirKeep);
+    emptyMatchNothing(globDirRemove);
+
     emptyMatchNothing(bnameTriggerFileDir);
     emptyMatchNothing(bnameTriggerDir);
 
@@ -806,12 +953,12 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
         QStringLiteral("^(?P<exclude>%1)$|"
                        "^(?P<excluderemove>%2)$|"
                        "^(?P<trigger>%3)$")
-            .arg(bnameFileDirKeep, bnameFileDirRemove, bnameTriggerFileDir));
+            .arg(globFileDirKeep, globFileDirRemove, bnameTriggerFileDir));
     _bnameTraversalRegexDir[basePath].setPattern(
         QStringLiteral("^(?P<exclude>%1|%2)$|"
                        "^(?P<excluderemove>%3|%4)$|"
                        "^(?P<trigger>%5|%6)$")
-            .arg(bnameFileDirKeep, bnameDirKeep, bnameFileDirRemove, bnameDirRemove, bnameTriggerFileDir, bnameTriggerDir));
+            .arg(globFileDirKeep, globDirKeep, globFileDirRemove, globDirRemove, bnameTriggerFileDir, bnameTriggerDir));
 
     // The full traveral regex is applied to the full path if the trigger capture of
     // the bname regex matches. Its basic form is (exclude)|(excluderemove)".
@@ -25,9 +25,11 @@
 
 #include "csync.h"
 
+#include <QHash>
 #include <QObject>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QRegularExpression>
 
 #include <functional>
@@ -126,6 +128,13 @@ public:
      */
     void setClientVersion(Version version);
 
+    /**
+     * Hash over all active exclude patterns and matching options.
+     *
+     * Changes whenever files may be excluded differently than before.
+     */
+    [[nodiscard]] QByteArray rulesFingerprint() const;
+
     /**
      * @brief Check if the given path should be excluded in a traversal situation.
      *
@@ -226,6 +235,11 @@ private:
      * Note: The traversal matcher will return not-excluded on some paths that the
      * full matcher would exclude. Example: "b" is excluded. traversal("b/c")
      * returns not-excluded because "c" isn't a bname activation pattern.
+     *
+     * Most bname patterns are plain names ("Thumbs.db"), prefixes (".nfs*") or
+     * suffixes ("*.part"). These are put into _bnameLookupFile/_bnameLookupDir
+     * and checked with hash lookups; only the remaining glob patterns end up in
+     * _bnameTraversalRegexFile/_bnameTraversalRegexDir.
      */
     void prepare(const BasePathString &basePath);
 
@@ -234,6 +248,45 @@ private:
     static QString extractBnameTrigger(const QString &exclude, bool wildcardsMatchSlash);
     static QString convertToRegexpSyntax(QString exclude, bool wildcardsMatchSlash);
 
+    /**
+     * Plain name, prefix and suffix bname patterns of one base path, see prepare().
+     */
+    struct BnameLookup
+    {
+        enum Kind {
+            Exclude,
+            ExcludeRemove,
+            Trigger,
+            KindCount
+        };
+
+        /// Returns false if the pattern is a glob that needs the regex
+        bool add(Kind kind, const QString &pattern);
+        [[nodiscard]] bool contains(Kind kind, const QString &bname) const;
+
+        QSet<QString> _names[KindCount];
+        QSet<QString> _prefixes[KindCount];
+        QSet<QString> _suffixes[KindCount];
+        QList<qsizetype> _prefixLengths;
+        QList<qsizetype> _suffixLengths;
+        bool _hasGlobs = false;
+    };
+
+    /**
+     * What traversalPatternMatch() needs to know about the parent directory
+     * of an item. Cached in _directoryRules.
+     */
+    struct DirectoryRules
+    {
+        /// Base paths with exclude patterns that apply to the directory, deepest first
+        QStringList _basePaths;
+        /// Whether any full path pattern may match below the directory
+        bool _fullPatternsFile = true;
+        bool _fullPatternsDir = true;
+    };
+
+    const DirectoryRules &directoryRules(const QString &parentPath);
+
     QString _localPath;
 
     /// Files to load excludes from
@@ -246,6 +299,8 @@ private:
     QMap<BasePathString, QStringList> _allExcludes;
 
     /// see prepare()
+    QMap<BasePathString, BnameLookup> _bnameLookupFile;
+    QMap<BasePathString, BnameLookup> _bnameLookupDir;
     QMap<BasePathString, QRegularExpression> _bnameTraversalRegexFile;
     QMap<BasePathString, QRegularExpression> _bnameTraversalRegexDir;
     QMap<BasePathString, QRegularExpression> _fullTraversalRegexFile;
@@ -253,6 +308,12 @@ private:
     QMap<BasePathString, QRegularExpression> _fullRegexFile;
     QMap<BasePathString, QRegularExpression> _fullRegexDir;
 
+    /// Per directory verdicts keyed by folder-relative path, cleared by prepare()
+    QHash<QString, DirectoryRules> _directoryRules;
+
+    /// Whether bname matching folds case, like the regexes do on case preserving file systems
+    bool _caseInsensitive = false;
+
     bool _excludeConflictFiles = true;
 
     /**
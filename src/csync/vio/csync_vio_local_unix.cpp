@@ -24,6 +24,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <dirent.h>
+#include <unistd.h>
 #include <cstdio>
 
 #include <memory>
@@ -38,83 +39,151 @@
 #include <QtCore/QLoggingCategory>
 #include <QtCore/QFile>
 
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
 Q_LOGGING_CATEGORY(lcCSyncVIOLocal, "nextcloud.sync.csync.vio_local", QtInfoMsg)
 
 /*
  * directory functions
  */
 
+#ifdef Q_OS_LINUX
+// Room for several hundred entries per getdents64 call
+static constexpr long direntBufferSize = 32 * 1024;
+#endif
+
 struct csync_vio_handle_t {
-  DIR *dh;
-  QByteArray path;
+#ifdef Q_OS_LINUX
+  // Entries from the last getdents64 call, read one by one by readdir
+  std::unique_ptr<char[]> buffer;
+  long bufferSize = 0;
+  long bufferOffset = 0;
+#else
+  DIR *dh = nullptr;
+#endif
+  // path and fd of the directory, also handed to the vfs
+  OCC::LocalDirectoryStatData dir;
 };
 
 static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf);
+static int _csync_vio_local_stat_at(int dirfd, const char *name, csync_file_stat_t *buf);
 
 csync_vio_handle_t *csync_vio_local_opendir(const QString &name) {
     auto handle = std::make_unique<csync_vio_handle_t>();
     auto dirname = QFile::encodeName(name);
 
-    handle->dh = _topendir(dirname.constData());
+    handle->dir.fd = open(dirname.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (handle->dir.fd < 0) {
+        return nullptr;
+    }
+
+#ifdef Q_OS_LINUX
+    handle->buffer = std::make_unique<char[]>(direntBufferSize);
+#else
+    handle->dh = fdopendir(handle->dir.fd);
     if (!handle->dh) {
+        const auto error = errno;
+        close(handle->dir.fd);
+        errno = error;
         return nullptr;
     }
+#endif
 
-    handle->path = dirname;
+    handle->dir.path = dirname;
     return handle.release();
 }
 
 int csync_vio_local_closedir(csync_vio_handle_t *dhandle) {
     Q_ASSERT(dhandle);
-    auto rc = _tclosedir(dhandle->dh);
+#ifdef Q_OS_LINUX
+    auto rc = close(dhandle->dir.fd);
+#else
+    // also closes dir.fd
+    auto rc = closedir(dhandle->dh);
+#endif
     delete dhandle;
     return rc;
 }
 
+/* Returns false at the end of the directory, or on error with errno set */
+static bool _csync_vio_local_next_entry(csync_vio_handle_t *handle, const char **name, unsigned char *type)
+{
+#ifdef Q_OS_LINUX
+    if (handle->bufferOffset >= handle->bufferSize) {
+        const auto count = syscall(SYS_getdents64, handle->dir.fd, handle->buffer.get(), direntBufferSize);
+        if (count <= 0) {
+            return false;
+        }
+        handle->bufferSize = count;
+        handle->bufferOffset = 0;
+    }
+
+    const auto entry = reinterpret_cast<const struct dirent64 *>(handle->buffer.get() + handle->bufferOffset);
+    handle->bufferOffset += entry->d_reclen;
+    *name = entry->d_name;
+    *type = entry->d_type;
+#else
+    const auto entry = readdir(handle->dh);
+    if (!entry) {
+        return false;
+    }
+    *name = entry->d_name;
+    /* Check for availability of d_type, see manpage. */
+#if defined(_DIRENT_HAVE_D_TYPE) || defined(__APPLE__)
+    *type = entry->d_type;
+#else
+    *type = 0;
+#endif
+#endif
+    return true;
+}
+
 std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *handle, OCC::Vfs *vfs) {
 
-  struct _tdirent *dirent = nullptr;
+  const char *name = nullptr;
+  unsigned char type = 0;
   std::unique_ptr<csync_file_stat_t> file_stat;
 
   do {
-      dirent = _treaddir(handle->dh);
-      if (!dirent)
+      if (!_csync_vio_local_next_entry(handle, &name, &type))
           return {};
-  } while (qstrcmp(dirent->d_name, ".") == 0 || qstrcmp(dirent->d_name, "..") == 0);
+  } while (qstrcmp(name, ".") == 0 || qstrcmp(name, "..") == 0);
 
   file_stat = std::make_unique<csync_file_stat_t>();
-  file_stat->path = QFile::decodeName(dirent->d_name).toUtf8();
-  QByteArray fullPath = handle->path % '/' % QByteArray() % const_cast<const char *>(dirent->d_name);
+  file_stat->path = QFile::decodeName(name).toUtf8();
   if (file_stat->path.isNull()) {
-      file_stat->original_path = fullPath;
-      qCWarning(lcCSyncVIOLocal) << "Invalid characters in file/directory name, please rename:" << dirent->d_name << handle->path;
+      file_stat->original_path = handle->dir.path % '/' % QByteArray() % name;
+      qCWarning(lcCSyncVIOLocal) << "Invalid characters in file/directory name, please rename:" << name << handle->dir.path;
   }
 
-  /* Check for availability of d_type, see manpage. */
-#if defined(_DIRENT_HAVE_D_TYPE) || defined(__APPLE__)
-  switch (dirent->d_type) {
+#if defined(Q_OS_LINUX) || defined(_DIRENT_HAVE_D_TYPE) || defined(__APPLE__)
+  switch (type) {
     case DT_FIFO:
     case DT_SOCK:
     case DT_CHR:
     case DT_BLK:
+      // Never synced, no need to stat them
+      file_stat->type = ItemTypeSkip;
       break;
     case DT_DIR:
+      file_stat->type = ItemTypeDirectory;
+      break;
     case DT_REG:
-      if (dirent->d_type == DT_DIR) {
-        file_stat->type = ItemTypeDirectory;
-      } else {
-        file_stat->type = ItemTypeFile;
-      }
+      file_stat->type = ItemTypeFile;
       break;
     default:
       break;
   }
 #endif
 
-  if (file_stat->path.isNull())
+  if (file_stat->path.isNull() || file_stat->type == ItemTypeSkip)
       return file_stat;
 
-  if (_csync_vio_local_stat_mb(fullPath.constData(), file_stat.get()) < 0) {
+  // Discovery needs the inode, size and mtime, so files and directories are still stat'ed,
+  // but relative to the directory fd instead of by full path
+  if (_csync_vio_local_stat_at(handle->dir.fd, name, file_stat.get()) < 0) {
       // Will get excluded by _csync_detect_update.
       file_stat->type = ItemTypeSkip;
   }
@@ -123,7 +192,7 @@ std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *h
   if (vfs) {
       // Directly modifies file_stat->type.
       // We can ignore the return value since we're done here anyway.
-      const auto result = vfs->statTypeVirtualFile(file_stat.get(), &handle->path);
+      const auto result = vfs->statTypeVirtualFile(file_stat.get(), &handle->dir);
       Q_UNUSED(result)
   }
 
@@ -136,14 +205,8 @@ int csync_vio_local_stat(const QString &uri, csync_file_stat_t *buf)
     return _csync_vio_local_stat_mb(QFile::encodeName(uri).constData(), buf);
 }
 
-static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf)
+static void _csync_vio_local_fill_stat(const csync_stat_t &sb, csync_file_stat_t *buf)
 {
-    csync_stat_t sb;
-
-    if (_tstat(wuri, &sb) < 0) {
-        return -1;
-    }
-
     switch (sb.st_mode & S_IFMT) {
     case S_IFDIR:
       buf->type = ItemTypeDirectory;
@@ -170,6 +233,28 @@ static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf
   buf->modtime = sb.st_mtime;
   buf->size = sb.st_size;
   buf->isPermissionsInvalid = (sb.st_mode & S_IWOTH) == S_IWOTH;
+}
+
+static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf)
+{
+    csync_stat_t sb;
+
+    if (_tstat(wuri, &sb) < 0) {
+        return -1;
+    }
+
+    _csync_vio_local_fill_stat(sb, buf);
+    return 0;
+}
+
+static int _csync_vio_local_stat_at(int dirfd, const char *name, csync_file_stat_t *buf)
+{
+    csync_stat_t sb;
+
+    if (fstatat(dirfd, name, &sb, AT_SYMLINK_NOFOLLOW) < 0) {
+        return -1;
+    }
 
-  return 0;
+    _csync_vio_local_fill_stat(sb, buf);
+    return 0;
 }
@@ -741,6 +741,8 @@ void Application::setupLogging()
 
     logger->enterNextLogFile(QStringLiteral("nextcloud.log"), OCC::Logger::LogType::Log);
     logger->enterNextLogFile(QStringLiteral("permanent_delete.log"), OCC::Logger::LogType::DeleteLog);
+    // keep disk writes and log rotation off the threads that log
+    logger->setAsyncLogging(true);
 
     qCInfo(lcApplication) << "##################" << _theme->appName()
                           << "locale:" << QLocale::system().name()
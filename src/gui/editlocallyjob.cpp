@@ -537,7 +537,7 @@ void EditLocallyJob::fileLockSuccess(const SyncFileItemPtr &item)
 {
     qCDebug(lcEditLocallyJob()) << "File lock succeeded, showing notification" << _relPath;
 
-    const auto remainingTimeInMinutes = fileLockTimeRemainingMinutes(item->_lockTime, item->_lockTimeout);
+    const auto remainingTimeInMinutes = fileLockTimeRemainingMinutes(item->lockTime(), item->lockTimeout());
     fileLockProcedureComplete(tr("File %1 now locked.").arg(_fileName),
                               tr("Lock will last for %1 minutes. "
                                  "You can also unlock this file manually once you are finished editing.").arg(remainingTimeInMinutes),
@@ -1123,7 +1123,8 @@ void Folder::startSync(const QStringList &pathList)
         _localDiscoveryTracker->startSyncPartialDiscovery();
     } else {
         qCInfo(lcFolder) << "Forbidding local discovery to read from the database";
-        _engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::FilesystemOnly);
+        // The paths still tell discovery which directories can't take the unchanged-directory shortcut
+        _engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::FilesystemOnly, _localDiscoveryTracker->localDiscoveryPaths());
         _localDiscoveryTracker->startSyncFullDiscovery();
     }
 
@@ -1575,6 +1576,19 @@ void Folder::slotWatcherUnreliable(const QString &message)
     Logger::instance()->postGuiLog(Theme::instance()->appNameGUI(), fullMessage);
 }
 
+void Folder::slotWatcherLostChangesBelow(const QStringList &paths)
+{
+    for (const auto &changedPath : paths) {
+        // The watcher reports directories without trailing slash
+        if (!changedPath.startsWith(path())) {
+            slotNextSyncFullLocalDiscovery();
+            break;
+        }
+        schedulePathForLocalDiscovery(changedPath.mid(path().size()));
+    }
+    scheduleThisFolderSoon();
+}
+
 void Folder::slotHydrationStarts()
 {
     // Abort any running full sync run and reschedule
@@ -1662,6 +1676,8 @@ void Folder::registerFolderWatcher()
         this, [this](const QString &path) { slotWatchedPathChanged(path, Folder::ChangeReason::Other); });
     connect(_folderWatcher.data(), &FolderWatcher::lostChanges,
         this, &Folder::slotNextSyncFullLocalDiscovery);
+    connect(_folderWatcher.data(), &FolderWatcher::lostChangesBelow,
+        this, &Folder::slotWatcherLostChangesBelow);
     connect(_folderWatcher.data(), &FolderWatcher::becameUnreliable,
         this, &Folder::slotWatcherUnreliable);
     if (_accountState->account()->capabilities().filesLockAvailable()) {
@@ -1681,6 +1697,7 @@ void Folder::disconnectFolderWatcher()
     }
     disconnect(_folderWatcher.data(), &FolderWatcher::pathChanged, nullptr, nullptr);
     disconnect(_folderWatcher.data(), &FolderWatcher::lostChanges, this, &Folder::slotNextSyncFullLocalDiscovery);
+    disconnect(_folderWatcher.data(), &FolderWatcher::lostChangesBelow, this, &Folder::slotWatcherLostChangesBelow);
     disconnect(_folderWatcher.data(), &FolderWatcher::becameUnreliable, this, &Folder::slotWatcherUnreliable);
     if (_accountState->account()->capabilities().filesLockAvailable()) {
         disconnect(_folderWatcher.data(), &FolderWatcher::filesLockReleased, this, &Folder::slotFilesLockReleased);
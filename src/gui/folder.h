@@ -453,6 +453,9 @@ private slots:
     /** Warn users about an unreliable folder watcher */
     void slotWatcherUnreliable(const QString &message);
 
+    /** Schedules local discovery below the directories the watcher lost changes for */
+    void slotWatcherLostChangesBelow(const QStringList &paths);
+
     /** Aborts any running sync and blocks it until hydration is finished.
      *
      * Hydration circumvents the regular SyncEngine and both mustn't be running
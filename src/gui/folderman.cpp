@@ -76,6 +76,10 @@ FolderMan::FolderMan(QObject *parent)
     QObject::connect(&_etagPollTimer, &QTimer::timeout, this, &FolderMan::slotEtagPollTimerTimeout);
     _etagPollTimer.start();
 
+    _maxConcurrentSyncs = cfg.maxConcurrentFolderSyncs();
+    _maxConcurrentSyncsPerAccount = cfg.maxConcurrentFolderSyncsPerAccount();
+    qCInfo(lcFolderMan) << "syncing up to" << _maxConcurrentSyncs << "folders at once," << _maxConcurrentSyncsPerAccount << "per account";
+
     _startScheduledSyncTimer.setSingleShot(true);
     connect(&_startScheduledSyncTimer, &QTimer::timeout,
         this, &FolderMan::slotStartScheduledFolderSync);
@@ -123,6 +127,7 @@ void FolderMan::unloadFolder(Folder *f)
     _socketApi->slotUnregisterPath(f->alias());
 
     _folderMap.remove(f->alias());
+    _currentSyncFolders.remove(f);
 
     disconnect(f, &Folder::syncStarted,
         this, &FolderMan::slotFolderSyncStarted);
@@ -154,7 +159,7 @@ int FolderMan::unloadAndDeleteAllFolders()
     ASSERT(_folderMap.isEmpty());
 
     _lastSyncFolder = nullptr;
-    _currentSyncFolder = nullptr;
+    _currentSyncFolders.clear();
     _scheduledFolders.clear();
     emit folderListChanged(_folderMap);
     emit scheduleQueueChanged();
@@ -894,7 +899,7 @@ void FolderMan::startScheduledSyncSoon()
     if (_scheduledFolders.empty()) {
         return;
     }
-    if (isAnySyncRunning()) {
+    if (runningSyncFolders().size() >= _maxConcurrentSyncs) {
         return;
     }
 
@@ -938,14 +943,6 @@ void FolderMan::startScheduledSyncSoon()
   */
 void FolderMan::slotStartScheduledFolderSync()
 {
-    if (isAnySyncRunning()) {
-        for (auto f : std::as_const(_folderMap)) {
-            if (f->isSyncRunning())
-                qCInfo(lcFolderMan) << "Currently folder " << f->remoteUrl().toString() << " is running, wait for finish!";
-        }
-        return;
-    }
-
     if (!_syncEnabled) {
         qCInfo(lcFolderMan) << "FolderMan: Syncing is disabled, no scheduling.";
         return;
@@ -956,26 +953,39 @@ void FolderMan::slotStartScheduledFolderSync()
         return;
     }
 
-    // Find the first folder in the queue that can be synced.
-    Folder *folder = nullptr;
-    while (!_scheduledFolders.isEmpty()) {
-        Folder *g = _scheduledFolders.dequeue();
-        if (g->canSync()) {
-            folder = g;
+    // Pick the folders to start in the order of the queue. A folder that has to wait
+    // for the syncs of its account keeps its place, so it goes first once they finished.
+    QList<Folder *> foldersToStart;
+    for (auto it = _scheduledFolders.begin(); it != _scheduledFolders.end();) {
+        if (runningSyncFolders().size() >= _maxConcurrentSyncs) {
             break;
         }
+
+        const auto folder = *it;
+        if (!folder->canSync()) {
+            it = _scheduledFolders.erase(it);
+            continue;
+        }
+        if (!hasFreeSyncSlot(folder)) {
+            qCInfo(lcFolderMan) << "Folder" << folder->alias() << "waits for a running sync to finish";
+            ++it;
+            continue;
+        }
+
+        // Takes the slot right away, the next folders of the queue have to see it
+        _currentSyncFolders.insert(folder);
+        foldersToStart.append(folder);
+        it = _scheduledFolders.erase(it);
     }
 
     emit scheduleQueueChanged();
 
-    // Start syncing this folder!
-    if (folder) {
+    for (const auto folder : std::as_const(foldersToStart)) {
         // Safe to call several times, and necessary to try again if
         // the folder path didn't exist previously.
         folder->registerFolderWatcher();
         registerFolderWithSocketApi(folder);
 
-        _currentSyncFolder = folder;
         folder->startSync(QStringList());
     }
 }
@@ -1174,7 +1184,7 @@ void FolderMan::slotScheduleFolderByTime()
 
 bool FolderMan::isAnySyncRunning() const
 {
-    if (_currentSyncFolder)
+    if (!_currentSyncFolders.isEmpty())
         return true;
 
     for (auto f : _folderMap) {
@@ -1215,12 +1225,48 @@ void FolderMan::slotFolderSyncFinished(const SyncResult &)
         qPrintable(f->accountState()->account()->displayName()),
         qPrintable(f->remoteUrl().toString()));
 
-    if (f == _currentSyncFolder) {
-        _lastSyncFolder = _currentSyncFolder;
-        _currentSyncFolder = nullptr;
+    if (_currentSyncFolders.remove(f)) {
+        _lastSyncFolder = f;
     }
-    if (!isAnySyncRunning())
-        startScheduledSyncSoon();
+    // Folders that waited for this one may start now
+    startScheduledSyncSoon();
+}
+
+QList<Folder *> FolderMan::runningSyncFolders() const
+{
+    QList<Folder *> result;
+    for (const auto folder : std::as_const(_folderMap)) {
+        if (_currentSyncFolders.contains(folder) || folder->isSyncRunning()) {
+            result.append(folder);
+        }
+    }
+    return result;
+}
+
+bool FolderMan::hasFreeSyncSlot(const Folder *folder) const
+{
+    const auto runningFolders = runningSyncFolders();
+    if (runningFolders.size() >= _maxConcurrentSyncs) {
+        return false;
+    }
+
+    const auto caseSensitivity = (Utility::isWindows() || Utility::isMac()) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+    const auto folderPath = folder->cleanPath() + QLatin1Char('/');
+    auto runningForAccount = 0;
+    for (const auto runningFolder : runningFolders) {
+        if (runningFolder == folder) {
+            return false;
+        }
+        // Different accounts may sync into the same or nested local paths
+        const auto runningPath = runningFolder->cleanPath() + QLatin1Char('/');
+        if (folderPath.startsWith(runningPath, caseSensitivity) || runningPath.startsWith(folderPath, caseSensitivity)) {
+            return false;
+        }
+        if (runningFolder->accountState() == folder->accountState()) {
+            ++runningForAccount;
+        }
+    }
+    return runningForAccount < _maxConcurrentSyncsPerAccount;
 }
 
 Folder *FolderMan::addFolder(AccountState *accountState, const FolderDefinition &folderDefinition)
@@ -1512,10 +1558,10 @@ void FolderMan::slotWipeFolderForAccount(AccountState *accountState)
 
         qCInfo(lcFolderMan) << "Removing " << f->alias();
 
-        const bool currentlyRunning = (_currentSyncFolder == f);
+        const bool currentlyRunning = _currentSyncFolders.contains(f);
         if (currentlyRunning) {
             // abort the sync now
-            _currentSyncFolder->slotTerminateSync();
+            f->slotTerminateSync();
         }
 
         if (_scheduledFolders.removeAll(f) > 0) {
@@ -2021,9 +2067,9 @@ QQueue<Folder *> FolderMan::scheduleQueue() const
     return _scheduledFolders;
 }
 
-Folder *FolderMan::currentSyncFolder() const
+QList<Folder *> FolderMan::currentSyncFolders() const
 {
-    return _currentSyncFolder;
+    return _currentSyncFolders.values();
 }
 
 void FolderMan::restartApplication()
@@ -187,14 +187,22 @@ public:
     [[nodiscard]] QQueue<Folder *> scheduleQueue() const;
 
     /**
-     * Access to the currently syncing folder.
+     * Access to the currently syncing folders.
      *
-     * Note: This is only the folder that's currently syncing *as-scheduled*. There
+     * Note: These are only the folders that are currently syncing *as-scheduled*. There
      * may be externally-managed syncs such as from placeholder hydrations.
      *
      * See also isAnySyncRunning()
      */
-    [[nodiscard]] Folder *currentSyncFolder() const;
+    [[nodiscard]] QList<Folder *> currentSyncFolders() const;
+
+    /**
+     * Whether a scheduled sync of @a folder could start next to the running syncs.
+     *
+     * Folders sync concurrently up to a global and a per-account limit. Folders whose
+     * local paths overlap never sync at the same time.
+     */
+    [[nodiscard]] bool hasFreeSyncSlot(const Folder *folder) const;
 
     /**
      * Returns true if any folder is currently syncing.
@@ -209,7 +217,7 @@ public:
 
     /**
      * If enabled is set to false, no new folders will start to sync.
-     * The current one will finish.
+     * The running ones will finish.
      */
     void setSyncEnabled(bool);
 
@@ -366,6 +374,9 @@ private:
 
     bool pushNotificationsFilesReady(Account *account);
 
+    /// The folders with a scheduled or externally-managed sync running
+    [[nodiscard]] QList<Folder *> runningSyncFolders() const;
+
     [[nodiscard]] bool isSwitchToVfsNeeded(const FolderDefinition &folderDefinition) const;
 
     void addFolderToSelectiveSyncList(const QString &path, const SyncJournalDb::SelectiveSyncListType list);
@@ -373,8 +384,10 @@ private:
     QSet<Folder *> _disabledFolders;
     Folder::Map _folderMap;
     QString _folderConfigPath;
-    Folder *_currentSyncFolder = nullptr;
+    QSet<Folder *> _currentSyncFolders;
     QPointer<Folder> _lastSyncFolder;
+    int _maxConcurrentSyncs = 1;
+    int _maxConcurrentSyncsPerAccount = 1;
     bool _syncEnabled = true;
 
     /// Folder aliases from the settings that weren't read
@@ -1181,9 +1181,12 @@ void FolderStatusModel::slotFolderSyncStateChange(Folder *folder)
     } else if (state == SyncResult::NotYetStarted) {
         const auto folderMan = FolderMan::instance();
         auto pos = folderMan->scheduleQueue().indexOf(folder);
-        for (auto other : folderMan->map()) {
-            if (other != folder && other->isSyncRunning()) {
-                pos += 1;
+        // Several folders sync at once, the running ones only hold this one back once the slots are taken
+        if (!folderMan->hasFreeSyncSlot(folder)) {
+            for (auto other : folderMan->map()) {
+                if (other != folder && other->isSyncRunning()) {
+                    pos += 1;
+                }
             }
         }
         const auto message = pos <= 0 ? tr("About to start syncing") : tr("Waiting for %n other folder(s) …", "", pos);
@@ -36,12 +36,18 @@
 #include <QMutexLocker>
 #include <QStringList>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <utility>
 
 namespace
 {
 constexpr auto lockChangeDebouncingTimerIntervalMs = 500;
+/// Changes are collected for this long before they are reported
+constexpr auto coalescingWindowMs = 100;
+/// More changed entries than this in one directory are reported as a change of the directory
+constexpr auto maximumChangesPerDirectory = 100;
 }
 
 namespace OCC {
@@ -54,6 +60,10 @@ FolderWatcher::FolderWatcher(Folder *folder)
 {
     _lockChangeDebouncingTimer.setInterval(lockChangeDebouncingTimerIntervalMs);
 
+    _coalescingTimer.setInterval(coalescingWindowMs);
+    _coalescingTimer.setSingleShot(true);
+    connect(&_coalescingTimer, &QTimer::timeout, this, &FolderWatcher::flushPendingChanges);
+
     if (_folder && _folder->accountState() && _folder->accountState()->account()) {
         connect(_folder->accountState()->account().data(), &Account::capabilitiesChanged, this, &FolderWatcher::folderAccountCapabilitiesChanged);
         folderAccountCapabilitiesChanged();
@@ -64,6 +74,7 @@ FolderWatcher::~FolderWatcher() = default;
 
 void FolderWatcher::init(const QString &root)
 {
+    _rootPath = QDir(root).absolutePath();
     _d.reset(new FolderWatcherPrivate(this, root));
     _timer.start();
 }
@@ -149,6 +160,11 @@ void FolderWatcher::lockChangeDebouncingTimerTimedOut()
     }
 }
 
+FolderWatcher::Statistics FolderWatcher::statistics() const
+{
+    return _statistics;
+}
+
 int FolderWatcher::testLinuxWatchCount() const
 {
 #ifdef Q_OS_LINUX
@@ -162,6 +178,8 @@ void FolderWatcher::slotLockFileDetectedExternally(const QString &lockFile)
 {
     qCInfo(lcFolderWatcher) << "Lock file detected externally, probably a newly-uploaded office file: " << lockFile;
     changeDetected(lockFile);
+    // Not a file system event, no need to wait for more
+    flushPendingChanges();
 }
 
 void FolderWatcher::setShouldWatchForFileUnlocking(bool shouldWatchForFileUnlocking)
@@ -176,63 +194,72 @@ int FolderWatcher::lockChangeDebouncingTimout() const
 
 void FolderWatcher::changeDetected(const QString &path)
 {
-    QStringList paths(path);
-    if (FileSystem::isDir(path)) {
-        QDir dir(path);
-        appendSubPaths(dir, paths);
+    changeDetected(path, ChangeType::Modified);
+}
+
+void FolderWatcher::changeDetected(const QString &path, ChangeType type)
+{
+    queueChange(path, type);
+    if (type != ChangeType::Removed && FileSystem::isDir(path)) {
+        QStringList subPaths;
+        appendSubPaths(QDir(path), subPaths);
+        for (const auto &subPath : std::as_const(subPaths)) {
+            queueChange(subPath, ChangeType::Modified);
+        }
     }
-    changeDetected(paths);
+    startCoalescing();
 }
 
 void FolderWatcher::changeDetected(const QStringList &paths)
 {
-    // TODO: this shortcut doesn't look very reliable:
-    //   - why is the timeout only 1 second?
-    //   - what if there is more than one file being updated frequently?
-    //   - why do we skip the file altogether instead of e.g. reducing the upload frequency?
-
-    // Check if the same path was reported within the last second.
-    const auto pathsSet = QSet<QString>{paths.begin(), paths.end()};
-    if (pathsSet == _lastPaths && _timer.elapsed() < 1000) {
-        // the same path was reported within the last second. Skip.
-        return;
+    for (const auto &path : paths) {
+        queueChange(path, ChangeType::Modified);
     }
-    _lastPaths = pathsSet;
-    _timer.restart();
+    startCoalescing();
+}
 
-    QSet<QString> changedPaths;
+void FolderWatcher::queueChange(const QString &path, ChangeType type)
+{
+    ++_statistics.rawEvents;
 
-    for (const auto &path : paths) {
-        if (!_testNotificationPath.isEmpty()
-            && Utility::fileNamesEqual(path, _testNotificationPath)) {
-            _testNotificationPath.clear();
-        }
+    if (!_testNotificationPath.isEmpty()
+        && Utility::fileNamesEqual(path, _testNotificationPath)) {
+        _testNotificationPath.clear();
+    }
 
-        const auto lockFileNamePattern = FileSystem::filePathLockFilePatternMatch(path);
-        const auto checkResult = FileSystem::lockFileTargetFilePath(path, lockFileNamePattern);
-        if (_shouldWatchForFileUnlocking) {
-            // Lock file has been deleted, file now unlocked
-            if (checkResult.type == FileSystem::FileLockingInfo::Type::Unlocked && !checkResult.path.isEmpty()) {
-                _lockedFiles.remove(checkResult.path);
-                _unlockedFiles.insert(checkResult.path);
-            }
+    const auto lockFileNamePattern = FileSystem::filePathLockFilePatternMatch(path);
+    const auto checkResult = FileSystem::lockFileTargetFilePath(path, lockFileNamePattern);
+    if (_shouldWatchForFileUnlocking) {
+        // Lock file has been deleted, file now unlocked
+        if (checkResult.type == FileSystem::FileLockingInfo::Type::Unlocked && !checkResult.path.isEmpty()) {
+            _lockedFiles.remove(checkResult.path);
+            _unlockedFiles.insert(checkResult.path);
         }
+    }
 
-        if (checkResult.type == FileSystem::FileLockingInfo::Type::Locked && !checkResult.path.isEmpty()) {
-            _unlockedFiles.remove(checkResult.path);
-            _lockedFiles.insert(checkResult.path);
-        }
+    if (checkResult.type == FileSystem::FileLockingInfo::Type::Locked && !checkResult.path.isEmpty()) {
+        _unlockedFiles.remove(checkResult.path);
+        _lockedFiles.insert(checkResult.path);
+    }
 
-        qCDebug(lcFolderWatcher) << "Locked files:" << _lockedFiles.values();
+    qCDebug(lcFolderWatcher) << "Locked files:" << _lockedFiles.values();
 
-        // ------- handle ignores:
-        if (pathIsIgnored(path)) {
-            continue;
-        }
+    // ------- handle ignores:
+    if (pathIsIgnored(path)) {
+        return;
+    }
 
-        changedPaths.insert(path);
+    const auto it = _pendingChanges.find(path);
+    if (it == _pendingChanges.end()) {
+        _pendingChanges.insert(path, {type == ChangeType::Created, type == ChangeType::Removed});
+    } else {
+        ++_statistics.coalescedEvents;
+        it->_removedLast = type == ChangeType::Removed;
     }
+}
 
+void FolderWatcher::startCoalescing()
+{
     qCDebug(lcFolderWatcher) << "Unlocked files:" << _unlockedFiles.values();
     qCDebug(lcFolderWatcher) << "Locked files:" << _lockedFiles;
 
@@ -245,16 +272,108 @@ void FolderWatcher::changeDetected(const QStringList &paths)
         _lockChangeDebouncingTimer.connect(&_lockChangeDebouncingTimer, &QTimer::timeout, this, &FolderWatcher::lockChangeDebouncingTimerTimedOut, Qt::UniqueConnection);
     }
 
+    if (!_pendingChanges.isEmpty() && !_coalescingTimer.isActive()) {
+        _coalescingTimer.start();
+    }
+}
+
+void FolderWatcher::flushPendingChanges()
+{
+    _coalescingTimer.stop();
+    const auto pendingChanges = std::exchange(_pendingChanges, {});
+
+    // Temporary files: created and removed again within the window,
+    // together with whatever was reported below them.
+    QSet<QString> churnedPaths;
+    for (auto it = pendingChanges.cbegin(); it != pendingChanges.cend(); ++it) {
+        if (it->_createdFirst && it->_removedLast) {
+            churnedPaths.insert(it.key());
+        }
+    }
+    auto isBelowChurnedPath = [&churnedPaths](const QString &path) {
+        for (auto slash = path.lastIndexOf(QLatin1Char('/')); slash > 0; slash = path.lastIndexOf(QLatin1Char('/'), slash - 1)) {
+            if (churnedPaths.contains(path.left(slash))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    QHash<QString, QStringList> changesByDirectory;
+    for (auto it = pendingChanges.cbegin(); it != pendingChanges.cend(); ++it) {
+        const auto &path = it.key();
+        if (churnedPaths.contains(path) || (!churnedPaths.isEmpty() && isBelowChurnedPath(path))) {
+            ++_statistics.droppedEvents;
+            continue;
+        }
+        changesByDirectory[path.left(path.lastIndexOf(QLatin1Char('/')))].append(path);
+    }
+
+    // The folder rediscovers a changed directory in full, so a directory
+    // with lots of changes is cheaper to report as a whole.
+    QSet<QString> changedPaths;
+    for (auto it = changesByDirectory.cbegin(); it != changesByDirectory.cend(); ++it) {
+        if (it->size() > maximumChangesPerDirectory && it.key().startsWith(_rootPath + QLatin1Char('/')) && canFoldChanges(*it)) {
+            _statistics.coalescedEvents += it->size() - 1;
+            changedPaths.insert(it.key());
+        } else {
+            for (const auto &path : *it) {
+                changedPaths.insert(path);
+            }
+        }
+    }
+
+    qCDebug(lcFolderWatcher) << "Coalesced changes, raw:" << _statistics.rawEvents
+                             << "coalesced:" << _statistics.coalescedEvents
+                             << "dropped:" << _statistics.droppedEvents;
+
     if (changedPaths.isEmpty()) {
         return;
     }
 
+    // TODO: this shortcut doesn't look very reliable:
+    //   - why is the timeout only 1 second?
+    //   - what if there is more than one file being updated frequently?
+    //   - why do we skip the file altogether instead of e.g. reducing the upload frequency?
+
+    // Check if the same path was reported within the last second.
+    if (changedPaths == _lastPaths && _timer.elapsed() < 1000) {
+        // the same path was reported within the last second. Skip.
+        return;
+    }
+    _lastPaths = changedPaths;
+    _timer.restart();
+
     qCInfo(lcFolderWatcher) << "Detected changes in paths:" << changedPaths;
-    for (const auto &path : changedPaths) {
+    for (const auto &path : std::as_const(changedPaths)) {
         emit pathChanged(path);
     }
 }
 
+bool FolderWatcher::canFoldChanges(const QStringList &paths) const
+{
+    if (!_folder) {
+        return true;
+    }
+
+    // Folder updates the pin states of the changed paths one by one
+    if (_folder->virtualFilesEnabled()) {
+        return false;
+    }
+
+#ifndef Q_OS_MAC
+    // Folder drops the changes done by its own sync per path, e.g. the files of a large
+    // download. Reported as a directory they would start another sync.
+    const auto &engine = _folder->syncEngine();
+    return std::none_of(paths.cbegin(), paths.cend(), [&engine](const QString &path) {
+        return engine.wasFileTouched(path);
+    });
+#else
+    // The macOS watcher doesn't report our own changes
+    return true;
+#endif
+}
+
 void FolderWatcher::folderAccountCapabilitiesChanged()
 {
     _shouldWatchForFileUnlocking = _folder->accountState()->account()->capabilities().filesLockAvailable();
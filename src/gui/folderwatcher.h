@@ -51,6 +51,25 @@ class FolderWatcher : public QObject
     Q_OBJECT
 
 public:
+    /// What happened to a path, as far as the platform implementation knows
+    enum class ChangeType {
+        Modified,
+        Created,
+        MovedIn,
+        Removed,
+    };
+
+    /// Counters of the event coalescing, see flushPendingChanges()
+    struct Statistics
+    {
+        /// Paths reported by the platform implementation
+        quint64 rawEvents = 0;
+        /// Paths merged into an already pending path or into their directory
+        quint64 coalescedEvents = 0;
+        /// Paths that were created and removed again within one window
+        quint64 droppedEvents = 0;
+    };
+
     // Construct, connect signals, call init()
     explicit FolderWatcher(Folder *folder = nullptr);
     ~FolderWatcher() override;
@@ -80,6 +99,8 @@ public:
     /// For testing linux behavior only
     [[nodiscard]] int testLinuxWatchCount() const;
 
+    [[nodiscard]] Statistics statistics() const;
+
     void slotLockFileDetectedExternally(const QString &lockFile);
 
     void setShouldWatchForFileUnlocking(bool shouldWatchForFileUnlocking);
@@ -112,6 +133,15 @@ signals:
      */
     void lostChanges();
 
+    /**
+     * Emitted if some notifications were lost, but only below the
+     * given directories.
+     *
+     * The directories and everything below them need local discovery,
+     * a full local discovery like after lostChanges() is not necessary.
+     */
+    void lostChangesBelow(const QStringList &paths);
+
     /**
      * Signals when the watcher became unreliable. The string is a translated
      * message that can be shown to users.
@@ -127,8 +157,11 @@ protected slots:
 private slots:
     void startNotificationTestWhenReady();
     void lockChangeDebouncingTimerTimedOut();
+    void flushPendingChanges();
 
 protected:
+    void changeDetected(const QString &path, OCC::FolderWatcher::ChangeType type);
+
     QHash<QString, int> _pendingPathes;
 
 private:
@@ -142,6 +175,12 @@ private:
 
     void appendSubPaths(QDir dir, QStringList& subPaths);
 
+    /// Handles lock files right away and remembers the path for flushPendingChanges()
+    void queueChange(const QString &path, ChangeType type);
+    void startCoalescing();
+    /// Whether the changes of one directory may be reported as a change of the directory
+    [[nodiscard]] bool canFoldChanges(const QStringList &paths) const;
+
     /* Check if the path should be ignored by the FolderWatcher. */
     [[nodiscard]] bool pathIsIgnored(const QString &path) const;
 
@@ -153,6 +192,18 @@ private:
 
     QTimer _lockChangeDebouncingTimer;
 
+    struct PendingChange
+    {
+        bool _createdFirst = false;
+        bool _removedLast = false;
+    };
+
+    /// Changes collected during the current coalescing window
+    QHash<QString, PendingChange> _pendingChanges;
+    QTimer _coalescingTimer;
+    QString _rootPath;
+    Statistics _statistics;
+
     friend class FolderWatcherPrivate;
 };
 }
@@ -15,34 +15,211 @@
 #include "config.h"
 
 #include <sys/inotify.h>
+#include <sys/fanotify.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "folder.h"
 #include "folderwatcher_linux.h"
 
 #include <cerrno>
+#include <climits>
 #include <QStringList>
 #include <QObject>
 #include <QVarLengthArray>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace {
+/// How long directories with events are remembered for processQueueOverflow()
+constexpr auto recentChangesWindowMs = 10 * 1000;
+/// Above this many recently changed directories an overflow triggers a full local discovery
+constexpr auto maximumOverflowSubtrees = 100;
+/// Upper bound for cached fanotify directory handles
+constexpr auto maximumCachedHandles = 10000;
+}
 
 namespace OCC {
 
 FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path)
     : QObject()
     , _parent(p)
-    , _folder(path)
+    , _folder(QDir(path).absolutePath())
 {
+#if defined(FAN_REPORT_DFID_NAME)
+    if (initFanotify(path)) {
+        return;
+    }
+#endif
+
     _fd = inotify_init();
     if (_fd != -1) {
         _socket.reset(new QSocketNotifier(_fd, QSocketNotifier::Read));
         connect(_socket.data(), &QSocketNotifier::activated, this, &FolderWatcherPrivate::slotReceivedNotification);
     } else {
         qCWarning(lcFolderWatcher) << "notify_init() failed: " << strerror(errno);
+        return;
+    }
+
+    // Large trees take a long time to register, don't block the ui for it
+    _ready = false;
+    _registration = QtConcurrent::run([this] {
+        QElapsedTimer timer;
+        timer.start();
+        registerFoldersBelow(_folder);
+        QMetaObject::invokeMethod(this, [this, elapsed = timer.elapsed()] {
+            _ready = true;
+            qCInfo(lcFolderWatcher) << "Registered" << testWatchCount() << "inotify watches for" << _folder << "in" << elapsed << "ms";
+        }, Qt::QueuedConnection);
+    });
+}
+
+FolderWatcherPrivate::~FolderWatcherPrivate()
+{
+    _abortRegistration = true;
+    _registration.waitForFinished();
+
+    _socket.reset();
+    if (_fd > 0) {
+        close(_fd);
+    }
+    if (_mountFd != -1) {
+        close(_mountFd);
+    }
+}
+
+int FolderWatcherPrivate::testWatchCount() const
+{
+    if (_fanotify) {
+        return -1;
+    }
+    QMutexLocker locker(&_watchesMutex);
+    return _pathToWatch.size();
+}
+
+#if defined(FAN_REPORT_DFID_NAME)
+bool FolderWatcherPrivate::initFanotify(const QString &path)
+{
+    // Filesystem wide marks need CAP_SYS_ADMIN, for everyone else this fails with EPERM
+    const auto fd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE);
+    if (fd == -1) {
+        qCDebug(lcFolderWatcher) << "fanotify is not available:" << strerror(errno);
+        return false;
+    }
+
+    const auto nativePath = QFile::encodeName(path);
+    const uint64_t mask = FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_CLOSE_WRITE | FAN_ATTRIB | FAN_ONDIR;
+    if (fanotify_mark(fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, mask, AT_FDCWD, nativePath.constData()) == -1) {
+        qCDebug(lcFolderWatcher) << "Could not add a filesystem wide fanotify mark for" << path << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    // Needed to resolve the directory handles reported with each event
+    _mountFd = open(nativePath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (_mountFd == -1) {
+        qCWarning(lcFolderWatcher) << "Could not open" << path << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _fanotify = true;
+    _canonicalFolder = QFileInfo(path).canonicalFilePath();
+    _socket.reset(new QSocketNotifier(_fd, QSocketNotifier::Read));
+    connect(_socket.data(), &QSocketNotifier::activated, this, &FolderWatcherPrivate::slotReceivedFanotifyNotification);
+    qCInfo(lcFolderWatcher) << "Using a filesystem wide fanotify mark for" << path;
+    return true;
+}
+
+QString FolderWatcherPrivate::fanotifyDirectoryPath(file_handle *handle)
+{
+    const QByteArray key(reinterpret_cast<const char *>(handle), sizeof(file_handle) + handle->handle_bytes);
+    const auto it = _handleToPath.constFind(key);
+    if (it != _handleToPath.cend()) {
+        return *it;
+    }
+
+    const auto directoryFd = open_by_handle_at(_mountFd, handle, O_PATH | O_CLOEXEC);
+    if (directoryFd == -1) {
+        // Deleted in the meantime
+        return {};
+    }
+    std::array<char, PATH_MAX> target{};
+    const auto procPath = QByteArrayLiteral("/proc/self/fd/") + QByteArray::number(directoryFd);
+    const auto length = readlink(procPath.constData(), target.data(), target.size());
+    close(directoryFd);
+    if (length <= 0) {
+        return {};
+    }
+
+    if (_handleToPath.size() >= maximumCachedHandles) {
+        _handleToPath.clear();
+    }
+    const auto path = QFile::decodeName(QByteArray(target.data(), length));
+    _handleToPath.insert(key, path);
+    return path;
+}
+
+void FolderWatcherPrivate::slotReceivedFanotifyNotification(int fd)
+{
+    alignas(fanotify_event_metadata) std::array<char, 64 * 1024> buffer;
+    auto len = read(fd, buffer.data(), buffer.size());
+    if (len <= 0) {
+        return;
+    }
+
+    auto metadata = reinterpret_cast<fanotify_event_metadata *>(buffer.data());
+    for (; FAN_EVENT_OK(metadata, len); metadata = FAN_EVENT_NEXT(metadata, len)) {
+        if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+            qCWarning(lcFolderWatcher) << "Unexpected fanotify metadata version" << metadata->vers;
+            return;
+        }
+        if (metadata->mask & FAN_Q_OVERFLOW) {
+            processQueueOverflow();
+            continue;
+        }
+
+        const auto info = reinterpret_cast<fanotify_event_info_fid *>(metadata + 1);
+        if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME) {
+            continue;
+        }
+        const auto handle = reinterpret_cast<file_handle *>(info->handle);
+        const auto name = reinterpret_cast<const char *>(handle->f_handle + handle->handle_bytes);
+
+        const auto isDir = (metadata->mask & FAN_ONDIR) != 0;
+        const auto type = changeType(metadata->mask & FAN_CREATE, metadata->mask & FAN_MOVED_TO, metadata->mask & (FAN_MOVED_FROM | FAN_DELETE));
+        const auto directory = fanotifyDirectoryPath(handle);
+        if (isDir && (metadata->mask & (FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE))) {
+            // Cached paths of that directory and everything below it are stale now
+            _handleToPath.clear();
+        }
+
+        // The mark covers the whole filesystem
+        if (directory != _canonicalFolder && !directory.startsWith(_canonicalFolder + QLatin1Char('/'))) {
+            continue;
+        }
+        processEvent(_folder + directory.mid(_canonicalFolder.size()), name, isDir, type);
     }
+}
+#else
+bool FolderWatcherPrivate::initFanotify(const QString &)
+{
+    return false;
+}
 
-    QMetaObject::invokeMethod(this, "slotAddFolderRecursive", Q_ARG(QString, path));
+QString FolderWatcherPrivate::fanotifyDirectoryPath(file_handle *)
+{
+    return {};
 }
 
-FolderWatcherPrivate::~FolderWatcherPrivate() = default;
+void FolderWatcherPrivate::slotReceivedFanotifyNotification(int)
+{
+}
+#endif
 
 // attention: result list passed by reference!
 bool FolderWatcherPrivate::findFoldersBelow(const QDir &dir, QStringList &fullList)
@@ -69,38 +246,80 @@ bool FolderWatcherPrivate::findFoldersBelow(const QDir &dir, QStringList &fullLi
     return ok;
 }
 
-void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
+void FolderWatcherPrivate::registerFoldersBelow(const QString &path)
+{
+    // Runs in a worker thread: walk the tree depth first and register each
+    // folder right away instead of collecting the whole list first.
+    QStringList pending(path);
+    while (!pending.isEmpty() && !_abortRegistration) {
+        const auto folder = pending.takeLast();
+        if (_parent->pathIsIgnored(folder)) {
+            continue;
+        }
+        if (!inotifyRegisterPath(folder)) {
+            QMetaObject::invokeMethod(this, &FolderWatcherPrivate::inotifyWatchesExhausted, Qt::QueuedConnection);
+            return;
+        }
+
+        const auto subfolders = QDir(folder).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks | QDir::Hidden);
+        for (const auto &subfolder : subfolders) {
+            pending.append(folder + QLatin1Char('/') + subfolder);
+        }
+    }
+}
+
+bool FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
 {
     if (path.isEmpty())
-        return;
+        return true;
 
+    QMutexLocker locker(&_watchesMutex);
     int wd = inotify_add_watch(_fd, path.toUtf8().constData(),
         IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR);
     if (wd > -1) {
         _watchToPath.insert(wd, path);
         _pathToWatch.insert(path, wd);
-    } else {
-        // If we're running out of memory or inotify watches, become
-        // unreliable.
-        if (_parent->_isReliable && (errno == ENOMEM || errno == ENOSPC)) {
-            _parent->_isReliable = false;
-            emit _parent->becameUnreliable(
-                tr("This problem usually happens when the inotify watches are exhausted. "
-                   "Check the FAQ for details."));
-        }
+        return true;
     }
+    // If we're running out of memory or inotify watches, become
+    // unreliable.
+    return errno != ENOMEM && errno != ENOSPC;
+}
+
+void FolderWatcherPrivate::inotifyWatchesExhausted()
+{
+    if (_parent->_isReliable) {
+        _parent->_isReliable = false;
+        emit _parent->becameUnreliable(
+            tr("This problem usually happens when the inotify watches are exhausted. "
+               "Check the FAQ for details."));
+    }
+}
+
+bool FolderWatcherPrivate::isWatched(const QString &path) const
+{
+    QMutexLocker locker(&_watchesMutex);
+    return _pathToWatch.contains(path);
+}
+
+QString FolderWatcherPrivate::watchedPath(int wd) const
+{
+    QMutexLocker locker(&_watchesMutex);
+    return _watchToPath.value(wd);
 }
 
 void FolderWatcherPrivate::slotAddFolderRecursive(const QString &path)
 {
-    if (_pathToWatch.contains(path))
+    if (isWatched(path))
         return;
 
     int subdirs = 0;
     qCDebug(lcFolderWatcher) << "(+) Watcher:" << path;
 
     QDir inPath(path);
-    inotifyRegisterPath(inPath.absolutePath());
+    if (!inotifyRegisterPath(inPath.absolutePath())) {
+        inotifyWatchesExhausted();
+    }
 
     QStringList allSubfolders;
     if (!findFoldersBelow(QDir(path), allSubfolders)) {
@@ -110,13 +329,15 @@ void FolderWatcherPrivate::slotAddFolderRecursive(const QString &path)
     while (subfoldersIt.hasNext()) {
         QString subfolder = subfoldersIt.next();
         QDir folder(subfolder);
-        if (folder.exists() && !_pathToWatch.contains(folder.absolutePath())) {
+        if (folder.exists() && !isWatched(folder.absolutePath())) {
             subdirs++;
             if (_parent->pathIsIgnored(subfolder)) {
                 qCDebug(lcFolderWatcher) << "* Not adding" << folder.path();
                 continue;
             }
-            inotifyRegisterPath(folder.absolutePath());
+            if (!inotifyRegisterPath(folder.absolutePath())) {
+                inotifyWatchesExhausted();
+            }
         } else {
             qCDebug(lcFolderWatcher) << "    `-> discarded:" << folder.path();
         }
@@ -133,7 +354,7 @@ void FolderWatcherPrivate::slotReceivedNotification(int fd)
     struct inotify_event *event = nullptr;
     size_t i = 0;
     int error = 0;
-    QVarLengthArray<char, 2048> buffer(2048);
+    QVarLengthArray<char, 64 * 1024> buffer(64 * 1024);
 
     len = read(fd, buffer.data(), buffer.size());
     error = errno;
@@ -157,7 +378,7 @@ void FolderWatcherPrivate::slotReceivedNotification(int fd)
 
     // iterate events in buffer
     unsigned int ulen = len;
-    for (i = 0; i + sizeof(inotify_event) < ulen; i += sizeof(inotify_event) + (event ? event->len : 0)) {
+    for (i = 0; i + sizeof(inotify_event) <= ulen; i += sizeof(inotify_event) + (event ? event->len : 0)) {
         // cast an inotify_event
         event = (struct inotify_event *)&buffer[i];
         if (!event) {
@@ -165,33 +386,99 @@ void FolderWatcherPrivate::slotReceivedNotification(int fd)
             continue;
         }
 
+        if (event->mask & IN_Q_OVERFLOW) {
+            processQueueOverflow();
+            continue;
+        }
+
         // Fire event for the path that was changed.
         if (event->len == 0 || event->wd <= -1)
             continue;
-        QByteArray fileName(event->name);
-        // Filter out journal changes - redundant with filtering in
-        // FolderWatcher::pathIsIgnored.
-        if (fileName.startsWith("._sync_")
-            || fileName.startsWith(".csync_journal.db")
-            || fileName.startsWith(".sync_")) {
+        const auto directory = watchedPath(event->wd);
+        if (directory.isEmpty())
             continue;
-        }
-        const QString p = _watchToPath[event->wd] + '/' + fileName;
-        _parent->changeDetected(p);
+        processEvent(directory, event->name, event->mask & IN_ISDIR,
+            changeType(event->mask & IN_CREATE, event->mask & IN_MOVED_TO, event->mask & (IN_MOVED_FROM | IN_DELETE)));
+    }
+}
 
-        if ((event->mask & (IN_MOVED_TO | IN_CREATE))
-            && QFileInfo(p).isDir()
-            && !_parent->pathIsIgnored(p)) {
-            slotAddFolderRecursive(p);
-        }
-        if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
-            removeFoldersBelow(p);
+FolderWatcher::ChangeType FolderWatcherPrivate::changeType(bool created, bool movedIn, bool removed)
+{
+    // fanotify merges events, a path that was both created and removed
+    // could also have been removed and created again
+    if (created && !removed) {
+        return FolderWatcher::ChangeType::Created;
+    } else if (removed && !created && !movedIn) {
+        return FolderWatcher::ChangeType::Removed;
+    } else if (movedIn) {
+        return FolderWatcher::ChangeType::MovedIn;
+    }
+    return FolderWatcher::ChangeType::Modified;
+}
+
+void FolderWatcherPrivate::processEvent(const QString &directory, const char *name, bool isDir, FolderWatcher::ChangeType type)
+{
+    QByteArray fileName(name);
+    // Filter out journal changes - redundant with filtering in
+    // FolderWatcher::pathIsIgnored.
+    if (fileName.startsWith("._sync_")
+        || fileName.startsWith(".csync_journal.db")
+        || fileName.startsWith(".sync_")) {
+        return;
+    }
+
+    if (!_recentChangesTimer.isValid() || _recentChangesTimer.hasExpired(recentChangesWindowMs)) {
+        _previouslyChangedDirectories = std::exchange(_recentlyChangedDirectories, {});
+        _recentChangesTimer.start();
+    }
+    _recentlyChangedDirectories.insert(directory);
+
+    const QString p = directory + '/' + QString::fromUtf8(fileName);
+    _parent->changeDetected(p, type);
+
+    // fanotify needs no watches for new directories
+    if (_fanotify) {
+        return;
+    }
+    if ((type == FolderWatcher::ChangeType::Created || type == FolderWatcher::ChangeType::MovedIn)
+        && isDir && !_parent->pathIsIgnored(p)) {
+        slotAddFolderRecursive(p);
+    }
+    if (type == FolderWatcher::ChangeType::Removed) {
+        removeFoldersBelow(p);
+    }
+}
+
+void FolderWatcherPrivate::processQueueOverflow()
+{
+    // The kernel dropped events. They most likely belong to the bursts that
+    // filled the queue, so rediscover the directories that were busy lately
+    // instead of the whole folder.
+    const auto changedDirectories = _recentlyChangedDirectories + _previouslyChangedDirectories;
+    if (changedDirectories.isEmpty() || changedDirectories.size() > maximumOverflowSubtrees) {
+        qCWarning(lcFolderWatcher) << "Event queue overflow for" << _folder << ", a full local discovery is needed";
+        emit _parent->lostChanges();
+        return;
+    }
+
+    auto directories = QStringList(changedDirectories.cbegin(), changedDirectories.cend());
+    std::sort(directories.begin(), directories.end());
+    QStringList subtrees;
+    for (const auto &directory : std::as_const(directories)) {
+        const auto isBelowSubtree = std::any_of(subtrees.cbegin(), subtrees.cend(), [&directory](const QString &subtree) {
+            return directory.startsWith(subtree + QLatin1Char('/'));
+        });
+        if (!isBelowSubtree) {
+            subtrees.append(directory);
         }
     }
+    qCWarning(lcFolderWatcher) << "Event queue overflow, scheduling local discovery of" << subtrees;
+    emit _parent->lostChangesBelow(subtrees);
 }
 
 void FolderWatcherPrivate::removeFoldersBelow(const QString &path)
 {
+    QMutexLocker locker(&_watchesMutex);
     auto it = _pathToWatch.find(path);
     if (it == _pathToWatch.end())
         return;
@@ -20,15 +20,27 @@
 #include <QSocketNotifier>
 #include <QHash>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QMutex>
+#include <QSet>
+
+#include <atomic>
 
 #include "folderwatcher.h"
 
 class QTimer;
+struct file_handle;
 
 namespace OCC {
 
 /**
- * @brief Linux (inotify) API implementation of FolderWatcher
+ * @brief Linux (fanotify or inotify) API implementation of FolderWatcher
+ *
+ * A filesystem wide fanotify mark is used when the process is allowed to
+ * create one. Otherwise every directory gets an inotify watch; the initial
+ * watches are registered in a background thread.
+ *
  * @ingroup gui
  */
 class FolderWatcherPrivate : public QObject
@@ -39,28 +51,56 @@ public:
     FolderWatcherPrivate(FolderWatcher *p, const QString &path);
     ~FolderWatcherPrivate() override;
 
-    [[nodiscard]] int testWatchCount() const { return _pathToWatch.size(); }
+    /// Number of inotify watches, -1 if the fanotify backend is used
+    [[nodiscard]] int testWatchCount() const;
 
-    /// On linux the watcher is ready when the ctor finished.
+    /// On linux the watcher is ready once the initial inotify watches are registered.
     bool _ready = true;
 
 protected slots:
     void slotReceivedNotification(int fd);
+    void slotReceivedFanotifyNotification(int fd);
     void slotAddFolderRecursive(const QString &path);
 
 protected:
     bool findFoldersBelow(const QDir &dir, QStringList &fullList);
-    void inotifyRegisterPath(const QString &path);
+    /// Returns false if no more watches can be added
+    bool inotifyRegisterPath(const QString &path);
     void removeFoldersBelow(const QString &path);
 
 private:
+    bool initFanotify(const QString &path);
+    QString fanotifyDirectoryPath(file_handle *handle);
+    void registerFoldersBelow(const QString &path);
+    [[nodiscard]] bool isWatched(const QString &path) const;
+    [[nodiscard]] QString watchedPath(int wd) const;
+    void inotifyWatchesExhausted();
+    static FolderWatcher::ChangeType changeType(bool created, bool movedIn, bool removed);
+    void processEvent(const QString &directory, const char *name, bool isDir, FolderWatcher::ChangeType type);
+    void processQueueOverflow();
+
     FolderWatcher *_parent = nullptr;
 
     QString _folder;
     QHash<int, QString> _watchToPath;
     QMap<QString, int> _pathToWatch;
+    /// Guards the watch maps, the initial registration fills them from a worker thread
+    mutable QMutex _watchesMutex;
+    QFuture<void> _registration;
+    std::atomic<bool> _abortRegistration = false;
     QScopedPointer<QSocketNotifier> _socket;
     int _fd = 0;
+
+    /// fanotify backend: reported paths are canonical, events outside of it are dropped
+    bool _fanotify = false;
+    int _mountFd = -1;
+    QString _canonicalFolder;
+    QHash<QByteArray, QString> _handleToPath;
+
+    /// Directories that saw events recently, used to limit the discovery after a queue overflow
+    QSet<QString> _recentlyChangedDirectories;
+    QSet<QString> _previouslyChangedDirectories;
+    QElapsedTimer _recentChangesTimer;
 };
 }
 
@@ -44,6 +44,7 @@
 #include "sharemanager.h"
 #endif
 
+#include <algorithm>
 #include <array>
 #include <QBitArray>
 #include <QUrl>
@@ -86,11 +87,13 @@
 // This is the version that is returned when the client asks for the VERSION.
 // The first number should be changed if there is an incompatible change that breaks old clients.
 // The second number should be changed when there are new features.
-#define MIRALL_SOCKET_API_VERSION "1.1"
+#define MIRALL_SOCKET_API_VERSION "1.2"
 
 namespace {
 constexpr auto encryptJobPropertyFolder = "folder";
 constexpr auto encryptJobPropertyPath = "path";
+/// Status pushes are collected for this long, only the latest status of a path is sent
+constexpr auto statusPushCoalescingWindowMs = 50;
 }
 
 namespace {
@@ -312,6 +315,10 @@ SocketApi::SocketApi(QObject *parent)
 
     connect(&_localServer, &QLocalServer::newConnection, this, &SocketApi::slotNewConnection);
 
+    _statusPushTimer.setInterval(statusPushCoalescingWindowMs);
+    _statusPushTimer.setSingleShot(true);
+    connect(&_statusPushTimer, &QTimer::timeout, this, &SocketApi::flushStatusPushMessages);
+
     // folder watcher
     connect(FolderMan::instance(), &FolderMan::folderSyncStateChange, this, &SocketApi::slotUpdateFolderView);
 }
@@ -519,6 +526,9 @@ void SocketApi::slotUpdateFolderView(Folder *f)
 
 void SocketApi::broadcastMessage(const QString &msg, bool doWait)
 {
+    // Keep the order of the messages, e.g. the root status before its UPDATE_VIEW
+    flushStatusPushMessages();
+
     for (const auto &listener : std::as_const(_listeners)) {
         listener->sendMessage(msg, doWait);
     }
@@ -642,11 +652,41 @@ void SocketApi::processLeaveShareRequest(const QString &localFile, SocketListene
 
 void SocketApi::broadcastStatusPushMessage(const QString &systemPath, SyncFileStatus fileStatus)
 {
-    QString msg = buildMessage(QLatin1String("STATUS"), systemPath, fileStatus.toSocketAPIString());
     Q_ASSERT(!systemPath.endsWith('/'));
-    uint directoryHash = qHash(systemPath.left(systemPath.lastIndexOf('/')));
-    for (const auto &listener : std::as_const(_listeners)) {
-        listener->sendMessageIfDirectoryMonitored(msg, directoryHash);
+    if (_listeners.isEmpty()) {
+        return;
+    }
+
+    auto &pending = _pendingStatusPushes[systemPath];
+    pending.sequence = ++_statusPushSequence;
+    pending.systemPath = systemPath;
+    pending.status = fileStatus;
+    if (!_statusPushTimer.isActive()) {
+        _statusPushTimer.start();
+    }
+}
+
+void SocketApi::flushStatusPushMessages()
+{
+    _statusPushTimer.stop();
+    if (_pendingStatusPushes.isEmpty()) {
+        return;
+    }
+
+    // Send in the order of the last change: children become OK right before their parents
+    auto pushes = QList<PendingStatusPush>(_pendingStatusPushes.cbegin(), _pendingStatusPushes.cend());
+    _pendingStatusPushes.clear();
+    std::sort(pushes.begin(), pushes.end(), [](const PendingStatusPush &lhs, const PendingStatusPush &rhs) {
+        return lhs.sequence < rhs.sequence;
+    });
+    qCDebug(lcSocketApi) << "Pushing" << pushes.size() << "status changes";
+
+    for (const auto &push : std::as_const(pushes)) {
+        const auto msg = buildMessage(QLatin1String("STATUS"), push.systemPath, push.status.toSocketAPIString());
+        const auto directoryHash = qHash(push.systemPath.left(push.systemPath.lastIndexOf('/')));
+        for (const auto &listener : std::as_const(_listeners)) {
+            listener->sendMessageIfDirectoryMonitored(msg, directoryHash);
+        }
     }
 }
 
@@ -656,11 +696,11 @@ void SocketApi::command_RETRIEVE_FOLDER_STATUS(const QString &argument, SocketLi
     command_RETRIEVE_FILE_STATUS(argument, listener);
 }
 
-void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketListener *listener)
+QString SocketApi::fileStatusMessage(const QString &localFile, SocketListener *listener) const
 {
     QString statusString;
 
-    auto fileData = FileData::get(argument);
+    auto fileData = FileData::get(localFile);
     if (!fileData.folder) {
         // this can happen in offline mode e.g.: nothing to worry about
         statusString = QLatin1String("NOP");
@@ -674,8 +714,50 @@ void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketList
         statusString = fileStatus.toSocketAPIString();
     }
 
-    const QString message = QLatin1String("STATUS:") % statusString % QLatin1Char(':') % QDir::toNativeSeparators(argument);
-    listener->sendMessage(message);
+    return QLatin1String("STATUS:") % statusString % QLatin1Char(':') % QDir::toNativeSeparators(localFile);
+}
+
+void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketListener *listener)
+{
+    listener->sendMessage(fileStatusMessage(argument, listener));
+}
+
+void SocketApi::command_RETRIEVE_FILE_STATUSES(const QString &argument, SocketListener *listener)
+{
+    QStringList reply{QStringLiteral("RETRIEVE_FILE_STATUSES:BEGIN")};
+    for (const auto &file : split(argument)) {
+        if (!file.isEmpty()) {
+            reply.append(fileStatusMessage(file, listener));
+        }
+    }
+    reply.append(QStringLiteral("RETRIEVE_FILE_STATUSES:END"));
+
+    // One write for the whole reply
+    listener->sendMessage(reply.join(QLatin1Char('\n')));
+}
+
+void SocketApi::command_RETRIEVE_DIRECTORY_STATUS(const QString &argument, SocketListener *listener)
+{
+    QStringList reply{QStringLiteral("RETRIEVE_DIRECTORY_STATUS:BEGIN")};
+
+    const auto directoryData = FileData::get(argument);
+    if (directoryData.folder) {
+        listener->registerMonitoredDirectory(qHash(directoryData.localPath));
+
+        // All entries belong to the folder of the directory, no need to look it up per entry
+        auto &statusTracker = directoryData.folder->syncEngine().syncFileStatusTracker();
+        const auto entries = QDir(directoryData.localPath).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+        reply.reserve(entries.size() + 2);
+        for (const auto &entry : entries) {
+            const auto relativePath = directoryData.folderRelativePath.isEmpty() ? entry : directoryData.folderRelativePath + QLatin1Char('/') + entry;
+            const auto status = statusTracker.fileStatus(relativePath);
+            reply.append(QString(QLatin1String("STATUS:") % status.toSocketAPIString() % QLatin1Char(':')
+                % QDir::toNativeSeparators(directoryData.localPath + QLatin1Char('/') + entry)));
+        }
+    }
+    reply.append(QStringLiteral("RETRIEVE_DIRECTORY_STATUS:END"));
+
+    listener->sendMessage(reply.join(QLatin1Char('\n')));
 }
 
 void SocketApi::command_SHARE(const QString &localFile, SocketListener *listener)
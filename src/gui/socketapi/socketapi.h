@@ -21,11 +21,14 @@
 
 #include "config.h"
 
+#include <QHash>
 #include <QLocalServer>
+#include <QTimer>
 
 class QUrl;
 class QLocalSocket;
 class QFileInfo;
+class TestSocketApi;
 
 namespace OCC
 {
@@ -79,6 +82,7 @@ private slots:
     void onLostConnection();
     void slotSocketDestroyed(QObject *obj);
     void slotReadSocket();
+    void flushStatusPushMessages();
 
     static void copyUrlToClipboard(const QString &link);
     static void emailPrivateLink(const QString &link);
@@ -109,8 +113,19 @@ private:
         QString serverRelativePath;
     };
 
+    /// Status pushes waiting for flushStatusPushMessages(), the latest status per path wins
+    struct PendingStatusPush
+    {
+        quint64 sequence = 0;
+        QString systemPath;
+        SyncFileStatus status;
+    };
+
     void broadcastMessage(const QString &msg, bool doWait = false);
 
+    /// The STATUS reply for localFile, also marks its directory as monitored by the listener
+    QString fileStatusMessage(const QString &localFile, SocketListener *listener) const;
+
     // opens share dialog, sends reply
     void processShareRequest(const QString &localFile, SocketListener *listener);
     void processLeaveShareRequest(const QString &localFile, SocketListener *listener);
@@ -120,6 +135,19 @@ private:
     Q_INVOKABLE void command_RETRIEVE_FOLDER_STATUS(const QString &argument, OCC::SocketListener *listener);
     Q_INVOKABLE void command_RETRIEVE_FILE_STATUS(const QString &argument, OCC::SocketListener *listener);
 
+    /** Send the status of several files at once. (added in version 1.2)
+     * argument is a list of files, separated by '\x1e'
+     * Reply with RETRIEVE_FILE_STATUSES:BEGIN
+     * followed by a STATUS:[status]:[file] for every file
+     * and ends with RETRIEVE_FILE_STATUSES:END
+     */
+    Q_INVOKABLE void command_RETRIEVE_FILE_STATUSES(const QString &argument, OCC::SocketListener *listener);
+    /** Send the status of every entry of a directory. (added in version 1.2)
+     * Same reply as RETRIEVE_FILE_STATUSES, framed with RETRIEVE_DIRECTORY_STATUS:BEGIN
+     * and RETRIEVE_DIRECTORY_STATUS:END
+     */
+    Q_INVOKABLE void command_RETRIEVE_DIRECTORY_STATUS(const QString &argument, OCC::SocketListener *listener);
+
     Q_INVOKABLE void command_VERSION(const QString &argument, OCC::SocketListener *listener);
 
     Q_INVOKABLE void command_SHARE_MENU_TITLE(const QString &argument, OCC::SocketListener *listener);
@@ -207,6 +235,12 @@ private:
     QSet<QString> _registeredAliases;
     QMap<QIODevice *, QSharedPointer<SocketListener>> _listeners;
     QLocalServer _localServer;
+
+    QHash<QString, PendingStatusPush> _pendingStatusPushes;
+    quint64 _statusPushSequence = 0;
+    QTimer _statusPushTimer;
+
+    friend class ::TestSocketApi;
 };
 }
 
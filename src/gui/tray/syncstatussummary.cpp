@@ -28,6 +28,8 @@
 
 #include <theme.h>
 
+#include <algorithm>
+
 namespace {
 
 OCC::SyncResult::Status determineSyncStatus(const OCC::SyncResult &syncResult)
@@ -77,6 +79,7 @@ void SyncStatusSummary::load()
     }
     setAccountState(currentUser->accountState());
     clearFolderErrors();
+    _folderProgress.clear();
     connectToFoldersProgress(FolderMan::instance()->map());
     initSyncState();
 }
@@ -99,6 +102,14 @@ bool SyncStatusSummary::syncing() const
 void SyncStatusSummary::onFolderListChanged(const OCC::Folder::Map &folderMap)
 {
     connectToFoldersProgress(folderMap);
+
+    for (auto it = _folderProgress.begin(); it != _folderProgress.end();) {
+        if (!folderMap.contains(it->first)) {
+            it = _folderProgress.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void SyncStatusSummary::markFolderAsError(const Folder *folder)
@@ -140,7 +151,7 @@ void SyncStatusSummary::setSyncStateForFolder(const Folder *folder)
         return;
     }
 
-    const auto state = determineSyncStatus(folder->syncResult());
+    auto state = determineSyncStatus(folder->syncResult());
 
     switch (state) {
     case SyncResult::Success:
@@ -159,9 +170,29 @@ void SyncStatusSummary::setSyncStateForFolder(const Folder *folder)
         break;
     }
 
+    if (state != SyncResult::SyncRunning && state != SyncResult::NotYetStarted) {
+        _folderProgress.erase(folder->alias());
+
+        if (isOtherFolderSyncing(folder)) {
+            // Folders sync concurrently, the summary is about the whole account
+            state = SyncResult::SyncRunning;
+        } else if (state == SyncResult::Success && folderErrors()) {
+            // A folder that finished before had problems
+            state = SyncResult::Problem;
+        }
+    }
+
     setSyncState(state);
 }
 
+bool SyncStatusSummary::isOtherFolderSyncing(const Folder *folder) const
+{
+    const auto folders = FolderMan::instance()->map();
+    return std::any_of(folders.cbegin(), folders.cend(), [folder](const Folder *other) {
+        return other != folder && other->accountState() == folder->accountState() && other->isSyncRunning();
+    });
+}
+
 void SyncStatusSummary::setSyncState(const SyncResult::Status state)
 {
     if (_accountState && !_accountState->isConnected()) {
@@ -283,11 +314,33 @@ constexpr double calculateOverallPercent(
 
 void SyncStatusSummary::onFolderProgressInfo(const ProgressInfo &progress)
 {
-    const qint64 completedSize = progress.completedSize();
-    const qint64 currentFile = progress.currentFile();
-    const qint64 completedFile = progress.completedFiles();
-    const qint64 totalSize = qMax(completedSize, progress.totalSize());
-    const qint64 numFilesInProgress = qMax(currentFile, progress.totalFiles());
+    const auto folder = qobject_cast<const Folder *>(sender());
+    auto &folderProgress = _folderProgress[folder ? folder->alias() : QString()];
+    folderProgress.completedSize = progress.completedSize();
+    folderProgress.currentFile = progress.currentFile();
+    folderProgress.completedFiles = progress.completedFiles();
+    folderProgress.totalSize = qMax(folderProgress.completedSize, progress.totalSize());
+    folderProgress.totalFiles = qMax(folderProgress.currentFile, progress.totalFiles());
+    folderProgress.trustEta = progress.trustEta();
+    folderProgress.estimatedEta = progress.totalProgress().estimatedEta;
+
+    // Several folders of the account may sync at once
+    qint64 completedSize = 0;
+    qint64 currentFile = 0;
+    qint64 completedFile = 0;
+    qint64 totalSize = 0;
+    qint64 numFilesInProgress = 0;
+    auto trustEta = true;
+    quint64 estimatedEta = 0;
+    for (const auto &[alias, syncingFolderProgress] : _folderProgress) {
+        completedSize += syncingFolderProgress.completedSize;
+        currentFile += syncingFolderProgress.currentFile;
+        completedFile += syncingFolderProgress.completedFiles;
+        totalSize += syncingFolderProgress.totalSize;
+        numFilesInProgress += syncingFolderProgress.totalFiles;
+        trustEta = trustEta && syncingFolderProgress.trustEta;
+        estimatedEta = qMax(estimatedEta, syncingFolderProgress.estimatedEta);
+    }
 
     if (_totalFiles <= 0 && numFilesInProgress > 0) {
         setSyncStatusString(tr("Syncing"));
@@ -301,11 +354,11 @@ void SyncStatusSummary::onFolderProgressInfo(const ProgressInfo &progress)
         const auto completedSizeString = Utility::octetsToString(completedSize);
         const auto totalSizeString = Utility::octetsToString(totalSize);
 
-        if (progress.trustEta()) {
+        if (trustEta) {
             setSyncStatusDetailString(
                 tr("%1 of %2 · %3 left")
                     .arg(completedSizeString, totalSizeString)
-                    .arg(Utility::durationToDescriptiveString1(progress.totalProgress().estimatedEta)));
+                    .arg(Utility::durationToDescriptiveString1(estimatedEta)));
         } else {
             setSyncStatusDetailString(tr("%1 of %2").arg(completedSizeString, totalSizeString));
         }
@@ -24,6 +24,8 @@
 
 #include <QObject>
 
+#include <map>
+
 namespace OCC {
 
 class SyncStatusSummary : public QObject
@@ -59,6 +61,18 @@ public slots:
     void load();
 
 private:
+    /// Progress of one syncing folder, the summary shows the sum over the folders of the account
+    struct FolderProgress
+    {
+        qint64 completedSize = 0;
+        qint64 totalSize = 0;
+        qint64 currentFile = 0;
+        qint64 completedFiles = 0;
+        qint64 totalFiles = 0;
+        bool trustEta = false;
+        quint64 estimatedEta = 0;
+    };
+
     void connectToFoldersProgress(const Folder::Map &map);
 
     void onFolderListChanged(const OCC::Folder::Map &folderMap);
@@ -79,6 +93,7 @@ private:
     void clearFolderErrors();
     void setSyncStateToConnectedState();
     bool reloadNeeded(AccountState *accountState) const;
+    [[nodiscard]] bool isOtherFolderSyncing(const Folder *folder) const;
     void initSyncState();
 
     void setSyncProgress(double value);
@@ -91,6 +106,7 @@ private:
 
     AccountStatePtr _accountState;
     std::set<QString> _foldersWithErrors;
+    std::map<QString, FolderProgress> _folderProgress;
 #ifdef BUILD_FILE_PROVIDER_MODULE
     std::set<QString> _fileProviderDomainsWithErrors;
 #endif
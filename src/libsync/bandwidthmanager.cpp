@@ -27,10 +27,89 @@
 #include <QTimer>
 #include <QObject>
 
+#include <algorithm>
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcBandwidthManager, "nextcloud.sync.bandwidthmanager", QtInfoMsg)
 
+// How often waiting streams are given the refilled tokens of an absolute limit
+static constexpr auto absoluteLimitRefillIntervalMsec = 50;
+
+namespace {
+
+template <typename Stream>
+void giveTokensToWaitingStreams(TokenBucket &bucket, std::list<Stream *> &waiting)
+{
+    if (waiting.empty()) {
+        return;
+    }
+
+    // Streams that were left over last time are at the front
+    const auto share = qMax<qint64>(1, bucket.available() / static_cast<qint64>(waiting.size()));
+    while (!waiting.empty()) {
+        const auto tokens = bucket.take(share);
+        if (tokens <= 0) {
+            break;
+        }
+        const auto stream = waiting.front();
+        waiting.pop_front();
+        stream->giveBandwidthQuota(tokens);
+    }
+}
+
+template <typename Stream>
+void addWaitingStream(std::list<Stream *> &waiting, Stream *stream)
+{
+    if (std::find(waiting.cbegin(), waiting.cend(), stream) == waiting.cend()) {
+        waiting.push_back(stream);
+    }
+}
+
+}
+
+TokenBucket::TokenBucket(qint64 bytesPerSecond, qint64 burstMsec)
+    : _burstMsec(burstMsec)
+{
+    setRate(bytesPerSecond);
+}
+
+void TokenBucket::setRate(qint64 bytesPerSecond)
+{
+    refill();
+    _rate = qMax<qint64>(0, bytesPerSecond);
+    _tokens = qMin(_tokens, static_cast<double>(_rate) * _burstMsec / 1000);
+    _lastRefill.start();
+}
+
+void TokenBucket::refill()
+{
+    if (!_lastRefill.isValid()) {
+        return;
+    }
+    const auto elapsedNsec = _lastRefill.nsecsElapsed();
+    _lastRefill.start();
+    const auto capacity = static_cast<double>(_rate) * _burstMsec / 1000;
+    _tokens = qMin(capacity, _tokens + static_cast<double>(_rate) * elapsedNsec / 1e9);
+}
+
+qint64 TokenBucket::take(qint64 wanted)
+{
+    refill();
+    const auto tokens = qMin(wanted, static_cast<qint64>(_tokens));
+    if (tokens <= 0) {
+        return 0;
+    }
+    _tokens -= tokens;
+    return tokens;
+}
+
+qint64 TokenBucket::available()
+{
+    refill();
+    return static_cast<qint64>(_tokens);
+}
+
 // Because of the many layers of buffering inside Qt (and probably the OS and the network)
 // we cannot lower this value much more. If we do, the estimated bw will be very high
 // because the buffers fill fast while the actual network algorithms are not relevant yet.
@@ -50,6 +129,8 @@ BandwidthManager::BandwidthManager(OwncloudPropagator *p)
 {
     _currentUploadLimit = _propagator->_uploadLimit;
     _currentDownloadLimit = _propagator->_downloadLimit;
+    _uploadBucket.setRate(_currentUploadLimit);
+    _downloadBucket.setRate(_currentDownloadLimit);
 
     QObject::connect(&_switchingTimer, &QTimer::timeout, this, &BandwidthManager::switchingTimerExpired);
     _switchingTimer.setInterval(10 * 1000);
@@ -58,8 +139,8 @@ BandwidthManager::BandwidthManager(OwncloudPropagator *p)
 
     // absolute uploads/downloads
     QObject::connect(&_absoluteLimitTimer, &QTimer::timeout, this, &BandwidthManager::absoluteLimitTimerExpired);
-    _absoluteLimitTimer.setInterval(1000);
-    _absoluteLimitTimer.start();
+    // only runs while streams wait for tokens
+    _absoluteLimitTimer.setInterval(absoluteLimitRefillIntervalMsec);
 
     // Relative uploads
     QObject::connect(&_relativeUploadMeasuringTimer, &QTimer::timeout,
@@ -86,7 +167,6 @@ BandwidthManager::~BandwidthManager() = default;
 
 void BandwidthManager::registerUploadDevice(UploadDevice *p)
 {
-    _absoluteUploadDeviceList.push_back(p);
     _relativeUploadDeviceList.push_back(p);
     QObject::connect(p, &QObject::destroyed, this, &BandwidthManager::unregisterUploadDevice);
 
@@ -105,8 +185,8 @@ void BandwidthManager::registerUploadDevice(UploadDevice *p)
 void BandwidthManager::unregisterUploadDevice(QObject *o)
 {
     auto p = reinterpret_cast<UploadDevice *>(o); // note, we might already be in the ~QObject
-    _absoluteUploadDeviceList.remove(p);
     _relativeUploadDeviceList.remove(p);
+    _waitingUploadDevices.remove(p);
     if (p == _relativeLimitCurrentMeasuredDevice) {
         _relativeLimitCurrentMeasuredDevice = nullptr;
         _relativeUploadLimitProgressAtMeasuringRestart = 0;
@@ -134,6 +214,7 @@ void BandwidthManager::unregisterDownloadJob(QObject *o)
 {
     auto *j = reinterpret_cast<GETFileJob *>(o); // note, we might already be in the ~QObject
     _downloadJobList.remove(j);
+    _waitingDownloadJobs.remove(j);
     if (_relativeLimitCurrentMeasuredJob == j) {
         _relativeLimitCurrentMeasuredJob = nullptr;
         _relativeDownloadLimitProgressAtMeasuringRestart = 0;
@@ -347,6 +428,8 @@ void BandwidthManager::switchingTimerExpired()
     if (newUploadLimit != _currentUploadLimit) {
         qCInfo(lcBandwidthManager) << "Upload Bandwidth limit changed" << _currentUploadLimit << newUploadLimit;
         _currentUploadLimit = newUploadLimit;
+        _uploadBucket.setRate(_currentUploadLimit);
+        _waitingUploadDevices.clear();
 
         for (const auto uploadDevice : _relativeUploadDeviceList) {
             Q_ASSERT(uploadDevice);
@@ -368,6 +451,8 @@ void BandwidthManager::switchingTimerExpired()
     if (newDownloadLimit != _currentDownloadLimit) {
         qCInfo(lcBandwidthManager) << "Download Bandwidth limit changed" << _currentDownloadLimit << newDownloadLimit;
         _currentDownloadLimit = newDownloadLimit;
+        _downloadBucket.setRate(_currentDownloadLimit);
+        _waitingDownloadJobs.clear();
 
         for (const auto getJob : _downloadJobList) {
             Q_ASSERT(getJob);
@@ -386,28 +471,44 @@ void BandwidthManager::switchingTimerExpired()
     }
 }
 
-void BandwidthManager::absoluteLimitTimerExpired()
+qint64 BandwidthManager::takeUploadQuota(UploadDevice *device, qint64 wanted)
 {
-    if (usingAbsoluteUploadLimit() && !_absoluteUploadDeviceList.empty()) {
-        const auto quotaPerDevice = _currentUploadLimit / qMax((std::list<UploadDevice *>::size_type)1, _absoluteUploadDeviceList.size());
-
-        qCDebug(lcBandwidthManager) << quotaPerDevice << _absoluteUploadDeviceList.size() << _currentUploadLimit;
-
-        for (const auto device : _absoluteUploadDeviceList) {
-            device->giveBandwidthQuota(quotaPerDevice);
-            qCDebug(lcBandwidthManager) << "Gave " << quotaPerDevice / 1024.0 << " kB to" << device;
+    if (!usingAbsoluteUploadLimit()) {
+        return 0;
+    }
+    const auto tokens = _uploadBucket.take(wanted);
+    if (tokens == 0) {
+        addWaitingStream(_waitingUploadDevices, device);
+        if (!_absoluteLimitTimer.isActive()) {
+            _absoluteLimitTimer.start();
         }
     }
+    return tokens;
+}
 
-    if (usingAbsoluteDownloadLimit() && !_downloadJobList.empty()) {
-        const auto quotaPerJob = _currentDownloadLimit / qMax((std::list<GETFileJob *>::size_type)1, _downloadJobList.size());
+qint64 BandwidthManager::takeDownloadQuota(GETFileJob *job, qint64 wanted)
+{
+    if (!usingAbsoluteDownloadLimit()) {
+        return 0;
+    }
+    const auto tokens = _downloadBucket.take(wanted);
+    if (tokens == 0) {
+        addWaitingStream(_waitingDownloadJobs, job);
+        if (!_absoluteLimitTimer.isActive()) {
+            _absoluteLimitTimer.start();
+        }
+    }
+    return tokens;
+}
 
-        qCDebug(lcBandwidthManager) << quotaPerJob << _downloadJobList.size() << _currentDownloadLimit;
+void BandwidthManager::absoluteLimitTimerExpired()
+{
+    // The streams take tokens themselves while there are some, this only wakes up those that ran dry
+    giveTokensToWaitingStreams(_uploadBucket, _waitingUploadDevices);
+    giveTokensToWaitingStreams(_downloadBucket, _waitingDownloadJobs);
 
-        for (const auto job : _downloadJobList) {
-            job->giveBandwidthQuota(quotaPerJob);
-            qCDebug(lcBandwidthManager) << "Gave " << quotaPerJob / 1024.0 << " kB to" << job;
-        }
+    if (_waitingUploadDevices.empty() && _waitingDownloadJobs.empty()) {
+        _absoluteLimitTimer.stop();
     }
 }
 
@@ -15,6 +15,9 @@
 #ifndef BANDWIDTHMANAGER_H
 #define BANDWIDTHMANAGER_H
 
+#include "owncloudlib.h"
+
+#include <QElapsedTimer>
 #include <QObject>
 #include <QTimer>
 #include <QIODevice>
@@ -26,6 +29,35 @@ class UploadDevice;
 class GETFileJob;
 class OwncloudPropagator;
 
+/**
+ * @brief Bytes that may be transferred, refilled continuously at a fixed rate
+ *
+ * All streams of one direction take from the same bucket, so the limit
+ * holds for their sum no matter how many of them run at once.
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT TokenBucket
+{
+public:
+    /// At most \a burstMsec worth of unused tokens are kept
+    explicit TokenBucket(qint64 bytesPerSecond = 0, qint64 burstMsec = 250);
+
+    void setRate(qint64 bytesPerSecond);
+    [[nodiscard]] qint64 rate() const { return _rate; }
+
+    /// Takes up to \a wanted tokens and returns how many were taken
+    qint64 take(qint64 wanted);
+    [[nodiscard]] qint64 available();
+
+private:
+    void refill();
+
+    qint64 _rate = 0;
+    qint64 _burstMsec = 0;
+    double _tokens = 0;
+    QElapsedTimer _lastRefill;
+};
+
 /**
  * @brief The BandwidthManager class
  * @ingroup libsync
@@ -42,6 +74,13 @@ public:
     bool usingAbsoluteDownloadLimit() { return _currentDownloadLimit > 0; }
     bool usingRelativeDownloadLimit() { return _currentDownloadLimit < 0; }
 
+    /** Takes up to \a wanted bytes of the absolute upload limit for \a device
+     *
+     * When nothing is left, the device gets a quota as soon as the bucket refilled.
+     */
+    qint64 takeUploadQuota(OCC::UploadDevice *device, qint64 wanted);
+    /// Same as takeUploadQuota() for downloads
+    qint64 takeDownloadQuota(OCC::GETFileJob *job, qint64 wanted);
 
 public slots:
     void registerUploadDevice(OCC::UploadDevice *);
@@ -67,11 +106,13 @@ private:
     // by the propagator emitting the changed limit values to us as signal
     OwncloudPropagator *_propagator;
 
-    // for absolute up/down bw limiting
+    // for absolute up/down bw limiting, refills the buckets for the waiting streams
     QTimer _absoluteLimitTimer;
+    TokenBucket _uploadBucket;
+    TokenBucket _downloadBucket;
+    std::list<UploadDevice *> _waitingUploadDevices;
+    std::list<GETFileJob *> _waitingDownloadJobs;
 
-    // FIXME merge these two lists
-    std::list<UploadDevice *> _absoluteUploadDeviceList;
     std::list<UploadDevice *> _relativeUploadDeviceList;
 
     QTimer _relativeUploadMeasuringTimer;
@@ -33,6 +33,9 @@
 #include <QJsonObject>
 #include <QJsonValue>
 
+#include <algorithm>
+#include <chrono>
+
 namespace {
 
 QByteArray getEtagFromJsonReply(const QJsonObject &reply)
@@ -58,8 +61,17 @@ QByteArray getHeaderFromJsonReply(const QJsonObject &reply, const QByteArray &he
     return reply.value(headerName).toString().toLatin1();
 }
 
+using namespace std::chrono_literals;
+
+// Limits of the first batch, the later ones are scaled by the measured upload time
 constexpr auto batchSize = 100;
-constexpr auto parallelJobsMaximumCount = 1;
+constexpr auto minBatchSize = 10;
+constexpr auto maxBatchSize = 1000;
+constexpr qint64 batchBytes = 100LL * 1000LL * 1000LL;
+constexpr qint64 minBatchBytes = 5LL * 1000LL * 1000LL;
+constexpr qint64 maxBatchBytes = 500LL * 1000LL * 1000LL;
+constexpr auto targetBatchDuration = 10s;
+constexpr auto parallelJobsMaximumCount = 3;
 
 }
 
@@ -71,29 +83,38 @@ BulkPropagatorJob::BulkPropagatorJob(OwncloudPropagator *propagator, const std::
     : PropagatorJob(propagator)
     , _items(items)
     , _currentBatchSize(batchSize)
+    , _currentBatchBytes(batchBytes)
 {
-    _filesToUpload.reserve(batchSize);
-    _pendingChecksumFiles.reserve(batchSize);
 }
 
 bool BulkPropagatorJob::scheduleSelfOrChild()
 {
-    if (_items.empty() || !_pendingChecksumFiles.empty()) {
+    // Only one batch is checksummed at a time, while the previous ones are uploaded
+    if (_items.empty() || isPreparingBatch() || _jobs.size() >= maximumParallelBatches()) {
         return false;
     }
 
     _state = Running;
 
-    for(auto i = 0; i < _currentBatchSize && !_items.empty(); ++i) {
+    const auto batchId = _nextBatchId++;
+    auto &batch = _batches[batchId];
+    batch._filesToUpload.reserve(qMin<size_t>(_currentBatchSize, _items.size()));
+
+    while (batch._pendingChecksums < _currentBatchSize && !_items.empty()) {
         const auto currentItem = _items.front();
+        if (batch._pendingChecksums > 0 && batch._bytes + currentItem->_size > _currentBatchBytes) {
+            break;
+        }
         _items.pop_front();
-        _pendingChecksumFiles.insert(currentItem->_file);
+        ++batch._pendingChecksums;
+        batch._bytes += currentItem->_size;
 
-        QMetaObject::invokeMethod(this, [this, currentItem] {
+        QMetaObject::invokeMethod(this, [this, currentItem, batchId] {
             UploadFileInfo fileToUpload;
             fileToUpload._file = currentItem->_file;
             fileToUpload._size = currentItem->_size;
             fileToUpload._path = propagator()->fullLocalPath(fileToUpload._file);
+            fileToUpload._batchId = batchId;
 
             qCDebug(lcBulkPropagatorJob) << "Scheduling bulk propagator job:" << this
                                          << "and starting upload of item"
@@ -105,7 +126,23 @@ bool BulkPropagatorJob::scheduleSelfOrChild()
         }); // We could be in a different thread (neon jobs)
     }
 
-    return _items.empty() && _filesToUpload.empty();
+    qCDebug(lcBulkPropagatorJob) << "Scheduling bulk upload batch" << batchId
+                                 << "with" << batch._pendingChecksums << "files"
+                                 << "and" << batch._bytes << "bytes";
+
+    return _items.empty();
+}
+
+bool BulkPropagatorJob::isPreparingBatch() const
+{
+    return std::any_of(_batches.cbegin(), _batches.cend(), [](const auto &batch) {
+        return !batch.second._job;
+    });
+}
+
+int BulkPropagatorJob::maximumParallelBatches() const
+{
+    return qBound(1, propagator()->maximumActiveTransferJob(), parallelJobsMaximumCount);
 }
 
 bool BulkPropagatorJob::handleBatchSize()
@@ -116,21 +153,43 @@ bool BulkPropagatorJob::handleBatchSize()
         return true;
     }
 
-    // change batch size before trying it again
-    const auto halfBatchSize = batchSize / 2;
-
     // we already tried to upload with half of the batch size
-    if(_currentBatchSize == halfBatchSize) {
+    if (_batchSizeReducedAfterError) {
         qCDebug(lcBulkPropagatorJob) << "There was another error, stop syncing now!";
         return false;
     }
 
     // try to upload with half of the batch size
-    _currentBatchSize = halfBatchSize;
+    _batchSizeReducedAfterError = true;
+    _currentBatchSize = qMax(minBatchSize, _currentBatchSize / 2);
+    _currentBatchBytes = qMax(minBatchBytes, _currentBatchBytes / 2);
     qCDebug(lcBulkPropagatorJob) << "There was an error, sync again with bulk upload batch size cut to half!";
     return true;
 }
 
+void BulkPropagatorJob::adjustBatchSize(const UploadBatch &batch)
+{
+    if (_batchSizeReducedAfterError) {
+        return;
+    }
+
+    // Many small files mostly cost server time per file, larger ones transfer time per byte.
+    // Both limits follow the upload time so that a batch takes about targetBatchDuration.
+    const auto elapsed = qMax<qint64>(batch._uploadTimer.elapsed(), 1);
+    const auto factor = qBound(0.5, static_cast<double>(std::chrono::milliseconds(targetBatchDuration).count()) / elapsed, 2.0);
+
+    // A batch that ran out of files says nothing about larger ones
+    const auto batchWasFull = static_cast<qint64>(batch._filesToUpload.size()) >= _currentBatchSize || batch._bytes * 2 >= _currentBatchBytes;
+    if (factor > 1.0 && !batchWasFull) {
+        return;
+    }
+
+    _currentBatchSize = qBound(minBatchSize, qRound(_currentBatchSize * factor), maxBatchSize);
+    _currentBatchBytes = qBound(minBatchBytes, qRound64(static_cast<double>(_currentBatchBytes) * factor), maxBatchBytes);
+    qCDebug(lcBulkPropagatorJob) << "Bulk upload of" << batch._filesToUpload.size() << "files and" << batch._bytes << "bytes took" << elapsed << "ms,"
+                                 << "next batches have up to" << _currentBatchSize << "files and" << _currentBatchBytes << "bytes";
+}
+
 PropagatorJob::JobParallelism BulkPropagatorJob::parallelism() const
 {
     return PropagatorJob::JobParallelism::FullParallelism;
@@ -145,6 +204,7 @@ void BulkPropagatorJob::startUploadFile(SyncFileItemPtr item, UploadFileInfo fil
     // Check if the specific file can be accessed
     if (propagator()->hasCaseClashAccessibilityProblem(fileToUpload._file)) {
         done(item, SyncFileItem::NormalError, tr("File %1 cannot be uploaded because another file with the same name, differing only in case, exists").arg(QDir::toNativeSeparators(item->_file)), ErrorCategory::GenericError);
+        finishPendingChecksum(fileToUpload._batchId);
         return;
     }
 
@@ -185,6 +245,7 @@ void BulkPropagatorJob::doStartUpload(SyncFileItemPtr item,
 
         if (!renameSuccess) {
             done(item, SyncFileItem::NormalError, "File contains trailing spaces and couldn't be renamed", ErrorCategory::GenericError);
+            finishPendingChecksum(fileToUpload._batchId);
             return;
         }
 
@@ -195,9 +256,8 @@ void BulkPropagatorJob::doStartUpload(SyncFileItemPtr item,
 
         item->_modtime = FileSystem::getModTime(newFilePathAbsolute);
         if (item->_modtime <= 0) {
-            _pendingChecksumFiles.remove(item->_file);
             slotOnErrorStartFolderUnlock(item, SyncFileItem::NormalError, tr("File %1 has invalid modified time. Do not upload to the server.").arg(QDir::toNativeSeparators(item->_file)), ErrorCategory::GenericError);
-            checkPropagationIsDone();
+            finishPendingChecksum(fileToUpload._batchId);
             return;
         }
     }
@@ -211,21 +271,39 @@ void BulkPropagatorJob::doStartUpload(SyncFileItemPtr item,
                 fileToUpload._size, currentHeaders};
 
     qCInfo(lcBulkPropagatorJob) << remotePath << "transmission checksum" << transmissionChecksumHeader << fileToUpload._path;
-    _filesToUpload.push_back(std::move(newUploadFile));
-    _pendingChecksumFiles.remove(item->_file);
+    const auto batch = _batches.find(fileToUpload._batchId);
+    Q_ASSERT(batch != _batches.end());
+    if (batch != _batches.end()) {
+        batch->second._filesToUpload.push_back(std::move(newUploadFile));
+    }
+    finishPendingChecksum(fileToUpload._batchId);
+}
 
-    if (_pendingChecksumFiles.empty()) {
-        triggerUpload();
+void BulkPropagatorJob::finishPendingChecksum(int batchId)
+{
+    const auto batch = _batches.find(batchId);
+    Q_ASSERT(batch != _batches.end());
+    if (batch == _batches.end() || --batch->second._pendingChecksums > 0) {
+        return;
     }
+
+    if (batch->second._filesToUpload.empty()) {
+        // none of the files could be prepared
+        _batches.erase(batch);
+        checkPropagationIsDone();
+        return;
+    }
+
+    triggerUpload(batch->second);
 }
 
-void BulkPropagatorJob::triggerUpload()
+void BulkPropagatorJob::triggerUpload(UploadBatch &batch)
 {
     auto uploadParametersData = std::vector<SingleUploadFileData>{};
-    uploadParametersData.reserve(_filesToUpload.size());
+    uploadParametersData.reserve(batch._filesToUpload.size());
 
-    int timeout = 0;
-    for(auto &singleFile : _filesToUpload) {
+    qint64 bytes = 0;
+    for(auto &singleFile : batch._filesToUpload) {
         // job takes ownership of device via a QScopedPointer. Job deletes itself when finishing
         auto device = std::make_unique<UploadDevice>(singleFile._localPath,
                                                      0,
@@ -241,48 +319,60 @@ void BulkPropagatorJob::triggerUpload()
                 emit propagator()->seenLockedFile(singleFile._localPath);
             }
 
-            abortWithError(singleFile._item, SyncFileItem::NormalError, device->errorString());
-            emit finished(SyncFileItem::NormalError);
+            // The other batches keep uploading, none of the files of this one is sent
+            const auto errorString = device->errorString();
+            for (const auto &batchFile : batch._filesToUpload) {
+                done(batchFile._item, SyncFileItem::NormalError, errorString, ErrorCategory::GenericError);
+            }
 
+            const auto batchIt = std::find_if(_batches.begin(), _batches.end(), [&batch](const auto &entry) {
+                return &entry.second == &batch;
+            });
+            Q_ASSERT(batchIt != _batches.end());
+            if (batchIt != _batches.end()) {
+                _batches.erase(batchIt);
+            }
+            checkPropagationIsDone();
             return;
         }
 
         singleFile._headers["X-File-Path"] = singleFile._remotePath.toUtf8();
         uploadParametersData.push_back({std::move(device), singleFile._headers});
-        timeout += singleFile._fileSize;
+        bytes += singleFile._fileSize;
     }
 
     const auto bulkUploadUrl = Utility::concatUrlPath(propagator()->account()->url(), QStringLiteral("/remote.php/dav/bulk"));
     auto job = new PutMultiFileJob(propagator()->account(), bulkUploadUrl, std::move(uploadParametersData), this);
     connect(job, &PutMultiFileJob::finishedSignal, this, &BulkPropagatorJob::slotPutFinished);
 
-    for(auto &singleFile : _filesToUpload) {
+    for(auto &singleFile : batch._filesToUpload) {
         connect(job, &PutMultiFileJob::uploadProgress, this, [this, singleFile] (const qint64 sent, const qint64 total) {
             slotUploadProgress(singleFile._item, sent, total);
         });
     }
 
-    adjustLastJobTimeout(job, timeout);
+    adjustLastJobTimeout(job, bytes);
+    batch._job = job;
+    batch._bytes = bytes;
+    batch._uploadTimer.start();
     _jobs.append(job);
     job->start();
 
-    if (parallelism() == PropagatorJob::JobParallelism::FullParallelism && _jobs.size() < parallelJobsMaximumCount) {
+    if (parallelism() == PropagatorJob::JobParallelism::FullParallelism) {
+        // start checksumming the next batch during the upload of this one
         scheduleSelfOrChild();
     }
 }
 
 void BulkPropagatorJob::checkPropagationIsDone()
 {
-    if (_items.empty()) {
-        if (!_jobs.empty() || !_pendingChecksumFiles.empty()) {
-            // just wait for the other job to finish.
-            return;
-        }
-    } else {
-        if (handleBatchSize()) {
-            scheduleSelfOrChild();
-            return;
-        }
+    if (!_items.empty() && handleBatchSize()) {
+        scheduleSelfOrChild();
+    }
+
+    if (!_batches.empty()) {
+        // just wait for the other batches to finish.
+        return;
     }
 
     qCInfo(lcBulkPropagatorJob) << "final status" << _finalStatus;
@@ -319,9 +409,8 @@ void BulkPropagatorJob::slotStartUpload(SyncFileItemPtr item,
     const auto originalFilePath = propagator()->fullLocalPath(item->_file);
 
     if (!FileSystem::fileExists(fullFilePath)) {
-        _pendingChecksumFiles.remove(item->_file);
         slotOnErrorStartFolderUnlock(item, SyncFileItem::SoftError, tr("File Removed (start upload) %1").arg(fullFilePath), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        finishPendingChecksum(fileToUpload._batchId);
         return;
     }
 
@@ -331,21 +420,19 @@ void BulkPropagatorJob::slotStartUpload(SyncFileItemPtr item,
 
     item->_modtime = FileSystem::getModTime(originalFilePath);
     if (item->_modtime <= 0) {
-        _pendingChecksumFiles.remove(item->_file);
         slotOnErrorStartFolderUnlock(item, SyncFileItem::NormalError, tr("File %1 has invalid modification time. Do not upload to the server.").arg(QDir::toNativeSeparators(item->_file)), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        finishPendingChecksum(fileToUpload._batchId);
         return;
     }
     if (prevModtime != item->_modtime) {
         propagator()->_anotherSyncNeeded = true;
-        _pendingChecksumFiles.remove(item->_file);
 
         qCDebug(lcBulkPropagatorJob) << "trigger another sync after checking modified time of item" << item->_file
                                      << "prevModtime" << prevModtime
                                      << "Curr" << item->_modtime;
 
         slotOnErrorStartFolderUnlock(item, SyncFileItem::SoftError, tr("Local file changed during syncing. It will be resumed."), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        finishPendingChecksum(fileToUpload._batchId);
         return;
     }
 
@@ -357,9 +444,8 @@ void BulkPropagatorJob::slotStartUpload(SyncFileItemPtr item,
     // or not yet fully copied to the destination.
     if (fileIsStillChanging(*item)) {
         propagator()->_anotherSyncNeeded = true;
-        _pendingChecksumFiles.remove(item->_file);
         slotOnErrorStartFolderUnlock(item, SyncFileItem::SoftError, tr("Local file changed during sync."), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        finishPendingChecksum(fileToUpload._batchId);
         return;
     }
 
@@ -394,8 +480,8 @@ void BulkPropagatorJob::slotPutFinishedOneFile(const BulkUploadItem &singleFile,
     if (singleFile._item->_httpErrorCode != 200) {
         commonErrorHandling(singleFile._item, fileReply[QStringLiteral("message")].toString());
         const auto exceptionParsed = getExceptionFromReply(job->reply());
-        singleFile._item->_errorExceptionName = exceptionParsed.first;
-        singleFile._item->_errorExceptionMessage = exceptionParsed.second;
+        singleFile._item->setErrorExceptionName(exceptionParsed.first);
+        singleFile._item->setErrorExceptionMessage(exceptionParsed.second);
         return;
     }
 
@@ -458,13 +544,26 @@ void BulkPropagatorJob::slotPutFinished()
 
     slotJobDestroyed(job); // remove it from the _jobs list
 
+    const auto batch = std::find_if(_batches.begin(), _batches.end(), [job](const auto &batch) {
+        return batch.second._job == job;
+    });
+    Q_ASSERT(batch != _batches.end());
+    if (batch == _batches.end()) {
+        return;
+    }
+    auto &filesToUpload = batch->second._filesToUpload;
+
     const auto jobError = job->reply()->error();
 
     const auto replyData = job->reply()->readAll();
     const auto replyJson = QJsonDocument::fromJson(replyData);
     const auto fullReplyObject = replyJson.object();
 
-    for (const auto &singleFile : _filesToUpload) {
+    if (jobError == QNetworkReply::NoError) {
+        adjustBatchSize(batch->second);
+    }
+
+    for (const auto &singleFile : filesToUpload) {
         if (!fullReplyObject.contains(singleFile._remotePath)) {
             if (jobError != QNetworkReply::NoError) {
                 singleFile._item->_status = SyncFileItem::NormalError;
@@ -476,7 +575,10 @@ void BulkPropagatorJob::slotPutFinished()
         slotPutFinishedOneFile(singleFile, job, singleReplyObject);
     }
 
-    finalize(fullReplyObject);
+    finalize(batch->second, fullReplyObject);
+
+    _batches.erase(batch);
+    checkPropagationIsDone();
 }
 
 void BulkPropagatorJob::slotUploadProgress(SyncFileItemPtr item, qint64 sent, qint64 total)
@@ -537,11 +639,11 @@ void BulkPropagatorJob::finalizeOneFile(const BulkUploadItem &oneFile)
     propagator()->_journal->commit("upload file start");
 }
 
-void BulkPropagatorJob::finalize(const QJsonObject &fullReply)
+void BulkPropagatorJob::finalize(UploadBatch &batch, const QJsonObject &fullReply)
 {
     qCDebug(lcBulkPropagatorJob) << "Received a full reply" << fullReply;
 
-    for(auto singleFileIt = std::begin(_filesToUpload); singleFileIt != std::end(_filesToUpload); ) {
+    for(auto singleFileIt = std::begin(batch._filesToUpload); singleFileIt != std::end(batch._filesToUpload); ) {
         const auto &singleFile = *singleFileIt;
 
         if (!fullReply.contains(singleFile._remotePath)) {
@@ -555,10 +657,8 @@ void BulkPropagatorJob::finalize(const QJsonObject &fullReply)
 
         done(singleFile._item, singleFile._item->_status, {}, ErrorCategory::GenericError);
 
-        singleFileIt = _filesToUpload.erase(singleFileIt);
+        singleFileIt = batch._filesToUpload.erase(singleFileIt);
     }
-
-    checkPropagationIsDone();
 }
 
 void BulkPropagatorJob::done(SyncFileItemPtr item,
@@ -21,7 +21,9 @@
 #include <QVector>
 #include <QMap>
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <deque>
+#include <map>
 
 namespace OCC {
 
@@ -45,6 +47,7 @@ class BulkPropagatorJob : public PropagatorJob
       QString _file; /// I'm still unsure if I should use a SyncFilePtr here.
       QString _path; /// the full path on disk.
       qint64 _size = 0LL;
+      int _batchId = 0; /// the upload batch the file is sent with
     };
 
     struct BulkUploadItem
@@ -58,6 +61,20 @@ class BulkPropagatorJob : public PropagatorJob
         QMap<QByteArray, QByteArray> _headers;
     };
 
+    /* The files that are sent together in one PutMultiFileJob.
+     *
+     * The checksums of a batch are computed while the previous
+     * batches are still being uploaded.
+     */
+    struct UploadBatch
+    {
+        std::vector<BulkUploadItem> _filesToUpload;
+        int _pendingChecksums = 0;
+        qint64 _bytes = 0;
+        PutMultiFileJob *_job = nullptr; /// null while the checksums are computed
+        QElapsedTimer _uploadTimer;
+    };
+
 public:
     explicit BulkPropagatorJob(OwncloudPropagator *propagator,
                                const std::deque<SyncFileItemPtr> &items);
@@ -99,7 +116,7 @@ private:
     void adjustLastJobTimeout(AbstractNetworkJob *job,
                               qint64 fileSize) const;
 
-    void finalize(const QJsonObject &fullReply);
+    void finalize(UploadBatch &batch, const QJsonObject &fullReply);
 
     void finalizeOneFile(const BulkUploadItem &oneFile);
 
@@ -151,24 +168,39 @@ private:
     void handleJobDoneErrors(SyncFileItemPtr item,
                              SyncFileItem::Status status);
 
-    void triggerUpload();
+    void triggerUpload(UploadBatch &batch);
+
+    /** One file of the batch doesn't wait for its checksum anymore
+     *
+     * Uploads the batch once all of its files are ready.
+     */
+    void finishPendingChecksum(int batchId);
+
+    [[nodiscard]] bool isPreparingBatch() const;
+
+    [[nodiscard]] int maximumParallelBatches() const;
 
     void checkPropagationIsDone();
 
     bool handleBatchSize();
 
+    /** Scales the limits of the next batches by how long the upload of \a batch took */
+    void adjustBatchSize(const UploadBatch &batch);
+
     std::deque<SyncFileItemPtr> _items;
 
     QVector<AbstractNetworkJob *> _jobs; /// network jobs that are currently in transit
 
-    QSet<QString> _pendingChecksumFiles;
+    std::map<int, UploadBatch> _batches; /// batches being checksummed or uploaded, by id
 
-    std::vector<BulkUploadItem> _filesToUpload;
+    int _nextBatchId = 0;
 
     qint64 _sentTotal = 0;
 
     SyncFileItem::Status _finalStatus = SyncFileItem::Status::NoStatus;
     int _currentBatchSize = 0;
+    qint64 _currentBatchBytes = 0;
+    bool _batchSizeReducedAfterError = false;
 };
 
 }
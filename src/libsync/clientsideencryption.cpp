@@ -23,6 +23,8 @@
 #include "creds/abstractcredentials.h"
 #include "common/utility.h"
 #include "common/constants.h"
+#include "common/filesystembase.h"
+#include "filesystem.h"
 #include <common/checksums.h>
 #include "wordlist.h"
 
@@ -64,6 +66,7 @@
 #include <algorithm>
 #include <optional>
 #include <cstdio>
+#include <cstring>
 
 QDebug operator<<(QDebug out, const std::string& str)
 {
@@ -102,6 +105,8 @@ constexpr char e2e_public[] = "_e2e-public";
 constexpr char e2e_mnemonic[] = "_e2e-mnemonic";
 
 constexpr qint64 blockSize = 1024;
+// The network stack pulls upload data in larger pieces than blockSize
+constexpr qint64 streamingEncryptionBlockSize = 64 * 1024;
 
 QList<QByteArray> oldCipherFormatSplit(const QByteArray &cipher)
 {
@@ -2923,6 +2928,223 @@ bool EncryptionHelper::StreamingDecryptor::isFinished() const
     return _isFinished;
 }
 
+EncryptionHelper::StreamingEncryptor::StreamingEncryptor(const QString &fileName, const QByteArray &key, const QByteArray &iv)
+    : _input(fileName)
+    , _key(key)
+    , _iv(iv)
+{
+}
+
+bool EncryptionHelper::StreamingEncryptor::open()
+{
+    if (!FileSystem::openAndSeekFileSharedRead(&_input, &_errorString, 0)) {
+        qCWarning(lcCse()) << "Could not open input file for reading" << _errorString;
+        return false;
+    }
+    _inputSize = _input.size();
+    _inputModTime = FileSystem::getModTime(_input.fileName());
+    return restart();
+}
+
+void EncryptionHelper::StreamingEncryptor::addCheckpoint(qint64 pos)
+{
+    pos = qBound(0ll, pos, _inputSize);
+    auto &checkpoint = _checkpoints[pos];
+    if (checkpoint || pos != _encrypted) {
+        // encryptNextBlock() takes the copy when it gets to pos
+        return;
+    }
+
+    saveCheckpoint(checkpoint);
+}
+
+void EncryptionHelper::StreamingEncryptor::saveCheckpoint(std::unique_ptr<CipherCtx> &checkpoint)
+{
+    checkpoint = std::make_unique<CipherCtx>();
+    if (!EVP_CIPHER_CTX_copy(*checkpoint, _ctx)) {
+        qCWarning(lcCse()) << "Could not copy the cipher state at" << _encrypted;
+        checkpoint.reset();
+    }
+}
+
+bool EncryptionHelper::StreamingEncryptor::inputUnchanged()
+{
+    if (FileSystem::getSize(_input.fileName()) == _inputSize && FileSystem::getModTime(_input.fileName()) == _inputModTime) {
+        return true;
+    }
+
+    // Encrypting other data with the same key and IV again would reveal both
+    qCWarning(lcCse()) << "The file" << _input.fileName() << "changed while it was being encrypted";
+    _errorString = QStringLiteral("File changed while it was being encrypted");
+    return false;
+}
+
+bool EncryptionHelper::StreamingEncryptor::rewind(qint64 pos)
+{
+    if (!inputUnchanged()) {
+        return false;
+    }
+
+    auto it = _checkpoints.upper_bound(pos);
+    while (it != _checkpoints.begin()) {
+        --it;
+        if (!it->second) {
+            continue;
+        }
+
+        qCInfo(lcCse()) << "Continuing the encryption of" << _input.fileName() << "at" << it->first << "after" << _encrypted << "bytes";
+        if (!_input.seek(it->first) || !EVP_CIPHER_CTX_copy(_ctx, *it->second)) {
+            _errorString = QStringLiteral("Could not restore the encryption");
+            return false;
+        }
+        _encrypted = it->first;
+        _block.clear();
+        _blockStart = it->first;
+        return true;
+    }
+
+    return restart();
+}
+
+bool EncryptionHelper::StreamingEncryptor::restart()
+{
+    if (_encrypted > 0) {
+        qCInfo(lcCse()) << "Restarting the encryption of" << _input.fileName() << "after" << _encrypted << "bytes";
+    }
+    _encrypted = 0;
+    _block.clear();
+    _blockStart = 0;
+
+    if (!_ctx || !_input.seek(0)) {
+        _errorString = QStringLiteral("Could not start the encryption");
+        return false;
+    }
+
+    if (!EVP_EncryptInit_ex(_ctx, EVP_aes_128_gcm(), nullptr, nullptr, nullptr)) {
+        qCWarning(lcCse()) << "Could not init cipher";
+        _errorString = QStringLiteral("Could not init cipher");
+        return false;
+    }
+
+    EVP_CIPHER_CTX_set_padding(_ctx, 0);
+
+    if (!EVP_CIPHER_CTX_ctrl(_ctx, EVP_CTRL_GCM_SET_IVLEN, _iv.size(), nullptr)) {
+        qCWarning(lcCse()) << "Could not set iv length";
+        _errorString = QStringLiteral("Could not set iv length");
+        return false;
+    }
+
+    if (!EVP_EncryptInit_ex(_ctx, nullptr, nullptr, reinterpret_cast<const unsigned char *>(_key.constData()), reinterpret_cast<const unsigned char *>(_iv.constData()))) {
+        qCWarning(lcCse()) << "Could not set key and iv";
+        _errorString = QStringLiteral("Could not set key and iv");
+        return false;
+    }
+
+    return true;
+}
+
+bool EncryptionHelper::StreamingEncryptor::encryptNextBlock()
+{
+    _blockStart += _block.size();
+
+    // Blocks end at the checkpoints, the cipher state is copied before the next one
+    auto blockEnd = qMin(_encrypted + streamingEncryptionBlockSize, _inputSize);
+    const auto checkpoint = _checkpoints.lower_bound(_encrypted);
+    if (checkpoint != _checkpoints.end()) {
+        if (checkpoint->first == _encrypted && !checkpoint->second) {
+            saveCheckpoint(checkpoint->second);
+        }
+        const auto next = checkpoint->first > _encrypted ? checkpoint : std::next(checkpoint);
+        if (next != _checkpoints.end()) {
+            blockEnd = qMin(blockEnd, next->first);
+        }
+    }
+
+    if (_encrypted < _inputSize) {
+        const auto data = _input.read(blockEnd - _encrypted);
+        if (data.isEmpty()) {
+            qCWarning(lcCse()) << "Could not read data from file" << _input.fileName() << _input.errorString();
+            _errorString = _input.error() != QFileDevice::NoError ? _input.errorString() : QStringLiteral("File changed while it was being encrypted");
+            return false;
+        }
+
+        // AES-GCM never holds data back, the output has the size of the input
+        _block.resize(data.size());
+        int len = 0;
+        if (!EVP_EncryptUpdate(_ctx, unsignedData(_block), &len, reinterpret_cast<const unsigned char *>(data.constData()), data.size()) || len != data.size()) {
+            qCWarning(lcCse()) << "Could not encrypt";
+            _errorString = QStringLiteral("Could not encrypt");
+            return false;
+        }
+        _encrypted += data.size();
+        return true;
+    }
+
+    // All of the file went through the cipher, the e2EeTag is the last block
+    if (!inputUnchanged()) {
+        return false;
+    }
+
+    QByteArray out(OCC::Constants::e2EeTagSize, '\0');
+    int len = 0;
+    if (1 != EVP_EncryptFinal_ex(_ctx, unsignedData(out), &len) || len != 0) {
+        qCWarning(lcCse()) << "Could finalize encryption";
+        _errorString = QStringLiteral("Could not finalize encryption");
+        return false;
+    }
+
+    QByteArray e2EeTag(OCC::Constants::e2EeTagSize, '\0');
+    if (1 != EVP_CIPHER_CTX_ctrl(_ctx, EVP_CTRL_GCM_GET_TAG, OCC::Constants::e2EeTagSize, unsignedData(e2EeTag))) {
+        qCWarning(lcCse()) << "Could not get e2EeTag";
+        _errorString = QStringLiteral("Could not get e2EeTag");
+        return false;
+    }
+
+    _tag = e2EeTag;
+    _block = e2EeTag;
+    qCDebug(lcCse()) << "File Encrypted Successfully" << _input.fileName();
+    return true;
+}
+
+qint64 EncryptionHelper::StreamingEncryptor::read(qint64 pos, char *data, qint64 maxlen)
+{
+    if (pos < 0 || pos > size()) {
+        return -1;
+    }
+    if (pos == size() || maxlen <= 0) {
+        return 0;
+    }
+
+    if (pos < _blockStart && !rewind(pos)) {
+        return -1;
+    }
+    while (pos >= _blockStart + _block.size()) {
+        if (!encryptNextBlock()) {
+            return -1;
+        }
+    }
+
+    const auto offset = pos - _blockStart;
+    const auto c = qMin(maxlen, _block.size() - offset);
+    std::memcpy(data, _block.constData() + offset, c);
+    return c;
+}
+
+qint64 EncryptionHelper::StreamingEncryptor::size() const
+{
+    return _inputSize + OCC::Constants::e2EeTagSize;
+}
+
+QByteArray EncryptionHelper::StreamingEncryptor::tag() const
+{
+    return _tag;
+}
+
+QString EncryptionHelper::StreamingEncryptor::errorString() const
+{
+    return _errorString;
+}
+
 NextcloudSslCertificate::NextcloudSslCertificate() = default;
 
 NextcloudSslCertificate::NextcloudSslCertificate(const NextcloudSslCertificate &other) = default;
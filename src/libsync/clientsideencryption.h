@@ -38,6 +38,8 @@
 #include <openssl/evp.h>
 
 #include <functional>
+#include <map>
+#include <memory>
 #include <optional>
 
 class QWidget;
@@ -217,6 +219,65 @@ private:
     quint64 _decryptedSoFar = 0;
     quint64 _totalSize = 0;
 };
+
+/**
+ * Encrypts a local file while it is being read
+ *
+ * The output is what fileEncryption() writes: the ciphertext followed by the
+ * e2EeTag. The cipher only runs forward, so reading ahead of the current
+ * position encrypts the data in between. Reading behind it continues from the
+ * closest checkpoint, or from the beginning of the file.
+ *
+ * The key and IV are the same for all of the output, so going back fails if
+ * the size or modification time of the file changed since open().
+ */
+class OWNCLOUDSYNC_EXPORT StreamingEncryptor
+{
+public:
+    StreamingEncryptor(const QString &fileName, const QByteArray &key, const QByteArray &iv);
+    ~StreamingEncryptor() = default;
+
+    /// Opens the input file, size() is fixed from then on
+    bool open();
+
+    /// Reads up to \a maxlen bytes of the output at \a pos, returns -1 on errors
+    qint64 read(qint64 pos, char *data, qint64 maxlen);
+
+    /// Keeps the cipher state at \a pos once the encryption gets there, e.g. at the start of a chunk
+    void addCheckpoint(qint64 pos);
+
+    [[nodiscard]] qint64 size() const;
+
+    /// The e2EeTag, empty until the whole file was encrypted
+    [[nodiscard]] QByteArray tag() const;
+
+    [[nodiscard]] QString errorString() const;
+
+private:
+    Q_DISABLE_COPY(StreamingEncryptor)
+
+    bool restart();
+    bool rewind(qint64 pos);
+    void saveCheckpoint(std::unique_ptr<CipherCtx> &checkpoint);
+    bool encryptNextBlock();
+    [[nodiscard]] bool inputUnchanged();
+
+    QFile _input;
+    QByteArray _key;
+    QByteArray _iv;
+    CipherCtx _ctx;
+    qint64 _inputSize = 0;
+    time_t _inputModTime = 0;
+    /// Copies of the cipher state by input position, null until the encryption got there
+    std::map<qint64, std::unique_ptr<CipherCtx>> _checkpoints;
+    /// Input bytes that went through the cipher
+    qint64 _encrypted = 0;
+    /// Output at [_blockStart, _blockStart + _block.size())
+    QByteArray _block;
+    qint64 _blockStart = 0;
+    QByteArray _tag;
+    QString _errorString;
+};
 }
 
 class OWNCLOUDSYNC_EXPORT NextcloudSslCertificate
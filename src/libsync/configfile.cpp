@@ -68,12 +68,15 @@ static constexpr char updateChannelC[] = "updateChannel";
 static constexpr char overrideServerUrlC[] = "overrideServerUrl";
 static constexpr char overrideLocalDirC[] = "overrideLocalDir";
 static constexpr char isVfsEnabledC[] = "isVfsEnabled";
+static constexpr char xattrVfsSparsePlaceholdersC[] = "xattrVfsSparsePlaceholders";
 static constexpr char geometryC[] = "geometry";
 static constexpr char timeoutC[] = "timeout";
 static constexpr char chunkSizeC[] = "chunkSize";
 static constexpr char minChunkSizeC[] = "minChunkSize";
 static constexpr char maxChunkSizeC[] = "maxChunkSize";
 static constexpr char targetChunkUploadDurationC[] = "targetChunkUploadDuration";
+static constexpr char maxConcurrentFolderSyncsC[] = "maxConcurrentFolderSyncs";
+static constexpr char maxConcurrentFolderSyncsPerAccountC[] = "maxConcurrentFolderSyncsPerAccount";
 static constexpr char automaticLogDirC[] = "logToTemporaryLogDir";
 static constexpr char logDirC[] = "logDir";
 static constexpr char logDebugC[] = "logDebug";
@@ -285,6 +288,18 @@ chrono::milliseconds ConfigFile::targetChunkUploadDuration() const
     return millisecondsValue(settings, targetChunkUploadDurationC, chrono::minutes(1));
 }
 
+int ConfigFile::maxConcurrentFolderSyncs() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return qMax(1, settings.value(QLatin1String(maxConcurrentFolderSyncsC), 3).toInt());
+}
+
+int ConfigFile::maxConcurrentFolderSyncsPerAccount() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return qMax(1, settings.value(QLatin1String(maxConcurrentFolderSyncsPerAccountC), 2).toInt());
+}
+
 void ConfigFile::setOptionalServerNotifications(bool show)
 {
     QSettings settings(configFile(), QSettings::IniFormat);
@@ -805,6 +820,18 @@ void ConfigFile::setVfsEnabled(bool enabled)
     settings.setValue({isVfsEnabledC}, enabled);
 }
 
+bool ConfigFile::xattrVfsSparsePlaceholders() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value({xattrVfsSparsePlaceholdersC}, false).toBool();
+}
+
+void ConfigFile::setXattrVfsSparsePlaceholders(bool enabled)
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    settings.setValue({xattrVfsSparsePlaceholdersC}, enabled);
+}
+
 void ConfigFile::setProxyType(int proxyType,
     const QString &host,
     int port, bool needsAuth,
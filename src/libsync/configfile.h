@@ -184,6 +184,10 @@ public:
     [[nodiscard]] qint64 minChunkSize() const;
     [[nodiscard]] std::chrono::milliseconds targetChunkUploadDuration() const;
 
+    /// How many sync folders may sync at the same time, in total and per account
+    [[nodiscard]] int maxConcurrentFolderSyncs() const;
+    [[nodiscard]] int maxConcurrentFolderSyncsPerAccount() const;
+
     void saveGeometry(QWidget *w);
     void restoreGeometry(QWidget *w);
 
@@ -217,6 +221,10 @@ public:
     [[nodiscard]] bool isVfsEnabled() const;
     void setVfsEnabled(bool enabled);
 
+    /// Whether the Linux xattr vfs creates sparse placeholders with the real file size
+    [[nodiscard]] bool xattrVfsSparsePlaceholders() const;
+    void setXattrVfsSparsePlaceholders(bool enabled);
+
     void saveGeometryHeader(QHeaderView *header);
     void restoreGeometryHeader(QHeaderView *header);
 
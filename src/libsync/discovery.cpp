@@ -29,6 +29,7 @@
 #include <QFileInfo>
 #include <QFile>
 #include <QThreadPool>
+#include <QCryptographicHash>
 #include <common/checksums.h>
 #include <common/constants.h>
 #include "csync_exclude.h"
@@ -95,8 +96,6 @@ void ProcessDirectoryJob::start()
         }
     }
 
-    _discoveryData->_noCaseConflictRecordsInDb = _discoveryData->_statedb->caseClashConflictRecordPaths().isEmpty();
-
     if (_queryServer == NormalQuery) {
         _serverJob = startAsyncServerQuery();
     } else {
@@ -110,6 +109,7 @@ void ProcessDirectoryJob::start()
             && !_discoveryData->isInSelectiveSyncBlackList(_currentFolder._original)) {
             _queryLocal = ParentNotChanged;
             qCDebug(lcDisco) << "adjusted discovery policy" << _currentFolder._server << _queryServer << _currentFolder._local << _queryLocal;
+            _discoveryData->dropLocalDirectoryPrefetches({_currentFolder._local});
         }
     }
 
@@ -140,9 +140,16 @@ void ProcessDirectoryJob::process()
     }
     _serverNormalQueryEntries.clear();
 
+    // Without local or remote changes only the subdirectories need to be looked at
+    const auto onlySubdirectories = filesUnchangedSinceLastSync() && collectUnchangedLocalSubdirectories(entries);
+    if (onlySubdirectories) {
+        qCInfo(lcDisco) << "No changes in the files of" << _currentFolder._local << "since last sync, only processing subdirectories";
+        _localDirectoryDigest.clear();
+    }
+
     // fetch all the name from the DB
     auto pathU8 = _currentFolder._original.toUtf8();
-    if (!_discoveryData->_statedb->listFilesInPath(pathU8, [&](const SyncJournalFileRecord &rec) {
+    if (!onlySubdirectories && !_discoveryData->_statedb->listFilesInPath(pathU8, [&](const SyncJournalFileRecord &rec) {
             auto name = pathU8.isEmpty() ? rec._path : QString::fromUtf8(rec._path.constData() + (pathU8.size() + 1));
             if (rec.isVirtualFile() && isVfsWithSuffix())
                 chopVirtualFileSuffix(name);
@@ -154,8 +161,10 @@ void ProcessDirectoryJob::process()
         return;
     }
 
-    for (auto &e : _localNormalQueryEntries) {
-        entries[e.name].localEntry = e;
+    if (!onlySubdirectories) {
+        for (auto &e : _localNormalQueryEntries) {
+            entries[e.name].localEntry = e;
+        }
     }
     if (isVfsWithSuffix()) {
         // For vfs-suffix the local data for suffixed files should usually be associated
@@ -188,6 +197,11 @@ void ProcessDirectoryJob::process()
     }
     _localNormalQueryEntries.clear();
 
+    if (!preloadRenameCandidates(entries)) {
+        dbError();
+        return;
+    }
+
     //
     // Iterate over entries and process them
     //
@@ -267,9 +281,172 @@ void ProcessDirectoryJob::process()
         processFile(std::move(path), e.localEntry, e.serverEntry, e.dbEntry);
     }
     _discoveryData->_listExclusiveFiles.clear();
+
+    // Subdirectories that were excluded, blacklisted etc. or that won't list their local
+    // directory themselves won't take their prefetched listing
+    if (!_prefetchedLocalSubdirectories.isEmpty()) {
+        for (const auto job : _queuedJobs) {
+            if (job->_queryLocal == NormalQuery) {
+                _prefetchedLocalSubdirectories.removeOne(job->_currentFolder._local);
+            }
+        }
+        _discoveryData->dropLocalDirectoryPrefetches(_prefetchedLocalSubdirectories);
+        _prefetchedLocalSubdirectories.clear();
+    }
+
     QTimer::singleShot(0, _discoveryData, &DiscoveryPhase::scheduleMoreJobs);
 }
 
+bool ProcessDirectoryJob::preloadRenameCandidates(const std::map<QString, Entries> &entries)
+{
+    QVector<quint64> inodes;
+    QVector<QByteArray> fileIds;
+    for (const auto &f : entries) {
+        const auto &e = f.second;
+        if (e.dbEntry.isValid()) {
+            continue;
+        }
+        if (e.localEntry.isValid() && e.localEntry.inode) {
+            inodes.append(e.localEntry.inode);
+        } else if (e.serverEntry.isValid() && !e.serverEntry.fileId.isEmpty()) {
+            fileIds.append(e.serverEntry.fileId);
+        }
+    }
+
+    _preloadedInodes = QSet<quint64>(inodes.cbegin(), inodes.cend());
+    _renameCandidatesByInode.clear();
+    _preloadedFileIds = QSet<QByteArray>(fileIds.cbegin(), fileIds.cend());
+    _renameCandidatesByFileId.clear();
+    _preloadedRenameCandidatesGeneration = _discoveryData->_dbRecordsGeneration;
+
+    const auto inodesOk = _discoveryData->_statedb->getFileRecordsByInodes(inodes, [this](const SyncJournalFileRecord &rec) {
+        // getFileRecordByInode() also only yields one record per inode
+        if (!_renameCandidatesByInode.contains(rec._inode)) {
+            _renameCandidatesByInode.insert(rec._inode, rec);
+        }
+    });
+    const auto fileIdsOk = inodesOk && _discoveryData->_statedb->getFileRecordsByFileIds(fileIds, [this](const SyncJournalFileRecord &rec) {
+        _renameCandidatesByFileId.insert(rec._fileId, rec);
+    });
+    if (!fileIdsOk) {
+        _preloadedInodes.clear();
+        _preloadedFileIds.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ProcessDirectoryJob::renameCandidateByInode(quint64 inode, SyncJournalFileRecord *rec)
+{
+    if (_preloadedRenameCandidatesGeneration != _discoveryData->_dbRecordsGeneration || !_preloadedInodes.contains(inode)) {
+        return _discoveryData->_statedb->getFileRecordByInode(inode, rec);
+    }
+    *rec = _renameCandidatesByInode.value(inode);
+    return true;
+}
+
+bool ProcessDirectoryJob::renameCandidatesByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    if (_preloadedRenameCandidatesGeneration != _discoveryData->_dbRecordsGeneration || !_preloadedFileIds.contains(fileId)) {
+        return _discoveryData->_statedb->getFileRecordsByFileId(fileId, rowCallback);
+    }
+    // Copy: the callback may start jobs that bump the generation and clear the preloaded records
+    const auto records = _renameCandidatesByFileId.values(fileId);
+    for (const auto &rec : records) {
+        rowCallback(rec);
+    }
+    return true;
+}
+
+bool ProcessDirectoryJob::filesUnchangedSinceLastSync()
+{
+    const auto vfs = _discoveryData->_syncOptions._vfs;
+    // The root directory always gets processed, its server side is always queried
+    if (_queryLocal != NormalQuery
+        || _currentFolder._original.isEmpty()
+        || (vfs && vfs->mode() != Vfs::Off)
+        || isInsideEncryptedTree()
+        || !_discoveryData->_listExclusiveFiles.isEmpty()
+        || _currentFolder._local != _currentFolder._original
+        || _currentFolder._target != _currentFolder._original) {
+        return false;
+    }
+
+    // The file system returns the entries in no particular order
+    QVector<const LocalInfo *> sortedEntries;
+    sortedEntries.reserve(_localNormalQueryEntries.size());
+    for (const auto &e : std::as_const(_localNormalQueryEntries)) {
+        sortedEntries.append(&e);
+    }
+    std::sort(sortedEntries.begin(), sortedEntries.end(), [](const LocalInfo *a, const LocalInfo *b) {
+        return a->name < b->name;
+    });
+
+    // Settings that change which entries are excluded are part of the digest, too
+    QByteArray listing = _discoveryData->_exclusionFingerprint;
+    _localFileCount = 0;
+    auto hasConflictFiles = false;
+    for (const auto e : std::as_const(sortedEntries)) {
+        // SyncEngine reports unresolved conflicts and keeps their records from the NONE items
+        hasConflictFiles = hasConflictFiles || Utility::isConflictFile(e->name);
+
+        // A directory's mtime changes with its content, which its own digest covers
+        const qint64 fields[] = {
+            static_cast<qint64>(e->type),
+            static_cast<qint64>(e->inode),
+            e->isDirectory ? 0 : static_cast<qint64>(e->modtime),
+            e->isDirectory ? 0 : static_cast<qint64>(e->size),
+            (e->isHidden ? 1 : 0) | (e->isSymLink ? 2 : 0) | (e->isMetadataMissing ? 4 : 0) | (e->isPermissionsInvalid ? 8 : 0),
+        };
+        listing.append('\0');
+        listing.append(e->name.toUtf8());
+        listing.append('\0');
+        listing.append(reinterpret_cast<const char *>(fields), sizeof(fields));
+        if (!e->isDirectory) {
+            ++_localFileCount;
+        }
+    }
+    _localDirectoryDigest = QCryptographicHash::hash(listing, QCryptographicHash::Sha1);
+    _storedLocalDirectoryDigest = _discoveryData->_statedb->localDirectoryDigest(_currentFolder._original);
+
+    return _queryServer == ParentNotChanged
+        && !hasConflictFiles
+        && _localDirectoryDigest == _storedLocalDirectoryDigest
+        && _discoveryData->_hasReportedLocalChanges
+        && !_discoveryData->_hasReportedLocalChanges(_currentFolder._local);
+}
+
+bool ProcessDirectoryJob::collectUnchangedLocalSubdirectories(std::map<QString, Entries> &entries)
+{
+    std::map<QString, Entries> subdirectories;
+    for (const auto &e : std::as_const(_localNormalQueryEntries)) {
+        if (!e.isDirectory) {
+            continue;
+        }
+        auto &entry = subdirectories[e.name];
+        if (!_discoveryData->_statedb->getFileRecord(PathTuple::pathAppend(_currentFolder._original, e.name), &entry.dbEntry)
+            || !entry.dbEntry.isValid() || !entry.dbEntry.isDirectory()) {
+            return false;
+        }
+        setupDbPinStateActions(entry.dbEntry);
+        entry.localEntry = e;
+    }
+    entries.merge(subdirectories);
+    return true;
+}
+
+void ProcessDirectoryJob::updateLocalDirectoryDigest()
+{
+    if (_localDirectoryDigest.isEmpty()) {
+        return;
+    }
+    const auto inSync = _localFilesInSync && _localFilesInSyncCount == _localFileCount;
+    const auto digest = inSync ? _localDirectoryDigest : QByteArray();
+    if (digest != _storedLocalDirectoryDigest) {
+        _discoveryData->_statedb->setLocalDirectoryDigest(_currentFolder._original, digest);
+    }
+}
+
 bool ProcessDirectoryJob::handleExcluded(const QString &path, const Entries &entries, const std::map<QString, Entries> &allEntries, const bool isHidden, const bool isBlacklisted)
 {
     const auto isDirectory = entries.localEntry.isDirectory || entries.serverEntry.isDirectory;
@@ -607,7 +784,7 @@ void ProcessDirectoryJob::processFile(PathTuple path,
     item->_originalFile = path._original;
     item->_previousSize = dbEntry._fileSize;
     item->_previousModtime = dbEntry._modtime;
-    item->_discoveryResult = std::move(processingLog);
+    item->setDiscoveryResult(processingLog);
 
     if (dbEntry._modtime == localEntry.modtime && dbEntry._type == ItemTypeVirtualFile && localEntry.type == ItemTypeFile) {
         item->_type = ItemTypeFile;
@@ -737,8 +914,8 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(const SyncFileItemPtr &it
     item->_lastShareStateFetchedTimestamp = QDateTime::currentMSecsSinceEpoch();
     item->_type = serverEntry.isDirectory ? ItemTypeDirectory : ItemTypeFile;
     item->_etag = serverEntry.etag;
-    item->_directDownloadUrl = serverEntry.directDownloadUrl;
-    item->_directDownloadCookies = serverEntry.directDownloadCookies;
+    item->setDirectDownloadUrl(serverEntry.directDownloadUrl);
+    item->setDirectDownloadCookies(serverEntry.directDownloadCookies);
     item->_e2eEncryptionStatus = serverEntry.isE2eEncrypted() ? SyncFileItem::EncryptionStatus::Encrypted : SyncFileItem::EncryptionStatus::NotEncrypted;
     if (serverEntry.isE2eEncrypted()) {
         item->_e2eEncryptionServerCapability = EncryptionStatusEnums::fromEndToEndEncryptionApiVersion(_discoveryData->_account->capabilities().clientSideEncryptionVersion());
@@ -757,16 +934,16 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(const SyncFileItemPtr &it
         return serverEntry.e2eMangledName.mid(rootPath.length());
     }();
     item->_locked = serverEntry.locked;
-    item->_lockOwnerDisplayName = serverEntry.lockOwnerDisplayName;
-    item->_lockOwnerId = serverEntry.lockOwnerId;
-    item->_lockOwnerType = serverEntry.lockOwnerType;
-    item->_lockEditorApp = serverEntry.lockEditorApp;
-    item->_lockTime = serverEntry.lockTime;
-    item->_lockTimeout = serverEntry.lockTimeout;
-    item->_lockToken = serverEntry.lockToken;
+    item->setLockOwnerDisplayName(serverEntry.lockOwnerDisplayName);
+    item->setLockOwnerId(serverEntry.lockOwnerId);
+    item->setLockOwnerType(serverEntry.lockOwnerType);
+    item->setLockEditorApp(serverEntry.lockEditorApp);
+    item->setLockTime(serverEntry.lockTime);
+    item->setLockTimeout(serverEntry.lockTimeout);
+    item->setLockToken(serverEntry.lockToken);
 
     item->_isLivePhoto = serverEntry.isLivePhoto;
-    item->_livePhotoFile = serverEntry.livePhotoFile;
+    item->setLivePhotoFile(serverEntry.livePhotoFile);
 
     // Check for missing server data
     {
@@ -1059,7 +1236,7 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(const SyncFileItemPtr &it
             async = true;
         }
     };
-    if (!_discoveryData->_statedb->getFileRecordsByFileId(serverEntry.fileId, renameCandidateProcessing)) {
+    if (!renameCandidatesByFileId(serverEntry.fileId, renameCandidateProcessing)) {
         dbError();
         return;
     }
@@ -1175,6 +1352,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
         } else if (noServerEntry) {
             // Not locally, not on the server. The entry is stale!
             qCInfo(lcDisco) << "Stale DB entry";
+            ++_discoveryData->_dbRecordsGeneration;
             if (!_discoveryData->_statedb->deleteFileRecord(path._original, true)) {
                 emit _discoveryData->fatalError(tr("Error while deleting file record %1 from the database").arg(path._original), ErrorCategory::GenericError);
                 qCWarning(lcDisco) << "Failed to delete a file record from the local DB" << path._original;
@@ -1358,7 +1536,9 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
         item->_instruction = CSYNC_INSTRUCTION_CONFLICT;
     }
 
-    auto conflictRecord = _discoveryData->_statedb->caseConflictRecordByBasePath(item->_file);
+    const auto conflictRecord = _discoveryData->_noCaseConflictRecordsInDb
+        ? ConflictRecord{} :
+        _discoveryData->_statedb->caseConflictRecordByBasePath(item->_file);
     if (conflictRecord.isValid() && QString::fromUtf8(conflictRecord.path).contains(QStringLiteral("(case clash from"))) {
         qCInfo(lcDisco) << "should ignore" << item->_file << "has already a case clash conflict record" << conflictRecord.path;
 
@@ -1384,7 +1564,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
 
     // Check if it is a move
     OCC::SyncJournalFileRecord base;
-    if (!_discoveryData->_statedb->getFileRecordByInode(localEntry.inode, &base)) {
+    if (!renameCandidateByInode(localEntry.inode, &base)) {
         dbError();
         return;
     }
@@ -1504,6 +1684,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
         if (wasDeletedOnClient.first) {
             // More complicated. The REMOVE is canceled. Restore will happen next sync.
             qCInfo(lcDisco) << "Undid remove instruction on source" << originalPath;
+            ++_discoveryData->_dbRecordsGeneration;
             if (!_discoveryData->_statedb->deleteFileRecord(originalPath, true)) {
                 qCWarning(lcDisco) << "Failed to delete a file record from the local DB" << originalPath;
             }
@@ -1667,6 +1848,7 @@ void ProcessDirectoryJob::processFileConflict(const SyncFileItemPtr &item, Proce
             rec._sharedByMe = serverEntry.sharedByMe;
             rec._lastShareStateFetchedTimestamp = QDateTime::currentMSecsSinceEpoch();
             rec._checksumHeader = serverEntry.checksumHeader;
+            ++_discoveryData->_dbRecordsGeneration;
             const auto result = _discoveryData->_statedb->setFileRecord(rec);
             if (!result) {
                 qCWarning(lcDisco) << "Error when setting the file record to the database" << rec._path << result.error();
@@ -1786,6 +1968,20 @@ void ProcessDirectoryJob::processFileFinalize(
         recurse = false;
     }
 
+    // Only removals log how they were discovered, large sync plans can't afford the text for every item
+    if (item->_instruction != CSYNC_INSTRUCTION_REMOVE) {
+        item->setDiscoveryResult({});
+    }
+
+    // Only directories whose files all ended up in sync can store their listing digest
+    if (item->_instruction == CSYNC_INSTRUCTION_NONE) {
+        if (!item->isDirectory()) {
+            ++_localFilesInSyncCount;
+        }
+    } else if (!item->isDirectory() || item->_instruction != CSYNC_INSTRUCTION_UPDATE_METADATA) {
+        _localFilesInSync = false;
+    }
+
     if (!(item->isDirectory() ||
           (!_discoveryData->_syncOptions._vfs || _discoveryData->_syncOptions._vfs->mode() != OCC::Vfs::Off) ||
           item->_type != CSyncEnums::ItemTypeVirtualFile ||
@@ -2101,6 +2297,7 @@ int ProcessDirectoryJob::processSubJobs(int nbJobs)
                 _dirItem->_instruction = CSYNC_INSTRUCTION_NONE;
             }
         }
+        updateLocalDirectoryDigest();
         emit finished();
     }
 
@@ -2221,6 +2418,36 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
 
 void ProcessDirectoryJob::startAsyncLocalQuery()
 {
+    // The listing may already have been started while the parent directory was processed
+    const auto prefetchState = _discoveryData->takeLocalDirectoryPrefetch(_currentFolder._local, &_localNormalQueryEntries,
+        [this, guard = QPointer<ProcessDirectoryJob>(this)](bool usable, const QVector<LocalInfo> &results) {
+            if (!guard) {
+                return;
+            }
+            _discoveryData->_currentlyActiveJobs--;
+            _pendingAsyncJobs--;
+
+            if (usable) {
+                localQueryFinished(results);
+            } else {
+                startAsyncLocalQuery();
+            }
+        });
+
+    switch (prefetchState) {
+    case DiscoveryPhase::LocalDirectoryPrefetchState::Done:
+        // start() calls process() once the server query is done as well
+        _localQueryDone = true;
+        prefetchLocalSubdirectories();
+        return;
+    case DiscoveryPhase::LocalDirectoryPrefetchState::Pending:
+        _discoveryData->_currentlyActiveJobs++;
+        _pendingAsyncJobs++;
+        return;
+    case DiscoveryPhase::LocalDirectoryPrefetchState::NotPrefetched:
+        break;
+    }
+
     QString localPath = _discoveryData->_localDir + _currentFolder._local;
     auto localJob = new DiscoverySingleLocalDirectoryJob(_discoveryData->_account, localPath, _discoveryData->_syncOptions._vfs.data());
 
@@ -2231,6 +2458,9 @@ void ProcessDirectoryJob::startAsyncLocalQuery()
 
     connect(localJob, &DiscoverySingleLocalDirectoryJob::childIgnored, this, [this](bool b) {
         _childIgnored = b;
+        if (b) {
+            _localFilesInSync = false;
+        }
     });
 
     connect(localJob, &DiscoverySingleLocalDirectoryJob::finishedFatalError, this, [this](const QString &msg) {
@@ -2260,17 +2490,40 @@ void ProcessDirectoryJob::startAsyncLocalQuery()
         _discoveryData->_currentlyActiveJobs--;
         _pendingAsyncJobs--;
 
-        _localNormalQueryEntries = results;
-        _localQueryDone = true;
-
-        if (_serverQueryDone)
-            this->process();
+        localQueryFinished(results);
     });
 
-    QThreadPool *pool = QThreadPool::globalInstance();
-    pool->start(localJob); // QThreadPool takes ownership
+    _discoveryData->_localDiscoveryPool.start(localJob); // QThreadPool takes ownership
+}
+
+void ProcessDirectoryJob::localQueryFinished(const QVector<LocalInfo> &results)
+{
+    _localNormalQueryEntries = results;
+    _localQueryDone = true;
+    prefetchLocalSubdirectories();
+
+    if (_serverQueryDone)
+        process();
 }
 
+void ProcessDirectoryJob::prefetchLocalSubdirectories()
+{
+    // Only subdirectories that will most likely get a local NormalQuery of their own
+    for (const auto &entry : std::as_const(_localNormalQueryEntries)) {
+        if (!entry.isDirectory || entry.isSymLink) {
+            continue;
+        }
+        if (_discoveryData->_ignoreHiddenFiles && (entry.isHidden || entry.name.startsWith(QLatin1Char('.')))) {
+            continue;
+        }
+        const auto path = PathTuple::pathAppend(_currentFolder._local, entry.name);
+        if (_discoveryData->isInSelectiveSyncBlackList(path) || !_discoveryData->_shouldDiscoverLocaly(path)) {
+            continue;
+        }
+        _prefetchedLocalSubdirectories.append(path);
+    }
+    _discoveryData->prefetchLocalDirectories(_prefetchedLocalSubdirectories);
+}
 
 bool ProcessDirectoryJob::isVfsWithSuffix() const
 {
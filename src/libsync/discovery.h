@@ -152,6 +152,43 @@ private:
 
     bool canRemoveCaseClashConflictedCopy(const QString &path, const std::map<QString, Entries> &allEntries);
 
+    /** Loads the journal records that may be rename sources of new entries in one go
+     *
+     * Entries without db record are looked up by local inode and by server file id,
+     * see renameCandidateByInode() and renameCandidatesByFileId().
+     */
+    [[nodiscard]] bool preloadRenameCandidates(const std::map<QString, Entries> &entries);
+
+    /// Like SyncJournalDb::getFileRecordByInode(), but served from the preloaded records if possible
+    [[nodiscard]] bool renameCandidateByInode(quint64 inode, SyncJournalFileRecord *rec);
+
+    /// Like SyncJournalDb::getFileRecordsByFileId(), but served from the preloaded records if possible
+    [[nodiscard]] bool renameCandidatesByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+
+    /** Computes _localDirectoryDigest and returns whether processing the files of this
+     * directory can be skipped.
+     *
+     * The digest covers name, type, inode and, for files, mtime and size of the direct
+     * children. It is only stored once all files of the directory were found in sync, so a
+     * matching digest while the server side and the folder watcher report no changes either
+     * means processing the files would not produce anything but CSYNC_INSTRUCTION_NONE items.
+     *
+     * Excluded files, silent or not, never get a NONE item, so their directories don't store a
+     * digest. Directories with conflict files are always processed since SyncEngine acts on
+     * their NONE items.
+     */
+    [[nodiscard]] bool filesUnchangedSinceLastSync();
+
+    /** Fills entries with the local subdirectories and their db records
+     *
+     * Returns false if a subdirectory has no db record yet; the directory
+     * then needs to be processed in full.
+     */
+    [[nodiscard]] bool collectUnchangedLocalSubdirectories(std::map<QString, Entries> &entries);
+
+    /// Stores or removes _localDirectoryDigest once all items of the directory are known
+    void updateLocalDirectoryDigest();
+
     // check if the path is an e2e encrypted and the e2ee is not set up, and insert it into a corresponding list in the sync journal
     void checkAndUpdateSelectiveSyncListsForE2eeFolders(const QString &path);
 
@@ -232,10 +269,16 @@ private:
 
     /** Discover the local directory
       *
-      * Fills _localNormalQueryEntries.
+      * Fills _localNormalQueryEntries, from a prefetched listing if there is one.
       */
     void startAsyncLocalQuery();
 
+    /// Sets the results of the local query and continues with process() if possible
+    void localQueryFinished(const QVector<LocalInfo> &results);
+
+    /// Starts listing local subdirectories ahead of their jobs, see DiscoveryPhase::prefetchLocalDirectories()
+    void prefetchLocalSubdirectories();
+
 
     /** Sets _pinState, the directory's pin state
      *
@@ -268,6 +311,27 @@ private:
     QVector<RemoteInfo> _serverNormalQueryEntries;
     QVector<LocalInfo> _localNormalQueryEntries;
 
+    // Folder-relative local paths of subdirectories whose listing was prefetched
+    QStringList _prefetchedLocalSubdirectories;
+
+    // Rename candidates loaded by preloadRenameCandidates(). The key sets contain every
+    // looked up key, including those without a record. Only valid while
+    // _preloadedRenameCandidatesGeneration matches DiscoveryPhase::_dbRecordsGeneration.
+    QSet<quint64> _preloadedInodes;
+    QHash<quint64, SyncJournalFileRecord> _renameCandidatesByInode;
+    QSet<QByteArray> _preloadedFileIds;
+    QMultiHash<QByteArray, SyncJournalFileRecord> _renameCandidatesByFileId;
+    quint64 _preloadedRenameCandidatesGeneration = 0;
+
+    // Digests of the local listing, see filesUnchangedSinceLastSync(). Empty if not applicable.
+    QByteArray _localDirectoryDigest;
+    QByteArray _storedLocalDirectoryDigest;
+    // Number of local files in the listing, and how many of them got a CSYNC_INSTRUCTION_NONE item
+    qsizetype _localFileCount = 0;
+    qsizetype _localFilesInSyncCount = 0;
+    // Cleared by any item that isn't a no-op, except metadata updates of subdirectories
+    bool _localFilesInSync = true;
+
     // Whether the local/remote directory item queries are done. Will be set
     // even even for do-nothing (!= NormalQuery) queries.
     bool _serverQueryDone = false;
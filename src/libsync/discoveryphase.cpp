@@ -36,12 +36,24 @@
 #include <QTextCodec>
 #include <cstring>
 #include <QDateTime>
+#include <QCryptographicHash>
 
 
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcDiscovery, "nextcloud.sync.discovery", QtInfoMsg)
 
+namespace {
+// Bounds the number of prefetched local listings waiting for their ProcessDirectoryJob
+constexpr auto maxLocalDirectoryPrefetchesPerThread = 16;
+}
+
+DiscoveryPhase::~DiscoveryPhase()
+{
+    // Don't start the queued listings, ~QThreadPool waits for the running ones
+    _localDiscoveryPool.clear();
+}
+
 bool DiscoveryPhase::isInSelectiveSyncBlackList(const QString &path) const
 {
     if (_selectiveSyncBlackList.isEmpty()) {
@@ -250,6 +262,20 @@ void DiscoveryPhase::markPermanentDeletionRequests()
 void DiscoveryPhase::startJob(ProcessDirectoryJob *job)
 {
     ENFORCE(!_currentRootJob);
+    _localDiscoveryPool.setMaxThreadCount(qMax(1, _syncOptions._parallelLocalDiscoveryJobs));
+    // Discovery doesn't write case clash records, so checking once per run is enough
+    _noCaseConflictRecordsInDb = _statedb->caseClashConflictRecordPaths().isEmpty();
+
+    QCryptographicHash exclusionHash(QCryptographicHash::Sha1);
+    exclusionHash.addData(_excludes ? _excludes->rulesFingerprint() : QByteArray());
+    exclusionHash.addData(_invalidFilenameRx.pattern().toUtf8());
+    for (const auto &list : {_serverBlacklistedFiles, _forbiddenFilenames, _forbiddenBasenames, _forbiddenExtensions, _forbiddenChars, _leadingAndTrailingSpacesFilesAllowed}) {
+        exclusionHash.addData(list.join(QLatin1Char('/')).toUtf8());
+        exclusionHash.addData("\n");
+    }
+    exclusionHash.addData(_ignoreHiddenFiles ? "h" : "-");
+    exclusionHash.addData(_shouldEnforceWindowsFileNameCompatibility ? "w" : "-");
+    _exclusionFingerprint = exclusionHash.result();
     connect(this, &DiscoveryPhase::itemDiscovered, this, &DiscoveryPhase::slotItemDiscovered, Qt::UniqueConnection);
     connect(job, &ProcessDirectoryJob::finished, this, [this, job] {
         ENFORCE(_currentRootJob == sender());
@@ -297,6 +323,96 @@ void DiscoveryPhase::scheduleMoreJobs()
     }
 }
 
+void DiscoveryPhase::prefetchLocalDirectories(const QStringList &paths)
+{
+    const auto maxPrefetches = maxLocalDirectoryPrefetchesPerThread * _localDiscoveryPool.maxThreadCount();
+
+    for (const auto &path : paths) {
+        if (_localDirectoryPrefetches.size() >= maxPrefetches) {
+            return;
+        }
+        if (_localDirectoryPrefetches.contains(path)) {
+            continue;
+        }
+        _localDirectoryPrefetches.insert(path, LocalDirectoryPrefetch{});
+
+        auto localJob = new DiscoverySingleLocalDirectoryJob(_account, _localDir + path, _syncOptions._vfs.data());
+
+        // Items and errors can only be reported by the ProcessDirectoryJob, let it list the directory again
+        connect(localJob, &DiscoverySingleLocalDirectoryJob::childIgnored, this, [this, path] {
+            const auto it = _localDirectoryPrefetches.find(path);
+            if (it != _localDirectoryPrefetches.end()) {
+                it->usable = false;
+            }
+        });
+        connect(localJob, &DiscoverySingleLocalDirectoryJob::finishedFatalError, this, [this, path] {
+            localDirectoryPrefetchFinished(path, false, {});
+        });
+        connect(localJob, &DiscoverySingleLocalDirectoryJob::finishedNonFatalError, this, [this, path] {
+            localDirectoryPrefetchFinished(path, false, {});
+        });
+        connect(localJob, &DiscoverySingleLocalDirectoryJob::finished, this, [this, path](const QVector<LocalInfo> &results) {
+            localDirectoryPrefetchFinished(path, true, results);
+        });
+        // run() may return without emitting anything, the job is deleted by the pool afterwards
+        connect(localJob, &QObject::destroyed, this, [this, path] {
+            localDirectoryPrefetchFinished(path, false, {});
+        }, Qt::QueuedConnection);
+
+        _localDiscoveryPool.start(localJob); // QThreadPool takes ownership
+    }
+}
+
+void DiscoveryPhase::dropLocalDirectoryPrefetches(const QStringList &paths)
+{
+    for (const auto &path : paths) {
+        const auto it = _localDirectoryPrefetches.constFind(path);
+        if (it != _localDirectoryPrefetches.constEnd() && !it->callback) {
+            _localDirectoryPrefetches.erase(it);
+        }
+    }
+}
+
+DiscoveryPhase::LocalDirectoryPrefetchState DiscoveryPhase::takeLocalDirectoryPrefetch(const QString &path,
+    QVector<LocalInfo> *results,
+    const std::function<void(bool, const QVector<LocalInfo> &)> &callback)
+{
+    const auto it = _localDirectoryPrefetches.find(path);
+    if (it == _localDirectoryPrefetches.end()) {
+        return LocalDirectoryPrefetchState::NotPrefetched;
+    }
+
+    if (!it->done) {
+        it->callback = callback;
+        return LocalDirectoryPrefetchState::Pending;
+    }
+
+    const auto prefetch = _localDirectoryPrefetches.take(path);
+    if (!prefetch.usable) {
+        return LocalDirectoryPrefetchState::NotPrefetched;
+    }
+    *results = prefetch.results;
+    return LocalDirectoryPrefetchState::Done;
+}
+
+void DiscoveryPhase::localDirectoryPrefetchFinished(const QString &path, bool usable, const QVector<LocalInfo> &results)
+{
+    const auto it = _localDirectoryPrefetches.find(path);
+    if (it == _localDirectoryPrefetches.end() || it->done) {
+        return;
+    }
+
+    if (it->callback) {
+        const auto prefetch = _localDirectoryPrefetches.take(path);
+        prefetch.callback(prefetch.usable && usable, results);
+        return;
+    }
+
+    it->done = true;
+    it->usable = it->usable && usable;
+    it->results = results;
+}
+
 void DiscoveryPhase::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
 {
     if (item->_instruction == CSYNC_INSTRUCTION_ERROR && item->_direction == SyncFileItem::Up) {
@@ -24,7 +24,9 @@
 #include <QMutex>
 #include <QWaitCondition>
 #include <QRunnable>
+#include <QThreadPool>
 #include <deque>
+#include <functional>
 #include "syncoptions.h"
 #include "syncfileitem.h"
 
@@ -320,7 +322,46 @@ class DiscoveryPhase : public QObject
 
     void markPermanentDeletionRequests();
 
+    /** A listing of a local directory started ahead of the ProcessDirectoryJob recursion.
+     *
+     * See prefetchLocalDirectories().
+     */
+    struct LocalDirectoryPrefetch
+    {
+        bool done = false;
+        bool usable = true; // false if the directory needs to be listed again, e.g. to report errors
+        QVector<LocalInfo> results;
+        std::function<void(bool usable, const QVector<LocalInfo> &results)> callback;
+    };
+
+    /// Maps folder-relative local paths to their prefetched listings
+    QHash<QString, LocalDirectoryPrefetch> _localDirectoryPrefetches;
+
+    /** Starts listing the given folder-relative local directories on _localDiscoveryPool.
+     *
+     * Only a bounded number of listings is kept around, further paths are skipped
+     * and will be listed by their ProcessDirectoryJob as usual.
+     */
+    void prefetchLocalDirectories(const QStringList &paths);
+
+    /// Forgets about prefetched listings that no job is going to take
+    void dropLocalDirectoryPrefetches(const QStringList &paths);
+
+    enum class LocalDirectoryPrefetchState {
+        NotPrefetched, //< the caller has to list the directory itself
+        Pending, //< the callback is called once the listing is complete
+        Done, //< the results were filled in
+    };
+
+    LocalDirectoryPrefetchState takeLocalDirectoryPrefetch(const QString &path,
+        QVector<LocalInfo> *results,
+        const std::function<void(bool usable, const QVector<LocalInfo> &results)> &callback);
+
+    void localDirectoryPrefetchFinished(const QString &path, bool usable, const QVector<LocalInfo> &results);
+
 public:
+    ~DiscoveryPhase() override;
+
     // input
     QString _localDir; // absolute path to the local directory. ends with '/'
     QString _remoteFolder; // remote folder, ends with '/'
@@ -334,6 +375,8 @@ public:
     bool _shouldEnforceWindowsFileNameCompatibility = false;
     bool _ignoreHiddenFiles = false;
     std::function<bool(const QString &)> _shouldDiscoverLocaly;
+    // Whether the folder watcher reported changes at, below or above a path, even for full local discovery
+    std::function<bool(const QString &)> _hasReportedLocalChanges;
 
     void startJob(ProcessDirectoryJob *);
 
@@ -358,8 +401,24 @@ public:
 
     bool _noCaseConflictRecordsInDb = false;
 
+    /** Bumped whenever discovery itself changes file records in _statedb
+     *
+     * Invalidates the rename candidates ProcessDirectoryJob preloaded before the change.
+     */
+    quint64 _dbRecordsGeneration = 0;
+
+    /// Hash of everything that decides which local entries are excluded, set by startJob()
+    QByteArray _exclusionFingerprint;
+
     QSet<QString> _topLevelE2eeFolderPaths;
 
+private:
+    /** Runs all local directory listings, bounded by SyncOptions::_parallelLocalDiscoveryJobs
+     *
+     * Declared last: destroying it waits for running listings, which use _syncOptions._vfs.
+     */
+    QThreadPool _localDiscoveryPool;
+
 signals:
     void fatalError(const QString &errorString, const OCC::ErrorCategory errorCategory);
     void itemDiscovered(const OCC::SyncFileItemPtr &item);
@@ -20,13 +20,54 @@
 #include "clientsideencryptionjobs.h"
 #include "clientsideencryption.h"
 
+#include <QCryptographicHash>
+#include <QFutureWatcher>
 #include <QLoggingCategory>
+#include <QMutexLocker>
 #include <QNetworkReply>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcFetchAndUploadE2eeFolderMetadataJob, "nextcloud.sync.propagator.encryptedfoldermetadatahandler", QtInfoMsg)
 
+namespace {
+
+// same size as the file nonces, see FolderMetadata
+constexpr auto metadataNonceSize = 16;
+
+// keeps symmetric metadata crypto, gzip and JSON work away from the main thread
+Q_GLOBAL_STATIC(QThreadPool, metadataCryptoPool)
+
+struct DecryptedMetadataCache {
+    QMutex mutex;
+    // only filled while a sync runs, see setMetadataCacheEnabled()
+    bool enabled = false;
+    // content hash of key, nonce and cipher text -> decrypted "ciphertext" document
+    QHash<QByteArray, QJsonDocument> documents;
+};
+Q_GLOBAL_STATIC(DecryptedMetadataCache, decryptedMetadataCache)
+
+QByteArray metadataCacheKey(const QByteArray &metadataKey, const QByteArray &cipherText, const QByteArray &nonce)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(metadataKey);
+    hash.addData(nonce);
+    hash.addData(cipherText);
+    return hash.result();
+}
+
+void insertIntoMetadataCache(const QByteArray &cacheKey, const QJsonDocument &doc)
+{
+    const QMutexLocker locker(&decryptedMetadataCache->mutex);
+    if (decryptedMetadataCache->enabled) {
+        decryptedMetadataCache->documents.insert(cacheKey, doc);
+    }
+}
+
+}
+
 }
 
 namespace OCC {
@@ -290,7 +331,22 @@ void EncryptedFolderMetadataHandler::startUploadMetadata()
         return;
     }
 
-    const auto encryptedMetadata = folderMetadata()->encryptedMetadata();
+    const auto watcher = new QFutureWatcher<QByteArray>(this);
+    connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher] {
+        watcher->deleteLater();
+        sendEncryptedMetadata(watcher->isCanceled() ? QByteArray{} : watcher->result());
+    });
+    watcher->setFuture(folderMetadata()->encryptedMetadataAsync());
+}
+
+void EncryptedFolderMetadataHandler::sendEncryptedMetadata(const QByteArray &encryptedMetadata)
+{
+    if (encryptedMetadata.isEmpty()) {
+        qCWarning(lcFetchAndUploadE2eeFolderMetadataJob) << "Could not encrypt metadata for folder" << _folderFullRemotePath;
+        slotUploadMetadataError(_folderId, -1);
+        return;
+    }
+
     if (_isNewMetadataCreated) {
         const auto job = new StoreMetaDataApiJob(_account, _folderId, _folderToken, encryptedMetadata, folderMetadata()->metadataSignature());
         connect(job, &StoreMetaDataApiJob::success, this, &EncryptedFolderMetadataHandler::slotUploadMetadataSuccess);
@@ -391,4 +447,54 @@ bool EncryptedFolderMetadataHandler::isFolderLocked() const
     return _isFolderLocked;
 }
 
+QFuture<QJsonDocument> EncryptedFolderMetadataHandler::decryptMetadataCipherText(const QByteArray &metadataKey, const QByteArray &cipherText, const QByteArray &nonce)
+{
+    const auto cacheKey = metadataCacheKey(metadataKey, cipherText, nonce);
+    {
+        const QMutexLocker locker(&decryptedMetadataCache->mutex);
+        const auto it = decryptedMetadataCache->documents.constFind(cacheKey);
+        if (it != decryptedMetadataCache->documents.constEnd()) {
+            qCDebug(lcFetchAndUploadE2eeFolderMetadataJob) << "Using cached decrypted metadata";
+            return QtFuture::makeReadyValueFuture(it.value());
+        }
+    }
+
+    return QtConcurrent::run(metadataCryptoPool(), [metadataKey, cipherText, nonce, cacheKey] {
+        const auto decrypted = EncryptionHelper::decryptThenUnGzipData(metadataKey, cipherText, nonce);
+        if (decrypted.isEmpty()) {
+            return QJsonDocument{};
+        }
+        QJsonParseError parseError;
+        const auto doc = QJsonDocument::fromJson(decrypted, &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            qCWarning(lcFetchAndUploadE2eeFolderMetadataJob) << "Could not parse decrypted metadata" << parseError.errorString();
+            return QJsonDocument{};
+        }
+        insertIntoMetadataCache(cacheKey, doc);
+        return doc;
+    });
+}
+
+QFuture<EncryptedFolderMetadataHandler::MetadataCipherText> EncryptedFolderMetadataHandler::encryptMetadataCipherText(const QByteArray &metadataKey, const QJsonDocument &cipherTextDoc)
+{
+    return QtConcurrent::run(metadataCryptoPool(), [metadataKey, cipherTextDoc] {
+        MetadataCipherText result;
+        result.nonce = EncryptionHelper::generateRandom(metadataNonceSize);
+        result.cipherText = EncryptionHelper::gzipThenEncryptData(metadataKey, cipherTextDoc.toJson(QJsonDocument::Compact), result.nonce, result.authenticationTag);
+        if (result.cipherText.isEmpty()) {
+            return MetadataCipherText{};
+        }
+        // the metadata we upload is what the next discovery fetches
+        insertIntoMetadataCache(metadataCacheKey(metadataKey, result.cipherText, result.nonce), cipherTextDoc);
+        return result;
+    });
+}
+
+void EncryptedFolderMetadataHandler::setMetadataCacheEnabled(bool enabled)
+{
+    const QMutexLocker locker(&decryptedMetadataCache->mutex);
+    decryptedMetadataCache->enabled = enabled;
+    decryptedMetadataCache->documents.clear();
+}
+
 }
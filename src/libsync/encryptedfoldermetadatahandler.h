@@ -20,7 +20,9 @@
 #include "rootencryptedfolderinfo.h"
 #include "common/syncjournaldb.h"
 
+#include <QFuture>
 #include <QHash>
+#include <QJsonDocument>
 #include <QMutex>
 #include <QObject>
 #include <QSslCertificate>
@@ -55,6 +57,13 @@ public:
     };
     Q_ENUM(UnlockFolderWithResult);
 
+    // the encrypted "ciphertext" part of V2 metadata, not base64-encoded
+    struct MetadataCipherText {
+        QByteArray cipherText;
+        QByteArray nonce;
+        QByteArray authenticationTag;
+    };
+
     explicit EncryptedFolderMetadataHandler(const AccountPtr &account, const QString &folderPath, const QString &remoteFolderRoot, SyncJournalDb *const journalDb, const QString &pathForTopLevelFolder, QObject *parent = nullptr);
 
     [[nodiscard]] QSharedPointer<FolderMetadata> folderMetadata() const;
@@ -76,9 +85,23 @@ public:
     void uploadMetadata(const UploadMode uploadMode = UploadMode::DoNotKeepLock);
     void unlockFolder(const UnlockFolderWithResult result = UnlockFolderWithResult::Success);
 
+    /**
+     * Decrypts, un-gzips and parses the "ciphertext" part of V2 metadata on a worker thread.
+     * Results are cached while the metadata cache is enabled, the future holds a null document on failure.
+     */
+    static QFuture<QJsonDocument> decryptMetadataCipherText(const QByteArray &metadataKey, const QByteArray &cipherText, const QByteArray &nonce);
+    /**
+     * Serializes, gzips and encrypts the "ciphertext" part of V2 metadata with a fresh nonce on a worker thread.
+     * The future holds an empty cipher text on failure.
+     */
+    static QFuture<MetadataCipherText> encryptMetadataCipherText(const QByteArray &metadataKey, const QJsonDocument &cipherTextDoc);
+    // the decrypted metadata is only kept while syncs run, enabling or disabling drops what is cached
+    static void setMetadataCacheEnabled(bool enabled);
+
 private:
     void lockFolder();
     void startUploadMetadata();
+    void sendEncryptedMetadata(const QByteArray &encryptedMetadata);
     void startFetchMetadata();
     void fetchFolderEncryptedId();
     bool validateBeforeLock();
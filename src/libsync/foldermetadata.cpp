@@ -18,6 +18,7 @@
 #include "clientsideencryption.h"
 #include "clientsideencryptionjobs.h"
 #include <common/checksums.h>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QSslCertificate>
@@ -109,15 +110,20 @@ void FolderMetadata::initMetadata()
     }
 
     qCInfo(lcCseMetadata()) << "Setting up existing metadata";
-    setupExistingMetadata(_initialMetadata);
+    if (setupExistingMetadata(_initialMetadata) == SetupStatus::Done) {
+        finishSetupExistingMetadata();
+    }
+}
 
+void FolderMetadata::finishSetupExistingMetadata()
+{
     if (metadataKeyForDecryption().isEmpty() || metadataKeyForEncryption().isEmpty()) {
         qCWarning(lcCseMetadata()) << "Failed to setup FolderMetadata. Could not parse/create metadataKey!";
     }
     emitSetupComplete();
 }
 
-void FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
+FolderMetadata::SetupStatus FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
 {
     const auto doc = QJsonDocument::fromJson(metadata);
     qCDebug(lcCseMetadata()) << "Got existing metadata:" << doc.toJson(QJsonDocument::Compact);
@@ -125,11 +131,11 @@ void FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
     if (_existingMetadataVersion < MetadataVersion::Version1) {
         qCDebug(lcCseMetadata()) << "Could not setup metadata. Incorrect version" << _existingMetadataVersion;
         _account->reportClientStatus(OCC::ClientStatusReportingStatus::E2EeError_GeneralError);
-        return;
+        return SetupStatus::Done;
     }
     if (_existingMetadataVersion < MetadataVersion::Version2_0) {
         setupExistingMetadataLegacy(metadata);
-        return;
+        return SetupStatus::Done;
     }
     
     qCDebug(lcCseMetadata()) << "Setting up latest metadata version" << _existingMetadataVersion;
@@ -144,7 +150,7 @@ void FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
     if (!isUsersArrayValid) {
         qCDebug(lcCseMetadata()) << "Could not decrypt metadata key. Users array is invalid!";
         _account->reportClientStatus(OCC::ClientStatusReportingStatus::E2EeError_GeneralError);
-        return;
+        return SetupStatus::Done;
     }
 
     if (_isRootEncryptedFolder) {
@@ -177,14 +183,14 @@ void FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
         if (!_account->e2e()->verifySignatureCryptographicMessageSyntax(QByteArray::fromBase64(_initialSignature), metadataForSignature.toBase64(), certificatePems)) {
             qCDebug(lcCseMetadata()) << "Could not parse encrypred folder metadata. Failed to verify signature!";
             _account->reportClientStatus(OCC::ClientStatusReportingStatus::E2EeError_GeneralError);
-            return;
+            return SetupStatus::Done;
         }
     }
 
     if (_initialSignature.isEmpty()) {
         qCDebug(lcCseMetadata()) << "Signature is empty";
         _account->reportClientStatus(OCC::ClientStatusReportingStatus::E2EeError_GeneralError);
-        return;
+        return SetupStatus::Done;
     }
 
     if (_folderUsers.contains(_account->davUser())) {
@@ -196,13 +202,13 @@ void FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
 
     if (!parseFileDropPart(metaDataDoc)) {
         qCDebug(lcCseMetadata()) << "Could not parse filedrop part";
-        return;
+        return SetupStatus::Done;
     }
 
     if (metadataKeyForDecryption().isEmpty() || metadataKeyForEncryption().isEmpty()) {
         qCDebug(lcCseMetadata()) << "Could not setup metadata key!";
         _account->reportClientStatus(OCC::ClientStatusReportingStatus::E2EeError_GeneralError);
-        return;
+        return SetupStatus::Done;
     }
 
     const auto metadataObj = metaDataDoc.object()[metadataJsonKey].toObject();
@@ -212,15 +218,24 @@ void FolderMetadata::setupExistingMetadata(const QByteArray &metadata)
     // for compatibility, the format is "cipheredpart|initializationVector", so we need to extract the "cipheredpart"
     const auto cipherTextPartExtracted = cipherTextEncrypted.split('|').at(0);
 
-    const auto cipherTextDecrypted = EncryptionHelper::decryptThenUnGzipData(metadataKeyForDecryption(), QByteArray::fromBase64(cipherTextPartExtracted), _metadataNonce);
-    if (cipherTextDecrypted.isEmpty()) {
+    const auto watcher = new QFutureWatcher<QJsonDocument>(this);
+    connect(watcher, &QFutureWatcher<QJsonDocument>::finished, this, [this, watcher] {
+        watcher->deleteLater();
+        setupExistingMetadataFromCipherText(watcher->result());
+        finishSetupExistingMetadata();
+    });
+    watcher->setFuture(EncryptedFolderMetadataHandler::decryptMetadataCipherText(metadataKeyForDecryption(), QByteArray::fromBase64(cipherTextPartExtracted), _metadataNonce));
+    return SetupStatus::Pending;
+}
+
+void FolderMetadata::setupExistingMetadataFromCipherText(const QJsonDocument &cipherTextDocument)
+{
+    if (cipherTextDocument.isNull()) {
         qCDebug(lcCseMetadata()) << "Could not decrypt cipher text!";
         _account->reportClientStatus(OCC::ClientStatusReportingStatus::E2EeError_GeneralError);
         return;
     }
 
-    const auto cipherTextDocument = QJsonDocument::fromJson(cipherTextDecrypted);
-
     const auto keyCheckSums = cipherTextDocument[keyChecksumsKey].toArray();
     if (!keyCheckSums.isEmpty()) {
         _keyChecksums.clear();
@@ -600,6 +615,28 @@ QByteArray FolderMetadata::encryptedMetadata()
         return encryptedMetadataLegacy();
     }
 
+    return signedMetadata(encryptCipherText().result());
+}
+
+QFuture<QByteArray> FolderMetadata::encryptedMetadataAsync()
+{
+    Q_ASSERT(_isMetadataValid);
+    if (!_isMetadataValid) {
+        qCCritical(lcCseMetadata()) << "Could not encrypt non-initialized metadata!";
+        return QtFuture::makeReadyValueFuture(QByteArray{});
+    }
+
+    if (latestSupportedMetadataVersion() < MetadataVersion::Version2_0) {
+        return QtFuture::makeReadyValueFuture(encryptedMetadataLegacy());
+    }
+
+    return encryptCipherText().then(this, [this](const EncryptedFolderMetadataHandler::MetadataCipherText &cipherText) {
+        return signedMetadata(cipherText);
+    });
+}
+
+QFuture<EncryptedFolderMetadataHandler::MetadataCipherText> FolderMetadata::encryptCipherText()
+{
     qCDebug(lcCseMetadata()) << "Encrypting metadata for latest version"
                              << latestSupportedMetadataVersion();
     if (_isRootEncryptedFolder && _folderUsers.isEmpty() && _existingMetadataVersion < MetadataVersion::Version2_0) {
@@ -609,7 +646,7 @@ QByteArray FolderMetadata::encryptedMetadata()
 
     if (metadataKeyForEncryption().isEmpty()) {
         qCDebug(lcCseMetadata()) << "Encrypting metadata failed! Empty metadata key!";
-        return {};
+        return QtFuture::makeReadyValueFuture(EncryptedFolderMetadataHandler::MetadataCipherText{});
     }
 
     QJsonObject files, folders;
@@ -617,7 +654,7 @@ QByteArray FolderMetadata::encryptedMetadata()
         const auto file = convertFileToJsonObject(&(*it));
         if (file.isEmpty()) {
             qCDebug(lcCseMetadata) << "Metadata generation failed for file" << it->encryptedFilename;
-            return {};
+            return QtFuture::makeReadyValueFuture(EncryptedFolderMetadataHandler::MetadataCipherText{});
         }
         const auto isDirectory =
             it->mimetype.isEmpty() || it->mimetype == QByteArrayLiteral("inode/directory") || it->mimetype == QByteArrayLiteral("httpd/unix-directory");
@@ -641,23 +678,28 @@ QByteArray FolderMetadata::encryptedMetadata()
     Q_ASSERT(isChecksumsArrayValid);
     if (!isChecksumsArrayValid) {
         qCDebug(lcCseMetadata) << "Empty keyChecksums while shouldn't be empty!";
-        return {};
+        return QtFuture::makeReadyValueFuture(EncryptedFolderMetadataHandler::MetadataCipherText{});
     }
     if (!keyChecksums.isEmpty()) {
         cipherText.insert(keyChecksumsKey, keyChecksums);
     }
 
-    const QJsonDocument cipherTextDoc(cipherText);
+    return EncryptedFolderMetadataHandler::encryptMetadataCipherText(metadataKeyForEncryption(), QJsonDocument(cipherText));
+}
+
+QByteArray FolderMetadata::signedMetadata(const EncryptedFolderMetadataHandler::MetadataCipherText &cipherText)
+{
+    if (cipherText.cipherText.isEmpty()) {
+        qCDebug(lcCseMetadata) << "Metadata generation failed! Could not encrypt the cipher text!";
+        return {};
+    }
 
-    QByteArray authenticationTag;
-    const auto initializationVector = EncryptionHelper::generateRandom(metadataKeySize);
-    const auto initializationVectorBase64 = initializationVector.toBase64();
-    const auto gzippedThenEncryptData = EncryptionHelper::gzipThenEncryptData(metadataKeyForEncryption(), cipherTextDoc.toJson(QJsonDocument::Compact), initializationVector, authenticationTag).toBase64();
+    const auto initializationVectorBase64 = cipherText.nonce.toBase64();
     // backwards compatible with old versions ("ciphertext|initializationVector")
-    const auto encryptedCipherText = QByteArray(gzippedThenEncryptData + QByteArrayLiteral("|") + initializationVectorBase64);
+    const auto encryptedCipherText = QByteArray(cipherText.cipherText.toBase64() + QByteArrayLiteral("|") + initializationVectorBase64);
     const QJsonObject metadata{{cipherTextKey, QJsonValue::fromVariant(encryptedCipherText)},
                                {nonceKey, QJsonValue::fromVariant(initializationVectorBase64)},
-                               {authenticationTagKey, QJsonValue::fromVariant(authenticationTag.toBase64())}};
+                               {authenticationTagKey, QJsonValue::fromVariant(cipherText.authenticationTag.toBase64())}};
 
     QJsonObject metaObject = {{metadataJsonKey, metadata}, {versionKey, QString::number(_account->capabilities().clientSideEncryptionVersion(), 'f', 1)}};
 
@@ -18,6 +18,7 @@
 #include "csync.h"
 #include "rootencryptedfolderinfo.h"
 #include <QByteArray>
+#include <QFuture>
 #include <QHash>
 #include <QJsonObject>
 #include <QObject>
@@ -53,6 +54,12 @@ class OWNCLOUDSYNC_EXPORT FolderMetadata : public QObject
         Version2_0,
     };
 
+    // Done when the setup of existing metadata finished or failed, Pending while the cipher text is being decrypted
+    enum class SetupStatus {
+        Done,
+        Pending,
+    };
+
     struct UserWithFileDropEntryAccess {
         QString userId;
         QByteArray decryptedFiledropKey;
@@ -136,6 +143,8 @@ public:
     [[nodiscard]] const QSet<QByteArray> &keyChecksums() const;
 
     [[nodiscard]] QByteArray encryptedMetadata();
+    // same as encryptedMetadata(), but gzip and encryption of the cipher text don't block the calling thread
+    [[nodiscard]] QFuture<QByteArray> encryptedMetadataAsync();
 
     [[nodiscard]] EncryptionStatusEnums::ItemEncryptionStatus existingMetadataEncryptionStatus() const;
     [[nodiscard]] EncryptionStatusEnums::ItemEncryptionStatus encryptedMetadataEncryptionStatus() const;
@@ -155,6 +164,8 @@ public slots:
 
 private:
     [[nodiscard]] QByteArray encryptedMetadataLegacy();
+    [[nodiscard]] QFuture<EncryptedFolderMetadataHandler::MetadataCipherText> encryptCipherText();
+    [[nodiscard]] QByteArray signedMetadata(const EncryptedFolderMetadataHandler::MetadataCipherText &cipherText);
 
     [[nodiscard]] bool verifyMetadataKey(const QByteArray &metadataKey) const;
 
@@ -189,8 +200,10 @@ private slots:
     void initEmptyMetadata();
     void initEmptyMetadataLegacy();
 
-    void setupExistingMetadata(const QByteArray &metadata);
+    SetupStatus setupExistingMetadata(const QByteArray &metadata);
+    void setupExistingMetadataFromCipherText(const QJsonDocument &cipherTextDocument);
     void setupExistingMetadataLegacy(const QByteArray &metadata);
+    void finishSetupExistingMetadata();
 
     void setupVersionFromExistingMetadata(const QByteArray &metadata);
 
@@ -236,7 +249,7 @@ private:
     MetadataVersion _existingMetadataVersion = MetadataVersion::VersionUndefined;
     MetadataVersion _encryptedMetadataVersion = MetadataVersion::VersionUndefined;
 
-    // generated each time QByteArray encryptedMetadata() is called, and will later be used for validation if uploaded
+    // generated each time QByteArray encryptedMetadata() or encryptedMetadataAsync() is called, and will later be used for validation if uploaded
     QByteArray _metadataSignature;
     // signature from server-side metadata
     QByteArray _initialSignature;
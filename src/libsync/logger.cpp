@@ -38,6 +38,8 @@ namespace {
 constexpr int CrashLogSize = 20;
 constexpr auto MaxLogLinesCount = 50000;
 constexpr auto MaxLogLinesBeforeFlush = 10;
+// Lines the logging threads can queue before they have to wait for the writer thread
+constexpr quint64 AsyncRingSize = 8192;
 
 static bool compressLog(const QString &originalName, const QString &targetName)
 {
@@ -92,6 +94,8 @@ Logger::Logger(QObject *parent)
 
 Logger::~Logger()
 {
+    _asyncLogging.store(false, std::memory_order_release);
+    stopAsyncLogWriter();
     if (_logstream) {
         _logstream->flush();
     }
@@ -119,7 +123,6 @@ bool Logger::isLoggingToFile() const
 
 void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString &message)
 {
-    static long long int linesCounter = 0;
     const auto &msg = qFormatLogMessage(type, ctx, message);
 #if defined Q_OS_WIN && ((defined NEXTCLOUD_DEV && NEXTCLOUD_DEV) || defined QT_DEBUG)
     // write logs to Output window of Visual Studio
@@ -128,39 +131,14 @@ void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString
         OutputDebugString(msgW.c_str());
     }
 #endif
-    {
+    const auto permanentDeleteLog = ctx.category && strcmp(ctx.category, lcPermanentLog().categoryName()) == 0;
+    if (type == QtFatalMsg || !_asyncLogging.load(std::memory_order_acquire) || !enqueueAsyncLogLine(msg, type, permanentDeleteLog)) {
         QMutexLocker lock(&_mutex);
 
-        if (linesCounter >= MaxLogLinesCount) {
-            linesCounter = 0;
-            if (_logstream) {
-                _logstream->flush();
-            }
-            closeNoLock();
-            enterNextLogFileNoLock(QStringLiteral("nextcloud.log"), LogType::Log);
-        }
-        ++linesCounter;
+        // Lines still queued for the writer thread go first to keep the log in order
+        writeAsyncLogLinesNoLock();
+        writeLogLineNoLock(msg, type, permanentDeleteLog, true);
 
-        _crashLogIndex = (_crashLogIndex + 1) % CrashLogSize;
-        _crashLog[_crashLogIndex] = msg;
-
-        if (_logstream) {
-            (*_logstream) << msg << "\n";
-            ++_linesCounter;
-            if (_doFileFlush ||
-                _linesCounter >= MaxLogLinesBeforeFlush ||
-                type == QtMsgType::QtWarningMsg || type == QtMsgType::QtCriticalMsg || type == QtMsgType::QtFatalMsg) {
-                _logstream->flush();
-                _linesCounter = 0;
-            }
-        }
-        if (_permanentDeleteLogStream && ctx.category && strcmp(ctx.category, lcPermanentLog().categoryName()) == 0) {
-            (*_permanentDeleteLogStream) << msg << "\n";
-            _permanentDeleteLogStream->flush();
-            if (_permanentDeleteLogFile.size() > 10LL * 1024LL) {
-                enterNextLogFileNoLock(QStringLiteral("permanent_delete.log"), LogType::DeleteLog);
-            }
-        }
         if (type == QtFatalMsg) {
             closeNoLock();
 #if defined(Q_OS_WIN)
@@ -172,6 +150,159 @@ void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString
     emit logWindowLog(msg);
 }
 
+void Logger::writeLogLineNoLock(const QString &msg, QtMsgType type, bool permanentDeleteLog, bool flushNow)
+{
+    static long long int linesCounter = 0;
+
+    if (linesCounter >= MaxLogLinesCount) {
+        linesCounter = 0;
+        if (_logstream) {
+            _logstream->flush();
+        }
+        closeNoLock();
+        enterNextLogFileNoLock(QStringLiteral("nextcloud.log"), LogType::Log);
+    }
+    ++linesCounter;
+
+    _crashLogIndex = (_crashLogIndex + 1) % CrashLogSize;
+    _crashLog[_crashLogIndex] = msg;
+
+    if (_logstream) {
+        (*_logstream) << msg << "\n";
+        ++_linesCounter;
+        if (flushNow && (_doFileFlush ||
+            _linesCounter >= MaxLogLinesBeforeFlush ||
+            type == QtMsgType::QtWarningMsg || type == QtMsgType::QtCriticalMsg || type == QtMsgType::QtFatalMsg)) {
+            _logstream->flush();
+            _linesCounter = 0;
+        }
+    }
+    if (_permanentDeleteLogStream && permanentDeleteLog) {
+        (*_permanentDeleteLogStream) << msg << "\n";
+        _permanentDeleteLogStream->flush();
+        if (_permanentDeleteLogFile.size() > 10LL * 1024LL) {
+            enterNextLogFileNoLock(QStringLiteral("permanent_delete.log"), LogType::DeleteLog);
+        }
+    }
+}
+
+bool Logger::enqueueAsyncLogLine(const QString &msg, QtMsgType type, bool permanentDeleteLog)
+{
+    // Bounded MPSC ring: a slot is free for the producer at position p when its
+    // sequence is p, and holds a line for the writer when its sequence is p + 1.
+    auto position = _asyncEnqueuePosition.load(std::memory_order_relaxed);
+    while (true) {
+        auto &slot = _asyncRing[position % AsyncRingSize];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (_asyncEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.message = msg;
+                slot.type = type;
+                slot.permanentDeleteLog = permanentDeleteLog;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                _asyncPublished.fetch_add(1, std::memory_order_release);
+                _asyncPublished.notify_one();
+                return true;
+            }
+        } else if (sequence < position) {
+            // The writer did not get to this slot yet, the ring is full
+            return false;
+        } else {
+            position = _asyncEnqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Logger::writeAsyncLogLinesNoLock()
+{
+    if (!_asyncRing) {
+        return true;
+    }
+
+    auto drained = false;
+    quint64 written = 0;
+    while (written < AsyncRingSize) {
+        auto &slot = _asyncRing[_asyncDequeuePosition % AsyncRingSize];
+        if (slot.sequence.load(std::memory_order_acquire) != _asyncDequeuePosition + 1) {
+            drained = true;
+            break;
+        }
+        // Release the slot before writing: writing can log again and re-enter here
+        const auto msg = std::move(slot.message);
+        const auto type = slot.type;
+        const auto permanentDeleteLog = slot.permanentDeleteLog;
+        slot.sequence.store(_asyncDequeuePosition + AsyncRingSize, std::memory_order_release);
+        ++_asyncDequeuePosition;
+
+        writeLogLineNoLock(msg, type, permanentDeleteLog, false);
+        ++written;
+    }
+
+    if (written > 0 && _logstream) {
+        _logstream->flush();
+        _linesCounter = 0;
+    }
+    return drained;
+}
+
+void Logger::runAsyncLogWriter()
+{
+    while (true) {
+        const auto published = _asyncPublished.load(std::memory_order_acquire);
+        bool drained = false;
+        {
+            QMutexLocker lock(&_mutex);
+            drained = writeAsyncLogLinesNoLock();
+        }
+        if (_asyncWriterStopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        if (drained) {
+            // Returns right away if anything was published since we looked
+            _asyncPublished.wait(published, std::memory_order_acquire);
+        }
+    }
+}
+
+void Logger::stopAsyncLogWriter()
+{
+    if (!_asyncWriter.joinable()) {
+        return;
+    }
+    _asyncWriterStopping.store(true, std::memory_order_release);
+    _asyncPublished.fetch_add(1, std::memory_order_release);
+    _asyncPublished.notify_one();
+    _asyncWriter.join();
+
+    // Lines that were queued while the writer shut down
+    QMutexLocker lock(&_mutex);
+    while (!writeAsyncLogLinesNoLock()) {
+    }
+}
+
+void Logger::setAsyncLogging(bool enabled)
+{
+    if (enabled == _asyncLogging.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (!enabled) {
+        _asyncLogging.store(false, std::memory_order_release);
+        stopAsyncLogWriter();
+        return;
+    }
+
+    if (!_asyncRing) {
+        _asyncRing = std::make_unique<AsyncLogLine[]>(AsyncRingSize);
+        for (quint64 i = 0; i < AsyncRingSize; ++i) {
+            _asyncRing[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    _asyncWriterStopping.store(false, std::memory_order_relaxed);
+    _asyncWriter = std::thread([this] { runAsyncLogWriter(); });
+    _asyncLogging.store(true, std::memory_order_release);
+}
+
 void Logger::closeNoLock()
 {
     dumpCrashLog();
@@ -22,6 +22,10 @@
 #include <QTextStream>
 #include <QRecursiveMutex>
 
+#include <atomic>
+#include <memory>
+#include <thread>
+
 #include "common/utility.h"
 #include "owncloudlib.h"
 
@@ -65,6 +69,15 @@ public:
     bool logDebug() const { return _logDebug; }
     void setLogDebug(bool debug);
 
+    /** Hand log lines to a writer thread instead of writing them in the logging thread.
+     *
+     * Logging threads only format the line and push it into a lock-free ring; the
+     * writer thread appends whole batches to the log files and takes care of the
+     * rotation. Fatal messages drain the ring and are written synchronously.
+     */
+    bool asyncLogging() const { return _asyncLogging.load(std::memory_order_relaxed); }
+    void setAsyncLogging(bool enabled);
+
     /** Returns where the automatic logdir would be */
     QString temporaryFolderLogDirPath() const;
 
@@ -107,6 +120,21 @@ private:
     void enterNextLogFileNoLock(const QString &baseFileName, LogType type);
     void setLogFileNoLock(const QString &name);
     void setPermanentDeleteLogFileNoLock(const QString &name);
+    void writeLogLineNoLock(const QString &msg, QtMsgType type, bool permanentDeleteLog, bool flushNow);
+
+    bool enqueueAsyncLogLine(const QString &msg, QtMsgType type, bool permanentDeleteLog);
+    bool writeAsyncLogLinesNoLock();
+    void runAsyncLogWriter();
+    void stopAsyncLogWriter();
+
+    /// A slot of the ring between the logging threads and the writer thread
+    struct AsyncLogLine
+    {
+        std::atomic<quint64> sequence = 0;
+        QString message;
+        QtMsgType type = QtDebugMsg;
+        bool permanentDeleteLog = false;
+    };
 
     QFile _logFile;
     bool _doFileFlush = false;
@@ -122,6 +150,14 @@ private:
     int _crashLogIndex = 0;
     QFile _permanentDeleteLogFile;
     QScopedPointer<QTextStream> _permanentDeleteLogStream;
+
+    std::atomic<bool> _asyncLogging = false;
+    std::unique_ptr<AsyncLogLine[]> _asyncRing;
+    std::atomic<quint64> _asyncEnqueuePosition = 0;
+    quint64 _asyncDequeuePosition = 0; // only touched with _mutex held
+    std::atomic<quint32> _asyncPublished = 0; // bumped for every published line, the writer waits on it
+    std::atomic<bool> _asyncWriterStopping = false;
+    std::thread _asyncWriter;
 };
 
 } // namespace OCC
@@ -183,138 +183,212 @@ bool MkColJob::finished()
 }
 
 /*********************************************************************************************/
-// supposed to read <D:collection> when pointing to <D:resourcetype><D:collection></D:resourcetype>..
-static QString readContentsAsString(QXmlStreamReader &reader)
-{
-    QString result;
-    int level = 0;
-    do {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        if (type == QXmlStreamReader::StartElement) {
-            level++;
-            result += "<" + reader.name().toString() + ">";
-        } else if (type == QXmlStreamReader::Characters) {
-            result += reader.text();
-        } else if (type == QXmlStreamReader::EndElement) {
-            level--;
-            if (level < 0) {
-                break;
-            }
-            result += "</" + reader.name().toString() + ">";
-        }
 
-    } while (!reader.atEnd());
-    return result;
+LsColXMLParser::LsColXMLParser() = default;
+
+bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+{
+    beginParse(fileInfo, expectedPath);
+    if (!addData(xml)) {
+        return false;
+    }
+    return endParse();
 }
 
+void LsColXMLParser::beginParse(QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+{
+    _reader.clear();
+    _reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
+    _fileInfo = fileInfo;
+    _expectedPath = expectedPath;
 
-LsColXMLParser::LsColXMLParser() = default;
+    _folders.clear();
+    _currentHref.clear();
+    _currentTmpProperties.clear();
+    _currentHttp200Properties.clear();
+    _currentTextElement = TextElement::None;
+    _currentText.clear();
+    _currentPropertyName.clear();
+    _currentPropertyContent.clear();
+    _propertyDepth = 0;
+    _currentPropsHaveHttp200 = false;
+    _insidePropstat = false;
+    _insideProp = false;
+    _insideMultiStatus = false;
+    _multiStatusComplete = false;
+    _failed = false;
+}
 
-bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+bool LsColXMLParser::addData(const QByteArray &data)
 {
-    // Parse DAV response
-    QXmlStreamReader reader(xml);
-    reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
-
-    QStringList folders;
-    QString currentHref;
-    QMap<QString, QString> currentTmpProperties;
-    QMap<QString, QString> currentHttp200Properties;
-    bool currentPropsHaveHttp200 = false;
-    bool insidePropstat = false;
-    bool insideProp = false;
-    bool insideMultiStatus = false;
-
-    while (!reader.atEnd()) {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        QString name = reader.name().toString();
-        // Start elements with DAV:
-        if (type == QXmlStreamReader::StartElement && reader.namespaceUri() == QLatin1String("DAV:")) {
-            if (name == QLatin1String("href")) {
-                // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
-                // but the result will have URL encoding..
-                QString hrefString = QUrl::fromLocalFile(QUrl::fromPercentEncoding(reader.readElementText().toUtf8()))
-                        .adjusted(QUrl::NormalizePathSegments)
-                        .path();
-                if (!hrefString.startsWith(expectedPath)) {
-                    qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << expectedPath;
+    if (_failed) {
+        return false;
+    }
+    _reader.addData(data);
+    return parseAvailableData();
+}
+
+bool LsColXMLParser::endParse()
+{
+    if (_failed) {
+        return false;
+    }
+
+    if (!_insideMultiStatus) {
+        qCWarning(lcLsColJob) << "ERROR no WebDAV response?" << _reader.errorString();
+        return false;
+    } else if (!_multiStatusComplete) {
+        // The reader only reports PrematureEndOfDocumentError in incremental mode, the body ended before </d:multistatus>
+        qCWarning(lcLsColJob) << "ERROR truncated WebDAV response" << _reader.errorString() << "at line" << _reader.lineNumber();
+        return false;
+    }
+
+    emit directoryListingSubfolders(_folders);
+    emit finishedWithoutError();
+    return true;
+}
+
+bool LsColXMLParser::parseAvailableData()
+{
+    while (!_reader.atEnd()) {
+        const auto type = _reader.readNext();
+        if (type == QXmlStreamReader::Invalid) {
+            break;
+        }
+
+        // All the contents of a property element are collected as a string,
+        // e.g. <d:resourcetype><d:collection/></d:resourcetype> gives "<collection></collection>"
+        if (_propertyDepth > 0) {
+            if (type == QXmlStreamReader::StartElement) {
+                ++_propertyDepth;
+                _currentPropertyContent += "<" + _reader.name().toString() + ">";
+            } else if (type == QXmlStreamReader::Characters) {
+                _currentPropertyContent += _reader.text();
+            } else if (type == QXmlStreamReader::EndElement) {
+                --_propertyDepth;
+                if (_propertyDepth == 0) {
+                    finishProperty();
+                } else {
+                    _currentPropertyContent += "</" + _reader.name().toString() + ">";
+                }
+            }
+            continue;
+        }
+
+        if (_currentTextElement != TextElement::None) {
+            if (type == QXmlStreamReader::Characters) {
+                _currentText += _reader.text();
+            } else if (type == QXmlStreamReader::EndElement) {
+                const auto element = _currentTextElement;
+                _currentTextElement = TextElement::None;
+                if (!finishTextElement(element)) {
+                    _failed = true;
                     return false;
                 }
-                currentHref = hrefString;
-            } else if (name == QLatin1String("response")) {
+            }
+            continue;
+        }
+
+        const auto name = _reader.name();
+        // Start elements with DAV:
+        if (type == QXmlStreamReader::StartElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
+            if (name == QLatin1String("href")) {
+                _currentTextElement = TextElement::Href;
+                _currentText.clear();
+                continue;
             } else if (name == QLatin1String("propstat")) {
-                insidePropstat = true;
-            } else if (name == QLatin1String("status") && insidePropstat) {
-                QString httpStatus = reader.readElementText();
-                if (httpStatus.startsWith("HTTP/1.1 200")) {
-                    currentPropsHaveHttp200 = true;
-                } else {
-                    currentPropsHaveHttp200 = false;
-                }
+                _insidePropstat = true;
+            } else if (name == QLatin1String("status") && _insidePropstat) {
+                _currentTextElement = TextElement::Status;
+                _currentText.clear();
+                continue;
             } else if (name == QLatin1String("prop")) {
-                insideProp = true;
+                _insideProp = true;
                 continue;
             } else if (name == QLatin1String("multistatus")) {
-                insideMultiStatus = true;
+                _insideMultiStatus = true;
                 continue;
             }
         }
 
-        if (type == QXmlStreamReader::StartElement && insidePropstat && insideProp) {
+        if (type == QXmlStreamReader::StartElement && _insidePropstat && _insideProp) {
             // All those elements are properties
-            QString propertyContent = readContentsAsString(reader);
-            if (name == QLatin1String("resourcetype") && propertyContent.contains("collection")) {
-                folders.append(currentHref);
-            } else if (name == QLatin1String("size")) {
-                bool ok = false;
-                auto s = propertyContent.toLongLong(&ok);
-                if (ok && fileInfo) {
-                    (*fileInfo)[currentHref].size = s;
-                }
-            } else if (name == QLatin1String("fileid")) {
-                (*fileInfo)[currentHref].fileId = propertyContent.toUtf8();
-            }
-            currentTmpProperties.insert(reader.name().toString(), propertyContent);
+            _currentPropertyName = name.toString();
+            _currentPropertyContent.clear();
+            _propertyDepth = 1;
+            continue;
         }
 
         // End elements with DAV:
-        if (type == QXmlStreamReader::EndElement) {
-            if (reader.namespaceUri() == QLatin1String("DAV:")) {
-                if (reader.name() == QStringLiteral("response")) {
-                    if (currentHref.endsWith('/')) {
-                        currentHref.chop(1);
-                    }
-                    emit directoryListingIterated(currentHref, currentHttp200Properties);
-                    currentHref.clear();
-                    currentHttp200Properties.clear();
-                } else if (reader.name() == QStringLiteral("propstat")) {
-                    insidePropstat = false;
-                    if (currentPropsHaveHttp200) {
-                        currentHttp200Properties = QMap<QString, QString>(currentTmpProperties);
-                    }
-                    currentTmpProperties.clear();
-                    currentPropsHaveHttp200 = false;
-                } else if (reader.name() == QStringLiteral("prop")) {
-                    insideProp = false;
+        if (type == QXmlStreamReader::EndElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
+            if (name == QLatin1String("response")) {
+                if (_currentHref.endsWith('/')) {
+                    _currentHref.chop(1);
                 }
+                emit directoryListingIterated(_currentHref, _currentHttp200Properties);
+                _currentHref.clear();
+                _currentHttp200Properties.clear();
+            } else if (name == QLatin1String("propstat")) {
+                _insidePropstat = false;
+                if (_currentPropsHaveHttp200) {
+                    _currentHttp200Properties = QMap<QString, QString>(_currentTmpProperties);
+                }
+                _currentTmpProperties.clear();
+                _currentPropsHaveHttp200 = false;
+            } else if (name == QLatin1String("prop")) {
+                _insideProp = false;
+            } else if (name == QLatin1String("multistatus")) {
+                _multiStatusComplete = true;
             }
         }
     }
 
-    if (reader.hasError()) {
+    // Running out of data is expected while the body is still being received
+    if (_reader.hasError() && _reader.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
         // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
-        qCWarning(lcLsColJob) << "ERROR" << reader.errorString() << xml;
-        return false;
-    } else if (!insideMultiStatus) {
-        qCWarning(lcLsColJob) << "ERROR no WebDAV response?" << xml;
+        qCWarning(lcLsColJob) << "ERROR" << _reader.errorString() << "at line" << _reader.lineNumber()
+                              << "column" << _reader.columnNumber();
+        _failed = true;
         return false;
-    } else {
-        emit directoryListingSubfolders(folders);
-        emit finishedWithoutError();
     }
     return true;
 }
 
+bool LsColXMLParser::finishTextElement(TextElement element)
+{
+    if (element == TextElement::Href) {
+        // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
+        // but the result will have URL encoding..
+        const auto hrefString = QUrl::fromLocalFile(QUrl::fromPercentEncoding(_currentText.toUtf8()))
+                                    .adjusted(QUrl::NormalizePathSegments)
+                                    .path();
+        if (!hrefString.startsWith(_expectedPath)) {
+            qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << _expectedPath;
+            return false;
+        }
+        _currentHref = hrefString;
+    } else if (element == TextElement::Status) {
+        _currentPropsHaveHttp200 = _currentText.startsWith("HTTP/1.1 200");
+    }
+    return true;
+}
+
+void LsColXMLParser::finishProperty()
+{
+    if (_currentPropertyName == QLatin1String("resourcetype") && _currentPropertyContent.contains("collection")) {
+        _folders.append(_currentHref);
+    } else if (_currentPropertyName == QLatin1String("size")) {
+        bool ok = false;
+        auto s = _currentPropertyContent.toLongLong(&ok);
+        if (ok && _fileInfo) {
+            (*_fileInfo)[_currentHref].size = s;
+        }
+    } else if (_currentPropertyName == QLatin1String("fileid") && _fileInfo) {
+        (*_fileInfo)[_currentHref].fileId = _currentPropertyContent.toUtf8();
+    }
+    _currentTmpProperties.insert(_currentPropertyName, _currentPropertyContent);
+}
+
 /*********************************************************************************************/
 
 LsColJob::LsColJob(AccountPtr account, const QString &path)
@@ -378,14 +452,28 @@ void LsColJob::start()
     AbstractNetworkJob::start();
 }
 
-// TODO: Instead of doing all in this slot, we should iteratively parse in readyRead(). This
-// would allow us to be more asynchronous in processing while data is coming from the network,
-// not all in one big blob at the end.
-bool LsColJob::finished()
+void LsColJob::newReplyHook(QNetworkReply *reply)
 {
-    qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
-                       << replyStatusString();
+    // A new reply (redirect, HTTP2 resend, ...) starts the body from scratch
+    _parser = std::make_unique<LsColXMLParser>();
+    _parseFailed = false;
+    connect(_parser.get(), &LsColXMLParser::directoryListingSubfolders,
+        this, &LsColJob::directoryListingSubfolders);
+    connect(_parser.get(), &LsColXMLParser::directoryListingIterated,
+        this, &LsColJob::directoryListingIterated);
+    connect(_parser.get(), &LsColXMLParser::finishedWithError,
+        this, &LsColJob::finishedWithError);
+    connect(_parser.get(), &LsColXMLParser::finishedWithoutError,
+        this, &LsColJob::finishedWithoutError);
+
+    const auto expectedPath = reply->request().url().path(); // something like "/owncloud/remote.php/dav/folder"
+    _parser->beginParse(&_folderInfos, expectedPath);
 
+    connect(reply, &QIODevice::readyRead, this, &LsColJob::slotReadyRead);
+}
+
+bool LsColJob::replyIsMultiStatus() const
+{
     const auto contentType = reply()->header(QNetworkRequest::ContentTypeHeader).toString();
     const auto httpCode = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
     const auto validContentType = contentType.contains("application/xml; charset=utf-8") ||
@@ -393,26 +481,36 @@ bool LsColJob::finished()
                                   contentType.contains("text/xml; charset=utf-8") ||
                                   contentType.contains("text/xml; charset=\"utf-8\"");
 
-    if (httpCode == 207 && validContentType) {
-        LsColXMLParser parser;
-        connect(&parser, &LsColXMLParser::directoryListingSubfolders,
-            this, &LsColJob::directoryListingSubfolders);
-        connect(&parser, &LsColXMLParser::directoryListingIterated,
-            this, &LsColJob::directoryListingIterated);
-        connect(&parser, &LsColXMLParser::finishedWithError,
-            this, &LsColJob::finishedWithError);
-        connect(&parser, &LsColXMLParser::finishedWithoutError,
-            this, &LsColJob::finishedWithoutError);
-
-        // bool LsColXMLParser::parse takes a while, let's process some events in attempt to make UI more responsive
-        // from https://doc.qt.io/qt-5/qcoreapplication.html#processEvents-1 
-        // "You can call this function occasionally when your program is busy doing a long operation (e.g. copying a file)."
-        // we should not abuse this function, as it affects QObject instances lifetime (when children are getting deleted or when deleteLater is called)
-        // one reason I had to remove ability for LsColJob to have parent, which, otherwise, leads to a crash later
-        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-
-        QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/dav/folder"
-        if (!parser.parse(reply()->readAll(), &_folderInfos, expectedPath)) {
+    return httpCode == 207 && validContentType;
+}
+
+void LsColJob::slotReadyRead()
+{
+    // Error replies are left untouched, they are handled once the job has finished
+    if (!_parser || !replyIsMultiStatus()) {
+        return;
+    }
+
+    const auto data = reply()->readAll();
+    if (_parseFailed) {
+        // Drain the rest of the body, the error is reported once the reply has finished
+        return;
+    }
+    if (!_parser->addData(data)) {
+        _parseFailed = true;
+    }
+}
+
+bool LsColJob::finished()
+{
+    qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
+                       << replyStatusString();
+
+    if (reply()->error() == QNetworkReply::NoError && replyIsMultiStatus()) {
+        // Pick up whatever has not been delivered through readyRead yet
+        slotReadyRead();
+
+        if (_parseFailed || !_parser->endParse()) {
             // XML parse error
             emit finishedWithError(reply());
         }
@@ -24,6 +24,9 @@
 
 #include <QBuffer>
 #include <QUrlQuery>
+#include <QXmlStreamReader>
+
+#include <memory>
 
 class QUrl;
 class QJsonObject;
@@ -127,15 +130,65 @@ class OWNCLOUDSYNC_EXPORT LsColXMLParser : public QObject
 public:
     explicit LsColXMLParser();
 
+    /** Parses a complete PROPFIND reply body in one go. */
     bool parse(const QByteArray &xml,
                QHash<QString, ExtraFolderInfo> *sizes,
                const QString &expectedPath);
 
+    /**
+     * Incremental parsing of a PROPFIND reply body.
+     *
+     * Call beginParse() once, addData() for every chunk of the body as it arrives and
+     * endParse() once the body is complete. directoryListingIterated() is emitted as soon
+     * as a <d:response> element has been fully received.
+     *
+     * addData() and endParse() return false on a parse error; further data is ignored then.
+     */
+    void beginParse(QHash<QString, ExtraFolderInfo> *sizes, const QString &expectedPath);
+    bool addData(const QByteArray &data);
+    bool endParse();
+
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
+
+private:
+    enum class TextElement {
+        None,
+        Href,
+        Status,
+    };
+
+    bool parseAvailableData();
+    bool finishTextElement(TextElement element);
+    void finishProperty();
+
+    QXmlStreamReader _reader;
+    QHash<QString, ExtraFolderInfo> *_fileInfo = nullptr;
+    QString _expectedPath;
+
+    QStringList _folders;
+    QString _currentHref;
+    QMap<QString, QString> _currentTmpProperties;
+    QMap<QString, QString> _currentHttp200Properties;
+
+    // <d:href> or <d:status> element whose text is being collected
+    TextElement _currentTextElement = TextElement::None;
+    QString _currentText;
+
+    // Property element whose contents are being collected, _propertyDepth > 0 while inside of it
+    QString _currentPropertyName;
+    QString _currentPropertyContent;
+    int _propertyDepth = 0;
+
+    bool _currentPropsHaveHttp200 = false;
+    bool _insidePropstat = false;
+    bool _insideProp = false;
+    bool _insideMultiStatus = false;
+    bool _multiStatusComplete = false;
+    bool _failed = false;
 };
 
 class OWNCLOUDSYNC_EXPORT LsColJob : public AbstractNetworkJob
@@ -164,12 +217,22 @@ signals:
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
 
+protected:
+    void newReplyHook(QNetworkReply *reply) override;
+
 private slots:
     bool finished() override;
+    void slotReadyRead();
 
 private:
+    [[nodiscard]] bool replyIsMultiStatus() const;
+
     QList<QByteArray> _properties;
     QUrl _url; // Used instead of path() if the url is specified in the constructor
+
+    // The reply body is parsed while it is being received
+    std::unique_ptr<LsColXMLParser> _parser;
+    bool _parseFailed = false;
 };
 
 /**
@@ -86,10 +86,11 @@ OwncloudPropagator::~OwncloudPropagator() = default;
 
 int OwncloudPropagator::maximumActiveTransferJob()
 {
-    if (_downloadLimit != 0
-        || _uploadLimit != 0
+    if (_downloadLimit < 0
+        || _uploadLimit < 0
         || !_syncOptions._parallelNetworkJobs) {
-        // disable parallelism when there is a network limit.
+        // disable parallelism when there is a relative network limit, it measures one transfer at a time.
+        // Absolute limits are shared by all transfers.
         return 1;
     }
     return qMin(3, qCeil(_syncOptions._parallelNetworkJobs / 2.));
@@ -333,9 +334,9 @@ void PropagateItemJob::reportClientStatuses()
         if (_item->_direction == SyncFileItem::Up) {
             const auto isCodeBadReqOrUnsupportedMediaType =
                 (_item->_httpErrorCode == HttpErrorCodeBadRequest || _item->_httpErrorCode == HttpErrorCodeUnsupportedMediaType);
-            const auto isExceptionInfoPresent = !_item->_errorExceptionName.isEmpty() && !_item->_errorExceptionMessage.isEmpty();
-            if (isCodeBadReqOrUnsupportedMediaType && isExceptionInfoPresent && _item->_errorExceptionName.contains(QStringLiteral("UnsupportedMediaType"))
-                && _item->_errorExceptionMessage.contains(QStringLiteral("virus"), Qt::CaseInsensitive)) {
+            const auto isExceptionInfoPresent = !_item->errorExceptionName().isEmpty() && !_item->errorExceptionMessage().isEmpty();
+            if (isCodeBadReqOrUnsupportedMediaType && isExceptionInfoPresent && _item->errorExceptionName().contains(QStringLiteral("UnsupportedMediaType"))
+                && _item->errorExceptionMessage().contains(QStringLiteral("virus"), Qt::CaseInsensitive)) {
                 propagator()->account()->reportClientStatus(ClientStatusReportingStatus::UploadError_Virus_Detected);
             } else {
                 propagator()->account()->reportClientStatus(ClientStatusReportingStatus::UploadError_ServerError);
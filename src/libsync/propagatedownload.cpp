@@ -33,6 +33,7 @@
 #include <QFileInfo>
 #include <QDir>
 
+#include <algorithm>
 #include <cmath>
 
 namespace OCC {
@@ -110,7 +111,11 @@ GETFileJob::GETFileJob(AccountPtr account, const QUrl &url, QIODevice *device,
 
 void GETFileJob::start()
 {
-    if (_resumeStart > 0) {
+    if (_rangeEnd > 0) {
+        _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-' + QByteArray::number(_rangeEnd - 1);
+        _headers["Accept-Ranges"] = "bytes";
+        qCDebug(lcGetJob) << "Segment with range " << _headers["Range"];
+    } else if (_resumeStart > 0) {
         _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-';
         _headers["Accept-Ranges"] = "bytes";
         qCDebug(lcGetJob) << "Retry with range " << _headers["Range"];
@@ -222,6 +227,15 @@ void GETFileJob::slotMetaDataChanged()
             start = rxMatch.captured(1).toLongLong();
         }
     }
+    if (_rangeEnd > 0 && ranges.isEmpty()) {
+        // The whole file would overwrite the other segments
+        qCWarning(lcGetJob) << "Server ignored the range of a segmented download";
+        _rangeIgnored = true;
+        _errorString = tr("Server does not support ranged downloads");
+        _errorStatus = SyncFileItem::SoftError;
+        reply()->abort();
+        return;
+    }
     if (start != _resumeStart) {
         qCWarning(lcGetJob) << "Wrong content-range: " << ranges << " while expecting start was" << _resumeStart;
         if (ranges.isEmpty()) {
@@ -301,6 +315,10 @@ void GETFileJob::slotReadyRead()
         }
         qint64 toRead = bufferSize;
         if (_bandwidthLimited) {
+            if (_bandwidthQuota <= 0 && _bandwidthManager) {
+                // an absolute limit hands out its tokens on demand
+                _bandwidthQuota = _bandwidthManager->takeDownloadQuota(this, bufferSize);
+            }
             toRead = qMin(qint64(bufferSize), _bandwidthQuota);
             if (toRead == 0) {
                 qCDebug(lcGetJob) << "Out of quota";
@@ -656,29 +674,49 @@ void PropagateDownloadFile::startDownload()
 
     QString tmpFileName;
     QByteArray expectedEtagForResume;
+    QVector<SyncJournalDb::DownloadInfo::Segment> segments;
+    const auto segmentedDownload = useSegmentedDownload();
     const SyncJournalDb::DownloadInfo progressInfo = propagator()->_journal->getDownloadInfo(_item->_file);
     if (progressInfo._valid) {
         // if the etag has changed meanwhile, remove the already downloaded part.
-        if (progressInfo._etag != _item->_etag) {
+        // The temporary file of a segmented download has holes, it can only be continued in segments.
+        if (progressInfo._etag != _item->_etag
+            || (!progressInfo._segments.isEmpty() && (!segmentedDownload || progressInfo._segments.constLast()._end != _item->_size))) {
             FileSystem::remove(propagator()->fullLocalPath(progressInfo._tmpfile));
             propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
         } else {
             tmpFileName = progressInfo._tmpfile;
             expectedEtagForResume = progressInfo._etag;
+            segments = progressInfo._segments;
         }
     }
 
     if (tmpFileName.isEmpty()) {
         tmpFileName = createDownloadTmpFileName(_item->_file);
+        if (segmentedDownload) {
+            segments = splitIntoSegments();
+        }
     }
     _tmpFile.setFileName(propagator()->fullLocalPath(tmpFileName));
     makeParentFolderModifiable(_tmpFile.fileName());
 
-    _resumeStart = _tmpFile.size();
-    if (_resumeStart > 0 && _resumeStart == _item->_size) {
-        qCInfo(lcPropagateDownload) << "File is already complete, no need to download";
-        downloadFinished();
-        return;
+    if (segments.isEmpty()) {
+        _resumeStart = _tmpFile.size();
+        if (_resumeStart > 0 && _resumeStart == _item->_size) {
+            qCInfo(lcPropagateDownload) << "File is already complete, no need to download";
+            downloadFinished();
+            return;
+        }
+    } else {
+        // Don't trust progress that isn't backed by the temporary file anymore
+        const auto tmpFileSize = _tmpFile.exists() ? _tmpFile.size() : 0;
+        _resumeStart = 0;
+        for (auto &segment : segments) {
+            if (segment._start + segment._received > tmpFileSize) {
+                segment._received = 0;
+            }
+            _resumeStart += segment._received;
+        }
     }
 
     // Can't open(Append) read-only files, make sure to make
@@ -723,26 +761,34 @@ void PropagateDownloadFile::startDownload()
         pi._etag = _item->_etag;
         pi._tmpfile = tmpFileName;
         pi._valid = true;
+        pi._segments = segments;
         propagator()->_journal->setDownloadInfo(_item->_file, pi);
         propagator()->_journal->commit("download file start");
     }
 
+    if (!segments.isEmpty()) {
+        // Every segment writes through a handle of its own
+        _tmpFile.close();
+        startSegmentedDownload(segments);
+        return;
+    }
+
     QMap<QByteArray, QByteArray> headers;
 
-    if (_item->_directDownloadUrl.isEmpty()) {
+    if (_item->directDownloadUrl().isEmpty()) {
         // Normal job, download from oC instance
         _job = new GETFileJob(propagator()->account(),
             propagator()->fullRemotePath(isEncrypted() ? _item->_encryptedFileName : _item->_file),
             &_tmpFile, headers, expectedEtagForResume, _resumeStart, this);
     } else {
         // We were provided a direct URL, use that one
-        qCInfo(lcPropagateDownload) << "directDownloadUrl given for " << _item->_file << _item->_directDownloadUrl;
+        qCInfo(lcPropagateDownload) << "directDownloadUrl given for " << _item->_file << _item->directDownloadUrl();
 
-        if (!_item->_directDownloadCookies.isEmpty()) {
-            headers["Cookie"] = _item->_directDownloadCookies.toUtf8();
+        if (!_item->directDownloadCookies().isEmpty()) {
+            headers["Cookie"] = _item->directDownloadCookies().toUtf8();
         }
 
-        QUrl url = QUrl::fromUserInput(_item->_directDownloadUrl);
+        QUrl url = QUrl::fromUserInput(_item->directDownloadUrl());
         _job = new GETFileJob(propagator()->account(),
             url,
             &_tmpFile, headers, expectedEtagForResume, _resumeStart, this);
@@ -754,6 +800,183 @@ void PropagateDownloadFile::startDownload()
     _job->start();
 }
 
+bool PropagateDownloadFile::useSegmentedDownload() const
+{
+    const auto &syncOptions = propagator()->syncOptions();
+    // Encrypted files get decrypted as one stream and direct download URLs may not support ranges.
+    // With a relative bandwidth limit or without network parallelism, one stream is all we get anyway.
+    return !_segmentedDownloadUnsupported
+        && !isEncrypted()
+        && _item->directDownloadUrl().isEmpty()
+        && syncOptions._downloadSegments > 1
+        && _item->_size > 0
+        && _item->_size >= syncOptions._minSegmentedDownloadSize
+        && propagator()->maximumActiveTransferJob() > 1;
+}
+
+QVector<SyncJournalDb::DownloadInfo::Segment> PropagateDownloadFile::splitIntoSegments() const
+{
+    const auto segmentCount = qMin<qint64>(propagator()->syncOptions()._downloadSegments, _item->_size);
+    const auto segmentSize = (_item->_size + segmentCount - 1) / segmentCount;
+
+    QVector<SyncJournalDb::DownloadInfo::Segment> segments;
+    for (qint64 start = 0; start < _item->_size; start += segmentSize) {
+        segments.append({start, qMin(start + segmentSize, _item->_size), 0});
+    }
+    return segments;
+}
+
+void PropagateDownloadFile::startSegmentedDownload(const QVector<SyncJournalDb::DownloadInfo::Segment> &segments)
+{
+    qCInfo(lcPropagateDownload) << "Downloading" << _item->_file << "in" << segments.size() << "segments, resuming at" << _resumeStart;
+
+    _segments.clear();
+    _segments.reserve(segments.size());
+    for (const auto &range : segments) {
+        _segments.push_back({range, nullptr, nullptr});
+    }
+
+    for (auto &segment : _segments) {
+        const auto offset = segment.range._start + segment.range._received;
+        if (offset == segment.range._end) {
+            continue;
+        }
+
+        segment.file = std::make_unique<QFile>(_tmpFile.fileName());
+        if (!segment.file->open(QIODevice::ReadWrite | QIODevice::Unbuffered) || !segment.file->seek(offset)) {
+            qCWarning(lcPropagateDownload) << "could not open temporary file" << _tmpFile.fileName() << "at" << offset;
+            const auto errorString = segment.file->errorString();
+            abortSegments();
+            saveSegmentProgress();
+            done(SyncFileItem::NormalError, errorString, ErrorCategory::GenericError);
+            return;
+        }
+
+        // Every segment has to come from the same version of the file
+        segment.job = new GETFileJob(propagator()->account(), propagator()->fullRemotePath(_item->_file),
+            segment.file.get(), {}, _item->_etag, offset, this);
+        segment.job->setRangeEnd(segment.range._end);
+        segment.job->setExpectedContentLength(segment.range._end - offset);
+        segment.job->setBandwidthManager(&propagator()->_bandwidthManager);
+        connect(segment.job.data(), &GETFileJob::finishedSignal, this, &PropagateDownloadFile::slotSegmentFinished);
+        connect(segment.job.data(), &GETFileJob::downloadProgress, this, &PropagateDownloadFile::slotSegmentProgress);
+        propagator()->_activeJobList.append(this);
+        segment.job->start();
+    }
+
+    if (std::none_of(_segments.cbegin(), _segments.cend(), [](const DownloadSegment &segment) { return segment.job; })) {
+        qCInfo(lcPropagateDownload) << "All segments are already complete, no need to download";
+        downloadFinished();
+    }
+}
+
+void PropagateDownloadFile::abortSegments()
+{
+    for (auto &segment : _segments) {
+        if (!segment.job) {
+            continue;
+        }
+        const auto job = segment.job.data();
+        segment.job.clear();
+        disconnect(job, nullptr, this, nullptr);
+        propagator()->_activeJobList.removeOne(this);
+
+        segment.range._received = job->currentDownloadPosition() - segment.range._start;
+        job->cancel();
+    }
+}
+
+void PropagateDownloadFile::saveSegmentProgress()
+{
+    auto progressInfo = propagator()->_journal->getDownloadInfo(_item->_file);
+    if (!progressInfo._valid) {
+        return;
+    }
+    progressInfo._segments.clear();
+    for (const auto &segment : _segments) {
+        progressInfo._segments.append(segment.range);
+    }
+    propagator()->_journal->setDownloadInfo(_item->_file, progressInfo);
+    propagator()->_journal->commit("download segment progress");
+}
+
+void PropagateDownloadFile::slotSegmentFinished()
+{
+    propagator()->_activeJobList.removeOne(this);
+
+    const auto job = qobject_cast<GETFileJob *>(sender());
+    ASSERT(job);
+    const auto segment = std::find_if(_segments.begin(), _segments.end(), [job](const DownloadSegment &segment) {
+        return segment.job == job;
+    });
+    ASSERT(segment != _segments.end());
+    segment->job.clear();
+    segment->range._received = job->currentDownloadPosition() - segment->range._start;
+    segment->file->close();
+
+    const auto err = job->reply()->error();
+    const auto complete = segment->range._start + segment->range._received == segment->range._end;
+    if (err != QNetworkReply::NoError || !complete) {
+        // The first failing segment ends the whole download, what arrived so far is kept for the next attempt
+        abortSegments();
+
+        if (job->rangeIgnored()) {
+            qCWarning(lcPropagateDownload) << "Server does not support ranged downloads, downloading" << _item->_file << "in one stream";
+            // closes the handles of the other segments, Windows can't remove the file while they are open
+            _segments.clear();
+            FileSystem::remove(_tmpFile.fileName());
+            propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
+            _segmentedDownloadUnsupported = true;
+            startDownload();
+            return;
+        }
+        saveSegmentProgress();
+        _item->_httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        _item->_requestId = job->requestId();
+
+        if (err == QNetworkReply::NoError) {
+            propagator()->_anotherSyncNeeded = true;
+            done(SyncFileItem::SoftError, tr("The file could not be downloaded completely."), ErrorCategory::GenericError);
+            return;
+        }
+
+        QByteArray errorBody;
+        const auto errorString = _item->_httpErrorCode >= 400 ? job->errorStringParsingBody(&errorBody) : job->errorString();
+        auto status = job->errorStatus();
+        if (status == SyncFileItem::NoStatus) {
+            status = classifyError(err, _item->_httpErrorCode, &propagator()->_anotherSyncNeeded, errorBody);
+        }
+        done(status, errorString, errorCategoryFromNetworkError(err));
+        return;
+    }
+
+    saveSegmentProgress();
+    if (std::any_of(_segments.cbegin(), _segments.cend(), [](const DownloadSegment &segment) { return segment.job; })) {
+        return;
+    }
+
+    applyReplyMetadata(job);
+    if (_tmpFile.size() != _item->_size) {
+        qCWarning(lcPropagateDownload) << "Segmented download of" << _item->_file << "has" << _tmpFile.size() << "bytes instead of" << _item->_size;
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, tr("The file could not be downloaded completely."), ErrorCategory::GenericError);
+        return;
+    }
+
+    // The checksum covers the whole file, so it can only be checked now
+    validateDownloadedFile(job->reply());
+}
+
+void PropagateDownloadFile::slotSegmentProgress()
+{
+    qint64 received = 0;
+    for (const auto &segment : _segments) {
+        received += segment.job ? segment.job->currentDownloadPosition() - segment.range._start : segment.range._received;
+    }
+    _downloadProgress = received - _resumeStart;
+    propagator()->reportProgress(*_item, received);
+}
+
 qint64 PropagateDownloadFile::committedDiskSpace() const
 {
     if (_state == Running) {
@@ -849,10 +1072,10 @@ void PropagateDownloadFile::slotGetFinished()
             propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
         }
 
-        if (!_item->_directDownloadUrl.isEmpty() && err != QNetworkReply::OperationCanceledError) {
+        if (!_item->directDownloadUrl().isEmpty() && err != QNetworkReply::OperationCanceledError) {
             // If this was with a direct download, retry without direct download
-            qCWarning(lcPropagateDownload) << "Direct download of" << _item->_directDownloadUrl << "failed. Retrying through owncloud.";
-            _item->_directDownloadUrl.clear();
+            qCWarning(lcPropagateDownload) << "Direct download of" << _item->directDownloadUrl() << "failed. Retrying through owncloud.";
+            _item->setDirectDownloadUrl({});
             start();
             return;
         }
@@ -891,22 +1114,7 @@ void PropagateDownloadFile::slotGetFinished()
         return;
     }
 
-    _item->_responseTimeStamp = job->responseTimestamp();
-
-    if (!job->etag().isEmpty()) {
-        // The etag will be empty if we used a direct download URL.
-        // (If it was really empty by the server, the GETFileJob will have errored
-        _item->_etag = parseEtag(job->etag());
-    }
-    if (job->lastModified()) {
-        // It is possible that the file was modified on the server since we did the discovery phase
-        // so make sure we have the up-to-date time
-        _item->_modtime = job->lastModified();
-        Q_ASSERT(_item->_modtime > 0);
-        if (_item->_modtime <= 0) {
-            qCWarning(lcPropagateDownload()) << "invalid modified time" << _item->_file << _item->_modtime;
-        }
-    }
+    applyReplyMetadata(job);
 
     _tmpFile.close();
     _tmpFile.flush();
@@ -953,19 +1161,44 @@ void PropagateDownloadFile::slotGetFinished()
         return;
     }
 
+    validateDownloadedFile(job->reply());
+}
+
+void PropagateDownloadFile::applyReplyMetadata(GETFileJob *job)
+{
+    _item->_responseTimeStamp = job->responseTimestamp();
+
+    if (!job->etag().isEmpty()) {
+        // The etag will be empty if we used a direct download URL.
+        // (If it was really empty by the server, the GETFileJob will have errored
+        _item->_etag = parseEtag(job->etag());
+    }
+    if (job->lastModified()) {
+        // It is possible that the file was modified on the server since we did the discovery phase
+        // so make sure we have the up-to-date time
+        _item->_modtime = job->lastModified();
+        Q_ASSERT(_item->_modtime > 0);
+        if (_item->_modtime <= 0) {
+            qCWarning(lcPropagateDownload()) << "invalid modified time" << _item->_file << _item->_modtime;
+        }
+    }
+}
+
+void PropagateDownloadFile::validateDownloadedFile(const QNetworkReply *reply)
+{
     // Did the file come with conflict headers? If so, store them now!
     // If we download conflict files but the server doesn't send conflict
     // headers, the record will be established by SyncEngine::conflictRecordMaintenance.
     // (we can't reliably determine the file id of the base file here,
     // it might still be downloaded in a parallel job and not exist in
     // the database yet!)
-    if (job->reply()->rawHeader("OC-Conflict") == "1") {
+    if (reply->rawHeader("OC-Conflict") == "1") {
         _conflictRecord.path = _item->_file.toUtf8();
-        _conflictRecord.initialBasePath = job->reply()->rawHeader("OC-ConflictInitialBasePath");
-        _conflictRecord.baseFileId = job->reply()->rawHeader("OC-ConflictBaseFileId");
-        _conflictRecord.baseEtag = job->reply()->rawHeader("OC-ConflictBaseEtag");
+        _conflictRecord.initialBasePath = reply->rawHeader("OC-ConflictInitialBasePath");
+        _conflictRecord.baseFileId = reply->rawHeader("OC-ConflictBaseFileId");
+        _conflictRecord.baseEtag = reply->rawHeader("OC-ConflictBaseEtag");
 
-        auto mtimeHeader = job->reply()->rawHeader("OC-ConflictBaseMtime");
+        auto mtimeHeader = reply->rawHeader("OC-ConflictBaseMtime");
         if (!mtimeHeader.isEmpty())
             _conflictRecord.baseModtime = mtimeHeader.toLongLong();
 
@@ -982,8 +1215,8 @@ void PropagateDownloadFile::slotGetFinished()
         this, &PropagateDownloadFile::transmissionChecksumValidated);
     connect(validator, &ValidateChecksumHeader::validationFailed,
         this, &PropagateDownloadFile::slotChecksumFail);
-    auto checksumHeader = findBestChecksum(job->reply()->rawHeader(checkSumHeaderC));
-    auto contentMd5Header = job->reply()->rawHeader(contentMd5HeaderC);
+    auto checksumHeader = findBestChecksum(reply->rawHeader(checkSumHeaderC));
+    auto contentMd5Header = reply->rawHeader(contentMd5HeaderC);
     if (checksumHeader.isEmpty() && !contentMd5Header.isEmpty())
         checksumHeader = "MD5:" + contentMd5Header;
     validator->start(_tmpFile.fileName(), checksumHeader);
@@ -1277,7 +1510,7 @@ void PropagateDownloadFile::downloadFinished()
         }
     }
 
-    if (_item->_locked == SyncFileItem::LockStatus::LockedItem && (_item->_lockOwnerType != SyncFileItem::LockOwnerType::UserLock || _item->_lockOwnerId != propagator()->account()->davUser())) {
+    if (_item->_locked == SyncFileItem::LockStatus::LockedItem && (_item->lockOwnerType() != SyncFileItem::LockOwnerType::UserLock || _item->lockOwnerId() != propagator()->account()->davUser())) {
         qCDebug(lcPropagateDownload()) << _tmpFile.fileName() << "file is locked: making it read only";
         FileSystem::setFileReadOnly(_tmpFile.fileName(), true);
     } else {
@@ -1435,10 +1668,10 @@ void PropagateDownloadFile::updateMetadata(bool isConflict)
         handleRecallFile(fn, propagator()->localPath(), *propagator()->_journal);
     }
 
-    const auto isLockOwnedByCurrentUser = _item->_lockOwnerId == propagator()->account()->davUser();
+    const auto isLockOwnedByCurrentUser = _item->lockOwnerId() == propagator()->account()->davUser();
 
-    const auto isUserLockOwnedByCurrentUser = (_item->_lockOwnerType == SyncFileItem::LockOwnerType::UserLock && isLockOwnedByCurrentUser);
-    const auto isTokenLockOwnedByCurrentUser = (_item->_lockOwnerType == SyncFileItem::LockOwnerType::TokenLock && isLockOwnedByCurrentUser);
+    const auto isUserLockOwnedByCurrentUser = (_item->lockOwnerType() == SyncFileItem::LockOwnerType::UserLock && isLockOwnedByCurrentUser);
+    const auto isTokenLockOwnedByCurrentUser = (_item->lockOwnerType() == SyncFileItem::LockOwnerType::TokenLock && isLockOwnedByCurrentUser);
 
     if (_item->_locked == SyncFileItem::LockStatus::LockedItem && !isUserLockOwnedByCurrentUser && !isTokenLockOwnedByCurrentUser) {
         qCDebug(lcPropagateDownload()) << fn << "file is locked: making it read only";
@@ -1468,6 +1701,12 @@ void PropagateDownloadFile::abort(PropagatorJob::AbortType abortType)
     if (_job && _job->reply())
         _job->reply()->abort();
 
+    for (const auto &segment : _segments) {
+        if (segment.job && segment.job->reply()) {
+            segment.job->reply()->abort();
+        }
+    }
+
     if (abortType == AbortType::Asynchronous) {
         emit abortFinished();
     }
@@ -23,6 +23,9 @@
 #include <QBuffer>
 #include <QFile>
 
+#include <memory>
+#include <vector>
+
 #if !defined(Q_OS_MACOS) || __MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_15
 #include <filesystem>
 #endif
@@ -56,6 +59,9 @@ class OWNCLOUDSYNC_EXPORT GETFileJob : public AbstractNetworkJob
     /// Will be set to true once we've seen a 2xx response header
     bool _saveBodyToFile = false;
 
+    qint64 _rangeEnd = -1;
+    bool _rangeIgnored = false;
+
 protected:
     qint64 _contentLength;
 
@@ -114,6 +120,15 @@ public:
     qint64 resumeStart() { return _resumeStart; }
     time_t lastModified() { return _lastModified; }
 
+    /** Only requests the bytes from resumeStart up to \a end (exclusive)
+     *
+     * The device is written at its current position. Unlike a resume, a server that
+     * ignores the range fails the job instead of restarting the download from scratch.
+     */
+    void setRangeEnd(qint64 end) { _rangeEnd = end; }
+    /// Whether the server replied with the whole file to a request with a range end
+    [[nodiscard]] bool rangeIgnored() const { return _rangeIgnored; }
+
     [[nodiscard]] qint64 contentLength() const { return _contentLength; }
     [[nodiscard]] qint64 expectedContentLength() const { return _expectedContentLength; }
     void setExpectedContentLength(qint64 size) { _expectedContentLength = size; }
@@ -194,6 +209,10 @@ private:
     +-> updateMetadata() <-------------------------+
 
 \endcode
+ *
+ * Large files are downloaded by several ranged GETFileJobs at once, which all
+ * report to slotSegmentFinished(). Once the last one is done, the flow continues
+ * with the checksum validation of the whole file like after slotGetFinished().
  */
 class PropagateDownloadFile : public PropagateItemJob
 {
@@ -252,14 +271,39 @@ private slots:
     void processChecksumRecalculate(const QNetworkReply *reply, const QByteArray &originalChecksumHeader, const QString &errorMessage);
     void checksumValidateFailedAbortDownload(const QString &errMsg);
 
+    /// Called when the GETFileJob of one segment finishes
+    void slotSegmentFinished();
+    void slotSegmentProgress();
+
 private:
+    /// One ranged GET of a segmented download, writing through its own handle of the temporary file
+    struct DownloadSegment {
+        SyncJournalDb::DownloadInfo::Segment range;
+        std::unique_ptr<QFile> file;
+        QPointer<GETFileJob> job;
+    };
+
     void startAfterIsEncryptedIsChecked();
     void deleteExistingFolder();
     [[nodiscard]] bool isEncrypted() const { return _isEncrypted; }
 
+    /// Takes the etag and the modification time the server sent with the file
+    void applyReplyMetadata(GETFileJob *job);
+    /// Stores conflict headers and validates the checksum of the complete temporary file
+    void validateDownloadedFile(const QNetworkReply *reply);
+
+    [[nodiscard]] bool useSegmentedDownload() const;
+    [[nodiscard]] QVector<SyncJournalDb::DownloadInfo::Segment> splitIntoSegments() const;
+    void startSegmentedDownload(const QVector<SyncJournalDb::DownloadInfo::Segment> &segments);
+    /// Stops the segments still running, keeping what they received so far
+    void abortSegments();
+    void saveSegmentProgress();
+
     qint64 _resumeStart = 0;
     qint64 _downloadProgress = 0;
     QPointer<GETFileJob> _job;
+    std::vector<DownloadSegment> _segments;
+    bool _segmentedDownloadUnsupported = false;
     QFile _tmpFile;
     bool _deleteExisting = false;
     bool _isEncrypted = false;
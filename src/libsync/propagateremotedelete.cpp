@@ -29,7 +29,7 @@ Q_LOGGING_CATEGORY(lcPropagateRemoteDelete, "nextcloud.sync.propagator.remotedel
 void PropagateRemoteDelete::start()
 {
     qCInfo(lcPropagateRemoteDelete) << "Start propagate remote delete job for" << _item->_file;
-    qCInfo(lcPermanentLog) << "delete" << _item->_file << _item->_discoveryResult;
+    qCInfo(lcPermanentLog) << "delete" << _item->_file << _item->discoveryResult();
 
     if (propagator()->_abortRequested)
         return;
@@ -73,7 +73,7 @@ void PropagateRemoteDelete::createDeleteJob(const QString &filename)
 
     auto headers = QMap<QByteArray, QByteArray>{};
     if (_item->_locked == SyncFileItem::LockStatus::LockedItem) {
-        headers[QByteArrayLiteral("If")] = (QLatin1String("<") + propagator()->account()->davUrl().toString() + _item->_file + "> (<opaquelocktoken:" + _item->_lockToken.toUtf8() + ">)").toUtf8();
+        headers[QByteArrayLiteral("If")] = (QLatin1String("<") + propagator()->account()->davUrl().toString() + _item->_file + "> (<opaquelocktoken:" + _item->lockToken().toUtf8() + ">)").toUtf8();
     }
     _job = new DeleteJob(propagator()->account(), propagator()->fullRemotePath(remoteFilename), headers, this);
     _job->setSkipTrashbin(_item->_wantsPermanentDeletion);
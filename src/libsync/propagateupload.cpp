@@ -24,6 +24,7 @@
 #include "filesystem.h"
 #include "propagatorjobs.h"
 #include "common/checksums.h"
+#include "common/constants.h"
 #include "syncengine.h"
 #include "deletejob.h"
 #include "common/asserts.h"
@@ -38,8 +39,15 @@
 #include <QJsonObject>
 #include <QFileInfo>
 
+#include <QMutex>
+
 #include <cmath>
 #include <cstring>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
 
 namespace OCC {
 
@@ -113,8 +121,8 @@ bool PollJob::finished()
         _item->_status = classifyError(err, _item->_httpErrorCode);
         _item->_errorString = errorString();
         const auto exceptionParsed = getExceptionFromReply(reply());
-        _item->_errorExceptionName = exceptionParsed.first;
-        _item->_errorExceptionMessage = exceptionParsed.second;
+        _item->setErrorExceptionName(exceptionParsed.first);
+        _item->setErrorExceptionMessage(exceptionParsed.second);
 
         if (_item->_status == SyncFileItem::FatalError || _item->_httpErrorCode >= 400) {
             if (_item->_status != SyncFileItem::FatalError
@@ -240,6 +248,11 @@ void PropagateUploadFileCommon::start()
             this, &PropagateUploadFileCommon::setupEncryptedFile);
     connect(_uploadEncryptedHelper, &PropagateUploadEncrypted::error, [this] {
         qCDebug(lcPropagateUpload) << "Error setting up encryption.";
+        if (_uploadingEncrypted) {
+            // the metadata update after the upload failed, the folder is still locked
+            slotOnErrorStartFolderUnlock(SyncFileItem::FatalError, tr("Failed to upload encrypted file."));
+            return;
+        }
         done(SyncFileItem::FatalError, tr("Failed to upload encrypted file."));
     });
     _uploadEncryptedHelper->start();
@@ -254,6 +267,7 @@ void PropagateUploadFileCommon::setupEncryptedFile(const QString& path, const QS
     _fileToUpload._path = path;
     _fileToUpload._file = filename;
     _fileToUpload._size = size;
+    _streamingEncryptor = _uploadEncryptedHelper->streamingEncryptor();
     startUploadFile();
 }
 
@@ -341,21 +355,47 @@ void PropagateUploadFileCommon::slotComputeContentChecksum()
         return;
     }
 
-    // Compute the content checksum.
+    // Compute the content checksum, and the transmission checksum in the same
+    // pass over the file if the content checksum can't be reused for it.
     auto computeChecksum = new ComputeChecksum(this);
     computeChecksum->setChecksumType(checksumType);
+    const auto transmissionType = transmissionChecksumType(checksumType);
+    if (!transmissionType.isEmpty() && transmissionType != checksumType) {
+        computeChecksum->setAdditionalChecksumTypes({transmissionType});
+    }
 
     connect(computeChecksum, &ComputeChecksum::done,
-        this, &PropagateUploadFileCommon::slotComputeTransmissionChecksum);
+        this, [this, computeChecksum, transmissionType](const QByteArray &contentChecksumType, const QByteArray &contentChecksum) {
+            if (!transmissionType.isEmpty()) {
+                _transmissionChecksumHeader = makeChecksumHeader(transmissionType, computeChecksum->checksum(transmissionType));
+            }
+            slotComputeTransmissionChecksum(contentChecksumType, contentChecksum);
+        });
     connect(computeChecksum, &ComputeChecksum::done,
         computeChecksum, &QObject::deleteLater);
     computeChecksum->start(_fileToUpload._path);
 }
 
+QByteArray PropagateUploadFileCommon::transmissionChecksumType(const QByteArray &contentChecksumType) const
+{
+    const auto &capabilities = propagator()->account()->capabilities();
+    if (!uploadChecksumEnabled() || _streamingEncryptor || capabilities.supportedChecksumTypes().contains(contentChecksumType)) {
+        return {};
+    }
+    return capabilities.uploadChecksumType();
+}
+
 void PropagateUploadFileCommon::slotComputeTransmissionChecksum(const QByteArray &contentChecksumType, const QByteArray &contentChecksum)
 {
     _item->_checksumHeader = makeChecksumHeader(contentChecksumType, contentChecksum);
 
+    // The checksums are of the local file, the uploaded data is only encrypted
+    // while it is sent, so there is no transmission checksum for it
+    if (_streamingEncryptor) {
+        slotStartUpload({}, {});
+        return;
+    }
+
     // Reuse the content checksum as the transmission checksum if possible
     const auto supportedTransmissionChecksums =
         propagator()->account()->capabilities().supportedChecksumTypes();
@@ -364,13 +404,16 @@ void PropagateUploadFileCommon::slotComputeTransmissionChecksum(const QByteArray
         return;
     }
 
+    // Already computed together with the content checksum
+    QByteArray transmissionType, transmissionChecksum;
+    if (parseChecksumHeader(_transmissionChecksumHeader, &transmissionType, &transmissionChecksum) && !transmissionChecksum.isEmpty()) {
+        slotStartUpload(transmissionType, transmissionChecksum);
+        return;
+    }
+
     // Compute the transmission checksum.
     auto computeChecksum = new ComputeChecksum(this);
-    if (uploadChecksumEnabled()) {
-        computeChecksum->setChecksumType(propagator()->account()->capabilities().uploadChecksumType());
-    } else {
-        computeChecksum->setChecksumType(QByteArray());
-    }
+    computeChecksum->setChecksumType(transmissionChecksumType(contentChecksumType));
 
     connect(computeChecksum, &ComputeChecksum::done,
         this, &PropagateUploadFileCommon::slotStartUpload);
@@ -425,8 +468,17 @@ void PropagateUploadFileCommon::slotStartUpload(const QByteArray &transmissionCh
         return slotOnErrorStartFolderUnlock(SyncFileItem::SoftError, tr("Local file changed during syncing. It will be resumed."));
     }
 
-    _fileToUpload._size = FileSystem::getSize(fullFilePath);
     _item->_size = FileSystem::getSize(originalFilePath);
+    if (_streamingEncryptor) {
+        // The encryptor took the size when it opened the file
+        _fileToUpload._size = _streamingEncryptor->size();
+        if (_fileToUpload._size != _item->_size + Constants::e2EeTagSize) {
+            propagator()->_anotherSyncNeeded = true;
+            return slotOnErrorStartFolderUnlock(SyncFileItem::SoftError, tr("Local file changed during syncing. It will be resumed."));
+        }
+    } else {
+        _fileToUpload._size = FileSystem::getSize(fullFilePath);
+    }
 
     // But skip the file if the mtime is too close to 'now'!
     // That usually indicates a file that is still being changed
@@ -436,6 +488,17 @@ void PropagateUploadFileCommon::slotStartUpload(const QByteArray &transmissionCh
         return slotOnErrorStartFolderUnlock(SyncFileItem::SoftError, tr("Local file changed during sync."));
     }
 
+    if (_uploadingEncrypted && _uploadEncryptedHelper->resumesUpload()) {
+        // The data sent before used the same key and IV, they must not encrypt other content
+        const auto uploadInfo = propagator()->_journal->getUploadInfo(_item->_file);
+        if (!uploadInfo._contentChecksum.isEmpty() && !_item->_checksumHeader.isEmpty() && uploadInfo._contentChecksum != _item->_checksumHeader) {
+            propagator()->_journal->setUploadInfo(_item->_file, SyncJournalDb::UploadInfo());
+            propagator()->_journal->commit("Upload info");
+            propagator()->_anotherSyncNeeded = true;
+            return slotOnErrorStartFolderUnlock(SyncFileItem::SoftError, tr("Local file changed during syncing. It will be resumed."));
+        }
+    }
+
     doStartUpload();
 }
 
@@ -462,21 +525,65 @@ void PropagateUploadFileCommon::slotOnErrorStartFolderUnlock(SyncFileItem::Statu
     }
 }
 
+namespace {
+
+constexpr qint64 uploadReadAheadSize = 1024 * 1024;
+constexpr size_t maxPooledReadAheadBuffers = 16;
+
+QMutex readAheadPoolMutex;
+std::vector<QByteArray> readAheadPool;
+
+QByteArray takeReadAheadBuffer()
+{
+    {
+        QMutexLocker locker(&readAheadPoolMutex);
+        if (!readAheadPool.empty()) {
+            auto buffer = std::move(readAheadPool.back());
+            readAheadPool.pop_back();
+            return buffer;
+        }
+    }
+    return QByteArray(uploadReadAheadSize, Qt::Uninitialized);
+}
+
+void returnReadAheadBuffer(QByteArray &&buffer)
+{
+    QMutexLocker locker(&readAheadPoolMutex);
+    if (readAheadPool.size() < maxPooledReadAheadBuffers) {
+        readAheadPool.push_back(std::move(buffer));
+    }
+}
+
+}
+
 UploadDevice::UploadDevice(const QString &fileName, qint64 start, qint64 size, BandwidthManager *bwm)
     : _file(fileName)
     , _start(start)
     , _size(size)
     , _bandwidthManager(bwm)
 {
-    _bandwidthManager->registerUploadDevice(this);
+    if (_bandwidthManager) {
+        _bandwidthManager->registerUploadDevice(this);
+    }
 }
 
+UploadDevice::UploadDevice(const QSharedPointer<EncryptionHelper::StreamingEncryptor> &encryptor, qint64 start, qint64 size, BandwidthManager *bwm)
+    : _encryptor(encryptor)
+    , _start(start)
+    , _size(size)
+    , _bandwidthManager(bwm)
+{
+    if (_bandwidthManager) {
+        _bandwidthManager->registerUploadDevice(this);
+    }
+}
 
 UploadDevice::~UploadDevice()
 {
     if (_bandwidthManager) {
         _bandwidthManager->unregisterUploadDevice(this);
     }
+    releaseReadAhead();
 }
 
 bool UploadDevice::open(QIODevice::OpenMode mode)
@@ -484,6 +591,15 @@ bool UploadDevice::open(QIODevice::OpenMode mode)
     if (mode & QIODevice::WriteOnly)
         return false;
 
+    if (_encryptor) {
+        _size = qBound(0ll, _size, _encryptor->size() - _start);
+        _read = 0;
+        // A rewind by the network stack or a retry of the next chunk continues the encryption there
+        _encryptor->addCheckpoint(_start);
+        _encryptor->addCheckpoint(_start + _size);
+        return QIODevice::open(mode);
+    }
+
     // Get the file size now: _file.fileName() is no longer reliable
     // on all platforms after openAndSeekFileSharedRead().
     auto fileDiskSize = FileSystem::getSize(_file.fileName());
@@ -496,6 +612,11 @@ bool UploadDevice::open(QIODevice::OpenMode mode)
 
     _size = qBound(0ll, _size, fileDiskSize - _start);
     _read = 0;
+    _readAheadPos = _readAheadEnd = 0;
+
+#ifdef Q_OS_LINUX
+    posix_fadvise(_file.handle(), _start, _size, POSIX_FADV_SEQUENTIAL);
+#endif
 
     return QIODevice::open(mode);
 }
@@ -503,9 +624,19 @@ bool UploadDevice::open(QIODevice::OpenMode mode)
 void UploadDevice::close()
 {
     _file.close();
+    releaseReadAhead();
     QIODevice::close();
 }
 
+void UploadDevice::releaseReadAhead()
+{
+    _readAheadPos = _readAheadEnd = 0;
+    if (!_readAhead.isNull()) {
+        returnReadAheadBuffer(std::move(_readAhead));
+        _readAhead = QByteArray();
+    }
+}
+
 qint64 UploadDevice::writeData(const char *, qint64)
 {
     ASSERT(false, "write to read only device");
@@ -529,6 +660,10 @@ qint64 UploadDevice::readData(char *data, qint64 maxlen)
         return 0;
     }
     if (isBandwidthLimited()) {
+        if (_bandwidthQuota <= 0 && _bandwidthManager) {
+            // an absolute limit hands out its tokens on demand
+            _bandwidthQuota = _bandwidthManager->takeUploadQuota(this, maxlen);
+        }
         maxlen = qMin(maxlen, _bandwidthQuota);
         if (maxlen <= 0) { // no quota
             return 0;
@@ -536,18 +671,49 @@ qint64 UploadDevice::readData(char *data, qint64 maxlen)
         _bandwidthQuota -= maxlen;
     }
 
-    auto c = _file.read(data, maxlen);
+    auto c = readFromFile(data, maxlen);
     if (c == 0) {
         setErrorString({});
         return c;
     } else if (c < 0) {
-        setErrorString(_file.errorString());
+        setErrorString(_encryptor ? _encryptor->errorString() : _file.errorString());
         return -1;
     }
     _read += c;
     return c;
 }
 
+qint64 UploadDevice::readFromFile(char *data, qint64 maxlen)
+{
+    if (_encryptor) {
+        // the encryptor buffers a block of its output already
+        return _encryptor->read(_start + _read, data, maxlen);
+    }
+
+    if (_readAheadPos == _readAheadEnd) {
+        const auto remaining = _size - _read;
+        if (maxlen >= qMin(uploadReadAheadSize, remaining)) {
+            // large enough to go to the file directly
+            return _file.read(data, maxlen);
+        }
+
+        if (_readAhead.isNull()) {
+            _readAhead = takeReadAheadBuffer();
+        }
+        const auto c = _file.read(_readAhead.data(), qMin(uploadReadAheadSize, remaining));
+        if (c <= 0) {
+            return c;
+        }
+        _readAheadPos = 0;
+        _readAheadEnd = c;
+    }
+
+    const auto c = qMin(maxlen, _readAheadEnd - _readAheadPos);
+    std::memcpy(data, _readAhead.constData() + _readAheadPos, c);
+    _readAheadPos += c;
+    return c;
+}
+
 void UploadDevice::slotJobUploadProgress(qint64 sent, qint64 t)
 {
     if (sent == 0 || t == 0) {
@@ -586,7 +752,10 @@ bool UploadDevice::seek(qint64 pos)
         return false;
     }
     _read = pos;
-    _file.seek(_start + pos);
+    _readAheadPos = _readAheadEnd = 0;
+    if (!_encryptor) {
+        _file.seek(_start + pos);
+    }
     return true;
 }
 
@@ -804,8 +973,32 @@ QMap<QByteArray, QByteArray> PropagateUploadFileCommon::headers()
     return headers;
 }
 
+void PropagateUploadFileCommon::addEncryptionToUploadInfo(SyncJournalDb::UploadInfo &uploadInfo) const
+{
+    if (_uploadingEncrypted) {
+        _uploadEncryptedHelper->addToUploadInfo(uploadInfo);
+    }
+}
+
+std::unique_ptr<UploadDevice> PropagateUploadFileCommon::createUploadDevice(qint64 start, qint64 size)
+{
+    if (_streamingEncryptor) {
+        return std::make_unique<UploadDevice>(_streamingEncryptor, start, size, &propagator()->_bandwidthManager);
+    }
+    return std::make_unique<UploadDevice>(_fileToUpload._path, start, size, &propagator()->_bandwidthManager);
+}
+
 void PropagateUploadFileCommon::finalize()
 {
+    if (_streamingEncryptor) {
+        // The e2EeTag is known now that all of the data was sent, add the file
+        // to the metadata before the folder gets unlocked
+        _streamingEncryptor.reset();
+        connect(_uploadEncryptedHelper, &PropagateUploadEncrypted::metadataFinalized, this, &PropagateUploadFileCommon::finalize);
+        _uploadEncryptedHelper->finalizeMetadata();
+        return;
+    }
+
     // Update the quota, if known
     auto quotaIt = propagator()->_folderQuota.find(QFileInfo(_item->_file).path());
     if (quotaIt != propagator()->_folderQuota.end())
@@ -19,6 +19,7 @@
 #include <QBuffer>
 #include <QFile>
 #include <QElapsedTimer>
+#include <QSharedPointer>
 
 
 namespace OCC {
@@ -30,6 +31,10 @@ Q_DECLARE_LOGGING_CATEGORY(lcPropagateUploadNG)
 
 class BandwidthManager;
 
+namespace EncryptionHelper {
+class StreamingEncryptor;
+}
+
 /**
  * @brief The UploadDevice class
  * @ingroup libsync
@@ -39,6 +44,8 @@ class UploadDevice : public QIODevice
     Q_OBJECT
 public:
     UploadDevice(const QString &fileName, qint64 start, qint64 size, BandwidthManager *bwm);
+    /// Uploads the output of \a encryptor instead of a local file, the encryptor must be open
+    UploadDevice(const QSharedPointer<EncryptionHelper::StreamingEncryptor> &encryptor, qint64 start, qint64 size, BandwidthManager *bwm);
     ~UploadDevice() override;
 
     bool open(QIODevice::OpenMode mode) override;
@@ -63,6 +70,8 @@ signals:
 private:
     /// The local file to read data from
     QFile _file;
+    /// Encrypts the file while it is read, shared by the devices of all chunks
+    QSharedPointer<EncryptionHelper::StreamingEncryptor> _encryptor;
 
     /// Start of the file data to use
     qint64 _start = 0;
@@ -71,6 +80,19 @@ private:
     /// Position between _start and _start+_size
     qint64 _read = 0;
 
+    /** File data read ahead of _read, taken from a pool shared by all devices
+     *
+     * Reading the file in large blocks saves most of the system calls of the small
+     * reads the network stack does, and the buffer is reused by the next chunks.
+     */
+    QByteArray _readAhead;
+    /// Range of _readAhead that wasn't handed out yet
+    qint64 _readAheadPos = 0;
+    qint64 _readAheadEnd = 0;
+
+    qint64 readFromFile(char *data, qint64 maxlen);
+    void releaseReadAhead();
+
     // Bandwidth manager related
     QPointer<BandwidthManager> _bandwidthManager;
     qint64 _bandwidthQuota = 0;
@@ -237,6 +259,13 @@ protected:
     UploadFileInfo _fileToUpload;
     QByteArray _transmissionChecksumHeader;
 
+    /** Encrypts the file while it is uploaded, set for new end-to-end encrypted files
+     *
+     * The chunks have to be read in order then, and the e2EeTag for the metadata
+     * is only known once all of the data was sent.
+     */
+    QSharedPointer<EncryptionHelper::StreamingEncryptor> _streamingEncryptor;
+
 public:
     PropagateUploadFileCommon(OwncloudPropagator *propagator, const SyncFileItemPtr &item);
 
@@ -256,6 +285,10 @@ public:
     void callUnlockFolder();
     bool isLikelyFinishedQuickly() override { return _item->_size < propagator()->smallFileSize(); }
 
+private:
+    /// The transmission checksum type to compute besides \a contentChecksumType, empty if none is needed
+    [[nodiscard]] QByteArray transmissionChecksumType(const QByteArray &contentChecksumType) const;
+
 private slots:
     void slotComputeContentChecksum();
     // Content checksum computed, compute the transmission checksum
@@ -274,6 +307,9 @@ public:
     void finalize();
     void abortWithError(SyncFileItem::Status status, const QString &error);
 
+    /// The device uploading \a size bytes of the data at \a start
+    [[nodiscard]] std::unique_ptr<UploadDevice> createUploadDevice(qint64 start, qint64 size);
+
 public slots:
     void slotJobDestroyed(QObject *job);
 
@@ -316,6 +352,9 @@ protected:
 
     /** Bases headers that need to be sent on the PUT, or in the MOVE for chunking-ng */
     QMap<QByteArray, QByteArray> headers();
+
+    /// Adds the key, IV and name of the data of an encrypted file, so a resumed upload sends the same data
+    void addEncryptionToUploadInfo(SyncJournalDb::UploadInfo &uploadInfo) const;
 private:
   PropagateUploadEncrypted *_uploadEncryptedHelper = nullptr;
   bool _uploadingEncrypted = false;
@@ -408,20 +447,29 @@ private:
         QString originalName;
     };
 
+    struct RunningChunk {
+        qint64 size = 0LL;
+        qint64 progress = 0LL; /// bytes of this chunk sent so far
+        qint64 confirmedAtStart = 0LL; /// _confirmed when this chunk was started
+    };
+
     [[nodiscard]] QUrl chunkUploadFolderUrl() const;
     [[nodiscard]] QUrl chunkUrl(const int chunk) const;
     [[nodiscard]] QByteArray destinationHeader() const;
+    /// How many chunk PUTs of this file may be in flight at once
+    [[nodiscard]] int parallelChunkUploads() const;
 
     void startNewUpload();
     void startNextChunk();
     void finishUpload();
 
     QMap<qint64, ServerChunkInfo> _serverChunks;
+    QHash<PUTFileJob *, RunningChunk> _runningChunks;
 
-    qint64 _sent = 0; /// amount of data (bytes) that was already sent
+    qint64 _sent = 0; /// amount of data (bytes) handed to chunk uploads, the offset of the next chunk
+    qint64 _confirmed = 0; /// amount of data (bytes) the server acknowledged
     uint _transferId = 0; /// transfer id (part of the url)
     int _currentChunk = 1; /// Id of the next chunk that will be sent
-    qint64 _currentChunkSize = 0; /// current chunk size
     bool _removeJobError = false; /// If not null, there was an error removing the job
 };
 }
@@ -6,6 +6,7 @@
 #include "encryptedfoldermetadatahandler.h"
 #include "filesystem.h"
 #include "account.h"
+#include "deletejob.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QUrl>
@@ -80,6 +81,11 @@ const QByteArray PropagateUploadEncrypted::folderToken() const
     return _encryptedFolderMetadataHandler ? _encryptedFolderMetadataHandler->folderToken() : QByteArray{};
 }
 
+QSharedPointer<EncryptionHelper::StreamingEncryptor> PropagateUploadEncrypted::streamingEncryptor() const
+{
+    return _streamingEncryptor;
+}
+
 void PropagateUploadEncrypted::slotFetchMetadataJobFinished(int statusCode, const QString &message)
 {
     qCDebug(lcPropagateUploadEncrypted) << "Metadata Received, Preparing it for the new file." << message;
@@ -131,6 +137,19 @@ void PropagateUploadEncrypted::slotFetchMetadataJobFinished(int statusCode, cons
 
     encryptedFile.initializationVector = EncryptionHelper::generateRandom(16);
 
+    // An interrupted upload of the unchanged file continues with the data it sent before
+    const auto uploadInfo = _propagator->_journal->getUploadInfo(_item->_file);
+    if (!info.isDir() && uploadInfo._valid && !uploadInfo._e2eInitializationVector.isEmpty()
+        && uploadInfo._size == info.size() && uploadInfo._modtime == FileSystem::getModTime(info.absoluteFilePath())
+        && (!found || (uploadInfo._e2eEncryptionKey == encryptedFile.encryptionKey && uploadInfo._e2eEncryptedFileName == encryptedFile.encryptedFilename))) {
+        qCInfo(lcPropagateUploadEncrypted) << "Using the key and IV of the earlier upload of" << _item->_file;
+        encryptedFile.encryptionKey = uploadInfo._e2eEncryptionKey;
+        encryptedFile.encryptedFilename = uploadInfo._e2eEncryptedFileName;
+        encryptedFile.initializationVector = uploadInfo._e2eInitializationVector;
+        _resumesUpload = true;
+    }
+    _encryptedFile = encryptedFile;
+
     _item->_encryptedFileName =  Utility::trailingSlashPath(_remoteParentPath) + encryptedFile.encryptedFilename;
     _item->_e2eEncryptionStatusRemote = metadata->existingMetadataEncryptionStatus();
     _item->_e2eEncryptionServerCapability =
@@ -138,6 +157,25 @@ void PropagateUploadEncrypted::slotFetchMetadataJobFinished(int statusCode, cons
 
     qCDebug(lcPropagateUploadEncrypted) << "Creating the encrypted file.";
 
+    // A new file is encrypted while it is uploaded and the metadata follows with the e2EeTag.
+    // Uploading an existing file replaces its data, which its metadata couldn't decrypt
+    // anymore if the metadata failed to follow, so that metadata is sent first.
+    const auto encryptWhileUploading = !info.isDir() && !found;
+    if (encryptWhileUploading) {
+        _streamingEncryptor.reset(new EncryptionHelper::StreamingEncryptor(info.absoluteFilePath(), encryptedFile.encryptionKey, encryptedFile.initializationVector));
+        if (!_streamingEncryptor->open()) {
+            qCDebug(lcPropagateUploadEncrypted()) << "There was an error encrypting the file, aborting upload." << _streamingEncryptor->errorString();
+            emit error();
+            return;
+        }
+
+        qCDebug(lcPropagateUploadEncrypted) << "Finalizing the upload part, now the actuall uploader will take over";
+        emit finalized(info.absoluteFilePath(),
+                       Utility::trailingSlashPath(_remoteParentPath) + encryptedFile.encryptedFilename,
+                       _streamingEncryptor->size());
+        return;
+    }
+
     if (info.isDir()) {
         _completeFileName = encryptedFile.encryptedFilename;
     } else {
@@ -167,15 +205,42 @@ void PropagateUploadEncrypted::slotFetchMetadataJobFinished(int statusCode, cons
     _encryptedFolderMetadataHandler->uploadMetadata(EncryptedFolderMetadataHandler::UploadMode::KeepLock);
 }
 
+void PropagateUploadEncrypted::finalizeMetadata()
+{
+    Q_ASSERT(_streamingEncryptor && !_streamingEncryptor->tag().isEmpty());
+    if (!_streamingEncryptor || _streamingEncryptor->tag().isEmpty()) {
+        qCWarning(lcPropagateUploadEncrypted) << "The file was not encrypted completely, can't update the metadata" << _item->_file;
+        emit error();
+        return;
+    }
+
+    _encryptedFile.authenticationTag = _streamingEncryptor->tag();
+    _encryptedFolderMetadataHandler->folderMetadata()->addEncryptedFile(_encryptedFile);
+
+    qCDebug(lcPropagateUploadEncrypted) << "File uploaded, sending the metadata to the server.";
+
+    connect(_encryptedFolderMetadataHandler.data(), &EncryptedFolderMetadataHandler::uploadFinished, this, &PropagateUploadEncrypted::slotUploadMetadataFinished);
+    _encryptedFolderMetadataHandler->uploadMetadata(EncryptedFolderMetadataHandler::UploadMode::KeepLock);
+}
+
 void PropagateUploadEncrypted::slotUploadMetadataFinished(int statusCode, const QString &message)
 {
     if (statusCode != 200) {
         qCDebug(lcPropagateUploadEncrypted) << "Update metadata error for folder" << _encryptedFolderMetadataHandler->folderId() << "with error" << message;
+        if (_streamingEncryptor) {
+            removeUploadedFile();
+            return;
+        }
         qCDebug(lcPropagateUploadEncrypted()) << "Unlocking the folder.";
         emit error();
         return;
     }
 
+    if (_streamingEncryptor) {
+        emit metadataFinalized();
+        return;
+    }
+
     qCDebug(lcPropagateUploadEncrypted) << "Uploading of the metadata success, Encrypting the file";
     QFileInfo outputInfo(_completeFileName);
 
@@ -186,4 +251,30 @@ void PropagateUploadEncrypted::slotUploadMetadataFinished(int statusCode, const
                    FileSystem::getSize(_completeFileName));
 }
 
+bool PropagateUploadEncrypted::resumesUpload() const
+{
+    return _resumesUpload;
+}
+
+void PropagateUploadEncrypted::addToUploadInfo(SyncJournalDb::UploadInfo &uploadInfo) const
+{
+    uploadInfo._e2eEncryptionKey = _encryptedFile.encryptionKey;
+    uploadInfo._e2eInitializationVector = _encryptedFile.initializationVector;
+    uploadInfo._e2eEncryptedFileName = _encryptedFile.encryptedFilename;
+}
+
+void PropagateUploadEncrypted::removeUploadedFile()
+{
+    // No metadata refers to the uploaded file, remove it while the folder is still locked
+    qCInfo(lcPropagateUploadEncrypted) << "Removing the uploaded file" << _item->_encryptedFileName << "of" << _item->_file;
+    const auto deleteJob = new DeleteJob(_propagator->account(), _propagator->fullRemotePath(_item->_encryptedFileName), {}, this);
+    deleteJob->setSkipTrashbin(true);
+    deleteJob->setFolderToken(folderToken());
+    connect(deleteJob, &DeleteJob::finishedSignal, this, [this] {
+        qCDebug(lcPropagateUploadEncrypted()) << "Unlocking the folder.";
+        emit error();
+    });
+    deleteJob->start();
+}
+
 } // namespace OCC
@@ -10,9 +10,11 @@
 #include <QScopedPointer>
 #include <QFile>
 #include <QTemporaryFile>
+#include <QSharedPointer>
 
 #include "owncloudpropagator.h"
 #include "clientsideencryption.h"
+#include "foldermetadata.h"
 
 namespace OCC {
 
@@ -21,8 +23,19 @@ namespace OCC {
  * client starts the upload request we don't know if the folder is
  * encrypted on the server.
  *
+ * New files are encrypted while they are uploaded, so their metadata can only
+ * be sent with finalizeMetadata() once the upload is done. If the client stops
+ * in between, the data stays on the server without metadata until the next
+ * sync uploads the file again under the same name. Files that exist in the
+ * metadata are encrypted into a temporary file and the metadata is sent before
+ * the upload.
+ *
+ * The key, IV and name of the data are kept in the upload info, so that an
+ * interrupted upload of the unchanged file is resumed with the same data.
+ *
  * emits:
  * finalized() if the encrypted file is ready to be uploaded
+ * metadataFinalized() once the metadata of an uploaded file was sent
  * error() if there was an error with the encryption
  * folderNotEncrypted() if the file is within a folder that's not encrypted.
  *
@@ -45,17 +58,32 @@ public:
     [[nodiscard]] bool isFolderLocked() const;
     [[nodiscard]] const QByteArray folderToken() const;
 
+    /// Encrypts the file while it is uploaded, null for folders and files that exist in the metadata
+    [[nodiscard]] QSharedPointer<EncryptionHelper::StreamingEncryptor> streamingEncryptor() const;
+
+    /// Adds the uploaded file with its e2EeTag to the metadata and sends it, keeping the lock
+    void finalizeMetadata();
+
+    /// Whether the key and IV are the ones of an earlier, interrupted upload
+    [[nodiscard]] bool resumesUpload() const;
+
+    /// Stores what a resumed upload needs to send the same data again
+    void addToUploadInfo(SyncJournalDb::UploadInfo &uploadInfo) const;
+
 private slots:
     void slotFetchMetadataJobFinished(int statusCode, const QString &message);
     void slotUploadMetadataFinished(int statusCode, const QString &message);
 
 signals:
-    // Emitted after the file is encrypted and everything is setup.
+    // Emitted when the file can be uploaded, for files the encryption happens during the upload.
     void finalized(const QString& path, const QString& filename, quint64 size);
+    void metadataFinalized();
     void error();
     void folderUnlocked(const QByteArray &folderId, int httpStatus);
 
 private:
+  void removeUploadedFile();
+
   OwncloudPropagator *_propagator;
   QString _remoteParentPath;
   SyncFileItemPtr _item;
@@ -71,6 +99,10 @@ private:
   QString _completeFileName;
   QString _remoteParentAbsolutePath;
 
+  QSharedPointer<EncryptionHelper::StreamingEncryptor> _streamingEncryptor;
+  FolderMetadata::EncryptedFile _encryptedFile;
+  bool _resumesUpload = false;
+
   QScopedPointer<EncryptedFolderMetadataHandler> _encryptedFolderMetadataHandler;
 };
 
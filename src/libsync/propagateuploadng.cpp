@@ -82,6 +82,9 @@ QUrl PropagateUploadFileNG::chunkUrl(const int chunk) const
     |
     +-> MOVE ------> moveJobFinished() ---> finalize()
 
+  startNextChunk() keeps up to parallelChunkUploads() chunk PUTs in flight. The MOVE
+  is only sent once all of them finished.
+
 
  */
 
@@ -158,6 +161,7 @@ void PropagateUploadFileNG::slotPropfindFinished()
         _serverChunks.remove(_currentChunk);
         ++_currentChunk;
     }
+    _confirmed = _sent;
 
     if (_sent > _fileToUpload._size) {
         // Normally this can't happen because the size is xor'ed with the transfer id, and it is
@@ -256,6 +260,7 @@ void PropagateUploadFileNG::startNewUpload()
     }
     _transferId = uint(Utility::rand() ^ uint(_item->_modtime) ^ (uint(_fileToUpload._size) << 16) ^ qHash(_fileToUpload._file));
     _sent = 0;
+    _confirmed = 0;
     _currentChunk = 1; // Chunked upload v2: numbers range from 1 to 10000
 
     propagator()->reportProgress(*_item, 0);
@@ -270,6 +275,7 @@ void PropagateUploadFileNG::startNewUpload()
     pi._modtime = _item->_modtime;
     pi._contentChecksum = _item->_checksumHeader;
     pi._size = _item->_size;
+    addEncryptionToUploadInfo(pi);
     propagator()->_journal->setUploadInfo(_item->_file, pi);
     propagator()->_journal->commit("Upload info");
     QMap<QByteArray, QByteArray> headers;
@@ -328,9 +334,9 @@ void PropagateUploadFileNG::finishUpload()
 
     const auto fileSize = _fileToUpload._size;
     headers[QByteArrayLiteral("OC-Total-Length")] = QByteArray::number(fileSize);
-    if (_item->_lockOwnerType == SyncFileItem::LockOwnerType::TokenLock &&
+    if (_item->lockOwnerType() == SyncFileItem::LockOwnerType::TokenLock &&
         _item->_locked == SyncFileItem::LockStatus::LockedItem) {
-        headers[QByteArrayLiteral("If")] = (QLatin1String("<") + propagator()->account()->davUrl().toString() + _fileToUpload._file + "> (<opaquelocktoken:" + _item->_lockToken.toUtf8() + ">)").toUtf8();
+        headers[QByteArrayLiteral("If")] = (QLatin1String("<") + propagator()->account()->davUrl().toString() + _fileToUpload._file + "> (<opaquelocktoken:" + _item->lockToken().toUtf8() + ">)").toUtf8();
     }
 
     const auto job = new MoveJob(propagator()->account(), Utility::concatUrlPath(chunkUploadFolderUrl(), "/.file"), destination, headers, this);
@@ -343,6 +349,21 @@ void PropagateUploadFileNG::finishUpload()
     return;
 }
 
+int PropagateUploadFileNG::parallelChunkUploads() const
+{
+    // With a relative bandwidth limit or without network parallelism, keep the chunks serial as well.
+    // A new encrypted file is encrypted in order while it is read.
+    if (propagator()->maximumActiveTransferJob() <= 1 || _streamingEncryptor) {
+        return 1;
+    }
+
+    const auto serverLimit = propagator()->account()->capabilities().maxConcurrentChunkUploads();
+    if (serverLimit <= 0) {
+        return 1;
+    }
+    return qBound(1, propagator()->syncOptions()._parallelChunkUploads, serverLimit);
+}
+
 void PropagateUploadFileNG::startNextChunk()
 {
     if (propagator()->_abortRequested)
@@ -350,16 +371,20 @@ void PropagateUploadFileNG::startNextChunk()
 
     const auto fileSize = _fileToUpload._size;
     ENFORCE(fileSize >= _sent, "Sent data exceeds file size")
-    // prevent situation that chunk size is bigger then required one to send
-    _currentChunkSize = qMin(propagator()->_chunkSize, fileSize - _sent);
 
-    if (_currentChunkSize == 0) {
-        finishUpload();
+    if (_sent == fileSize) {
+        // The chunks can only be assembled once all of them arrived
+        if (_runningChunks.isEmpty()) {
+            finishUpload();
+        }
         return;
     }
 
+    // prevent situation that chunk size is bigger then required one to send
+    const auto chunkSize = qMin(propagator()->_chunkSize, fileSize - _sent);
+
     const auto fileName = _fileToUpload._path;
-    auto device = std::make_unique<UploadDevice>(fileName, _sent, _currentChunkSize, &propagator()->_bandwidthManager);
+    auto device = createUploadDevice(_sent, chunkSize);
     if (!device->open(QIODevice::ReadOnly)) {
         qCWarning(lcPropagateUploadNG) << "Could not prepare upload device: " << device->errorString();
 
@@ -377,7 +402,7 @@ void PropagateUploadFileNG::startNextChunk()
     headers["OC-Chunk-Offset"] = QByteArray::number(_sent);
     headers["Destination"] = destinationHeader();
 
-    _sent += _currentChunkSize;
+    _sent += chunkSize;
     const auto url = chunkUrl(_currentChunk);
 
     // job takes ownership of device via a QScopedPointer. Job deletes itself when finishing
@@ -390,9 +415,14 @@ void PropagateUploadFileNG::startNextChunk()
     connect(job, &PUTFileJob::uploadProgress,
         devicePtr, &UploadDevice::slotJobUploadProgress);
     connect(job, &QObject::destroyed, this, &PropagateUploadFileCommon::slotJobDestroyed);
+    _runningChunks.insert(job, {chunkSize, 0, _confirmed});
     job->start();
     propagator()->_activeJobList.append(this);
     _currentChunk++;
+
+    if (_runningChunks.size() < parallelChunkUploads()) {
+        startNextChunk();
+    }
 }
 
 void PropagateUploadFileNG::slotPutFinished()
@@ -401,6 +431,7 @@ void PropagateUploadFileNG::slotPutFinished()
     ASSERT(job);
 
     slotJobDestroyed(job); // remove it from the _jobs list
+    const auto chunk = _runningChunks.take(job);
 
     propagator()->_activeJobList.removeOne(this);
 
@@ -416,12 +447,13 @@ void PropagateUploadFileNG::slotPutFinished()
         _item->_requestId = job->requestId();
         commonErrorHandling(job);
         const auto exceptionParsed = getExceptionFromReply(job->reply());
-        _item->_errorExceptionName = exceptionParsed.first;
-        _item->_errorExceptionMessage = exceptionParsed.second;
+        _item->setErrorExceptionName(exceptionParsed.first);
+        _item->setErrorExceptionMessage(exceptionParsed.second);
         return;
     }
 
     ENFORCE(_sent <= _fileToUpload._size, "can't send more than size");
+    _confirmed += chunk.size;
 
     // Adjust the chunk size for the time taken.
     //
@@ -430,7 +462,12 @@ void PropagateUploadFileNG::slotPutFinished()
     auto targetDuration = propagator()->syncOptions()._targetChunkUploadDuration;
     if (targetDuration.count() > 0) {
         auto uploadTime = ++job->msSinceStart(); // add one to avoid div-by-zero
-        qint64 predictedGoodSize = (_currentChunkSize * targetDuration) / uploadTime;
+
+        // Parallel chunks share the bandwidth: take everything that arrived while this chunk
+        // was uploading as the aggregate throughput, and split it among the chunks in flight.
+        const auto confirmedDuringUpload = _confirmed - chunk.confirmedAtStart;
+        const auto parallelChunks = _runningChunks.size() + 1;
+        qint64 predictedGoodSize = (confirmedDuringUpload * targetDuration) / uploadTime / parallelChunks;
 
         // The whole targeting is heuristic. The predictedGoodSize will fluctuate
         // quite a bit because of external factors (like available bandwidth)
@@ -443,13 +480,13 @@ void PropagateUploadFileNG::slotPutFinished()
         // Adjust the dynamic chunk size _chunkSize used for sizing of the item's chunks to be send
         propagator()->_chunkSize = ::qBound(propagator()->syncOptions().minChunkSize(), targetSize, propagator()->syncOptions().maxChunkSize());
 
-        qCInfo(lcPropagateUploadNG) << "Chunked upload of" << _currentChunkSize << "bytes took" << uploadTime.count()
-                                  << "ms, desired is" << targetDuration.count() << "ms, expected good chunk size is"
+        qCInfo(lcPropagateUploadNG) << "Chunked upload of" << chunk.size << "bytes took" << uploadTime.count()
+                                  << "ms with" << parallelChunks << "chunks in flight, desired is" << targetDuration.count() << "ms, expected good chunk size is"
                                   << predictedGoodSize << "bytes and nudged next chunk size to "
                                   << propagator()->_chunkSize << "bytes";
     }
 
-    _finished = _sent == _item->_size;
+    _finished = _sent == _item->_size && _runningChunks.isEmpty();
 
     // Check if the file still exists
     const QString fullFilePath(propagator()->fullLocalPath(_item->_file));
@@ -504,8 +541,8 @@ void PropagateUploadFileNG::slotMoveJobFinished()
     if (err != QNetworkReply::NoError) {
         commonErrorHandling(job);
         const auto exceptionParsed = getExceptionFromReply(job->reply());
-        _item->_errorExceptionName = exceptionParsed.first;
-        _item->_errorExceptionMessage = exceptionParsed.second;
+        _item->setErrorExceptionName(exceptionParsed.first);
+        _item->setErrorExceptionMessage(exceptionParsed.second);
         return;
     }
 
@@ -563,7 +600,17 @@ void PropagateUploadFileNG::slotUploadProgress(qint64 sent, qint64 total)
     if (sent == 0 && total == 0) {
         return;
     }
-    propagator()->reportProgress(*_item, _sent + sent - total);
+
+    const auto job = qobject_cast<PUTFileJob *>(sender());
+    if (const auto it = _runningChunks.find(job); it != _runningChunks.end()) {
+        it->progress = sent;
+    }
+
+    auto progress = _confirmed;
+    for (const auto &chunk : std::as_const(_runningChunks)) {
+        progress += chunk.progress;
+    }
+    propagator()->reportProgress(*_item, progress);
 }
 
 void PropagateUploadFileNG::abort(PropagatorJob::AbortType abortType)
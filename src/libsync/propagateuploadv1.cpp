@@ -72,6 +72,7 @@ void PropagateUploadFileV1::doStartUpload()
         pi._errorCount = 0;
         pi._contentChecksum = _item->_checksumHeader;
         pi._size = _item->_size;
+        addEncryptionToUploadInfo(pi);
         propagator()->_journal->setUploadInfo(_item->_file, pi);
         propagator()->_journal->commit("Upload info");
     }
@@ -102,9 +103,9 @@ void PropagateUploadFileV1::startNextChunk()
 
     QString path = _fileToUpload._file;
 
-    if (_item->_lockOwnerType == SyncFileItem::LockOwnerType::TokenLock &&
+    if (_item->lockOwnerType() == SyncFileItem::LockOwnerType::TokenLock &&
         _item->_locked == SyncFileItem::LockStatus::LockedItem) {
-        headers[QByteArrayLiteral("If")] = (QLatin1String("<") + propagator()->account()->davUrl().toString() + _fileToUpload._file + "> (<opaquelocktoken:" + _item->_lockToken.toUtf8() + ">)").toUtf8();
+        headers[QByteArrayLiteral("If")] = (QLatin1String("<") + propagator()->account()->davUrl().toString() + _fileToUpload._file + "> (<opaquelocktoken:" + _item->lockToken().toUtf8() + ">)").toUtf8();
     }
 
     qint64 chunkStart = 0;
@@ -140,8 +141,7 @@ void PropagateUploadFileV1::startNextChunk()
     }
 
     const QString fileName = _fileToUpload._path;
-    auto device = std::make_unique<UploadDevice>(
-            fileName, chunkStart, currentChunkSize, &propagator()->_bandwidthManager);
+    auto device = createUploadDevice(chunkStart, currentChunkSize);
     if (!device->open(QIODevice::ReadOnly)) {
         qCWarning(lcPropagateUploadV1) << "Could not prepare upload device: " << device->errorString();
 
@@ -174,6 +174,9 @@ void PropagateUploadFileV1::startNextChunk()
     if (propagator()->account()->capabilities().chunkingParallelUploadDisabled()) {
         // Server may also disable parallel chunked upload for any higher version
         parallelChunkUpload = false;
+    } else if (_streamingEncryptor) {
+        // A new encrypted file is encrypted in order while it is read
+        parallelChunkUpload = false;
     } else {
         QByteArray env = qgetenv("OWNCLOUD_PARALLEL_CHUNK");
         if (!env.isEmpty()) {
@@ -224,8 +227,8 @@ void PropagateUploadFileV1::slotPutFinished()
     if (err != QNetworkReply::NoError) {
         commonErrorHandling(job);
         const auto exceptionParsed = getExceptionFromReply(job->reply());
-        _item->_errorExceptionName = exceptionParsed.first;
-        _item->_errorExceptionMessage = exceptionParsed.second;
+        _item->setErrorExceptionName(exceptionParsed.first);
+        _item->setErrorExceptionMessage(exceptionParsed.second);
         return;
     }
 
@@ -316,6 +319,7 @@ void PropagateUploadFileV1::slotPutFinished()
         pi._errorCount = 0; // successful chunk upload resets
         pi._contentChecksum = _item->_checksumHeader;
         pi._size = _item->_size;
+        addEncryptionToUploadInfo(pi);
         propagator()->_journal->setUploadInfo(_item->_file, pi);
         propagator()->_journal->commit("Upload info");
         startNextChunk();
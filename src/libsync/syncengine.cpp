@@ -32,6 +32,7 @@
 #include "common/vfs.h"
 #include "clientsideencryption.h"
 #include "clientsideencryptionjobs.h"
+#include "encryptedfoldermetadatahandler.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -63,7 +64,7 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcEngine, "nextcloud.sync.engine", QtInfoMsg)
 
-bool SyncEngine::s_anySyncRunning = false;
+int SyncEngine::s_runningSyncs = 0;
 
 /** When the client touches a file, block change notifications for this duration (ms)
  *
@@ -393,7 +394,7 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
                     ? SyncFileItem::LockOwnerType::TokenLock
                     : SyncFileItem::LockOwnerType::UserLock;
                 if (item->_locked == SyncFileItem::LockStatus::LockedItem
-                    && (item->_lockOwnerType != lockOwnerTypeToSkipReadonly || item->_lockOwnerId != account()->davUser())) {
+                    && (item->lockOwnerType() != lockOwnerTypeToSkipReadonly || item->lockOwnerId() != account()->davUser())) {
                     qCDebug(lcEngine()) << filePath << "file is locked: making it read only";
                     FileSystem::setFileReadOnly(filePath, true);
                 } else {
@@ -442,13 +443,13 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
 
             SyncJournalFileLockInfo lockInfo;
             lockInfo._locked = item->_locked == SyncFileItem::LockStatus::LockedItem;
-            lockInfo._lockTime = item->_lockTime;
-            lockInfo._lockTimeout = item->_lockTimeout;
-            lockInfo._lockOwnerId = item->_lockOwnerId;
-            lockInfo._lockOwnerType = static_cast<qint64>(item->_lockOwnerType);
-            lockInfo._lockOwnerDisplayName = item->_lockOwnerDisplayName;
-            lockInfo._lockEditorApp = item->_lockOwnerDisplayName;
-            lockInfo._lockToken = item->_lockToken;
+            lockInfo._lockTime = item->lockTime();
+            lockInfo._lockTimeout = item->lockTimeout();
+            lockInfo._lockOwnerId = item->lockOwnerId();
+            lockInfo._lockOwnerType = static_cast<qint64>(item->lockOwnerType());
+            lockInfo._lockOwnerDisplayName = item->lockOwnerDisplayName();
+            lockInfo._lockEditorApp = item->lockOwnerDisplayName();
+            lockInfo._lockToken = item->lockToken();
 
             if (!_journal->updateLocalMetadata(item->_file, item->_modtime, item->_size, item->_inode, lockInfo)) {
                 qCWarning(lcEngine) << "Could not update local metadata for file" << item->_file;
@@ -530,7 +531,7 @@ void SyncEngine::startSync()
         }
     }
 
-    if (s_anySyncRunning || _syncRunning) {
+    if (_syncRunning) {
         return;
     }
     const auto currentEncryptionStatus = EncryptionStatusEnums::toDbEncryptionStatus(EncryptionStatusEnums::fromEndToEndEncryptionApiVersion(_account->capabilities().clientSideEncryptionVersion()));
@@ -538,8 +539,12 @@ void SyncEngine::startSync()
         _journal->schedulePathForRemoteDiscovery(record.path());
     });
 
-    s_anySyncRunning = true;
+    ++s_runningSyncs;
     _syncRunning = true;
+    qCInfo(lcEngine) << "Syncs running now:" << s_runningSyncs;
+    if (s_runningSyncs == 1) {
+        EncryptedFolderMetadataHandler::setMetadataCacheEnabled(true);
+    }
     _anotherSyncNeeded = NoFollowUpSync;
     _clearTouchedFilesTimer.stop();
 
@@ -662,6 +667,9 @@ void SyncEngine::startSync()
         const auto result = shouldDiscoverLocally(path);
         return result;
     };
+    _discoveryPhase->_hasReportedLocalChanges = [this](const QString &path) {
+        return hasLocalDiscoveryPathsFor(path);
+    };
     _discoveryPhase->setSelectiveSyncBlackList(selectiveSyncBlackList);
     _discoveryPhase->setSelectiveSyncWhiteList(_journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncWhiteList, &ok));
     if (!ok) {
@@ -828,6 +836,8 @@ void SyncEngine::slotDiscoveryFinished()
     } else {
         // Commits a possibly existing (should not though) transaction and starts a new one for the propagate phase
         _journal->commitIfNeededAndStartNewTransaction("Post discovery");
+        // Every propagated item asks for a commit, group them
+        _journal->setGroupCommit(true);
     }
 
     _progressInfo->_currentDiscoveredRemoteFolder.clear();
@@ -939,10 +949,20 @@ void SyncEngine::finalize(bool success)
     qCInfo(lcEngine) << "Sync run took " << _stopWatch.addLapTime(QLatin1String("Sync Finished")) << "ms";
     _stopWatch.stop();
 
+    // Commits whatever the propagation left pending before anyone is told we're done
+    _journal->setGroupCommit(false);
+
     if (_discoveryPhase) {
         _discoveryPhase.release()->deleteLater();
     }
-    s_anySyncRunning = false;
+    // finalize() also runs for syncs that never started, e.g. from slotCleanPollsJobAborted
+    if (_syncRunning) {
+        --s_runningSyncs;
+    }
+    if (s_runningSyncs == 0) {
+        // decrypted E2EE metadata is only reused within a sync run
+        EncryptedFolderMetadataHandler::setMetadataCacheEnabled(false);
+    }
     _syncRunning = false;
     emit finished(success);
 
@@ -1289,13 +1309,17 @@ const SyncEngine::SingleItemDiscoveryOptions &SyncEngine::singleItemDiscoveryOpt
 
 bool SyncEngine::shouldDiscoverLocally(const QString &path) const
 {
-    auto result = false;
-
     if (_localDiscoveryStyle == LocalDiscoveryStyle::FilesystemOnly) {
-        result = true;
-        return result;
+        return true;
     }
 
+    return hasLocalDiscoveryPathsFor(path);
+}
+
+bool SyncEngine::hasLocalDiscoveryPathsFor(const QString &path) const
+{
+    auto result = false;
+
     // The intention is that if "A/X" is in _localDiscoveryPaths:
     // - parent folders like "/", "A" will be discovered (to make sure the discovery reaches the
     //   point where something new happened)
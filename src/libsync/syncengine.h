@@ -116,6 +116,14 @@ public:
      */
     [[nodiscard]] bool shouldDiscoverLocally(const QString &path) const;
 
+    /**
+     * Returns whether the local discovery paths contain the given folder-relative path,
+     * something below it or one of its parents, regardless of the local discovery style.
+     *
+     * These are the paths the folder watcher reported changes for.
+     */
+    [[nodiscard]] bool hasLocalDiscoveryPathsFor(const QString &path) const;
+
     /** Access the last sync run's local discovery style */
     [[nodiscard]] LocalDiscoveryStyle lastLocalDiscoveryStyle() const { return _lastLocalDiscoveryStyle; }
 
@@ -328,7 +336,7 @@ private:
     QSharedPointer<SyncEngine::ScheduledSyncTimer> nearbyScheduledSyncTimer(const qint64 scheduledSyncTimerSecs,
                                                                             const qint64 intervalSecs) const;
 
-    static bool s_anySyncRunning; //true when one sync is running somewhere (for debugging)
+    static int s_runningSyncs; // number of syncs running somewhere, engines of different folders may run at once (for debugging)
 
     // Must only be accessed during update and reconcile
     QVector<SyncFileItemPtr> _syncItems;
@@ -120,15 +120,15 @@ SyncJournalFileRecord SyncFileItem::toSyncJournalFileRecordWithInode(const QStri
     rec._e2eEncryptionStatus = EncryptionStatusEnums::toDbEncryptionStatus(_e2eEncryptionStatus);
     rec._e2eCertificateFingerprint = _e2eCertificateFingerprint;
     rec._lockstate._locked = _locked == LockStatus::LockedItem;
-    rec._lockstate._lockOwnerDisplayName = _lockOwnerDisplayName;
-    rec._lockstate._lockOwnerId = _lockOwnerId;
-    rec._lockstate._lockOwnerType = static_cast<qint64>(_lockOwnerType);
-    rec._lockstate._lockEditorApp = _lockEditorApp;
-    rec._lockstate._lockTime = _lockTime;
-    rec._lockstate._lockTimeout = _lockTimeout;
-    rec._lockstate._lockToken = _lockToken;
+    rec._lockstate._lockOwnerDisplayName = lockOwnerDisplayName();
+    rec._lockstate._lockOwnerId = lockOwnerId();
+    rec._lockstate._lockOwnerType = static_cast<qint64>(lockOwnerType());
+    rec._lockstate._lockEditorApp = lockEditorApp();
+    rec._lockstate._lockTime = lockTime();
+    rec._lockstate._lockTimeout = lockTimeout();
+    rec._lockstate._lockToken = lockToken();
     rec._isLivePhoto = _isLivePhoto;
-    rec._livePhotoFile = _livePhotoFile;
+    rec._livePhotoFile = livePhotoFile();
 
     // Update the inode if possible
     rec._inode = _inode;
@@ -161,18 +161,18 @@ SyncFileItemPtr SyncFileItem::fromSyncJournalFileRecord(const SyncJournalFileRec
     item->_e2eEncryptionServerCapability = item->_e2eEncryptionStatus;
     item->_e2eCertificateFingerprint = rec._e2eCertificateFingerprint;
     item->_locked = rec._lockstate._locked ? LockStatus::LockedItem : LockStatus::UnlockedItem;
-    item->_lockOwnerDisplayName = rec._lockstate._lockOwnerDisplayName;
-    item->_lockOwnerId = rec._lockstate._lockOwnerId;
-    item->_lockOwnerType = static_cast<LockOwnerType>(rec._lockstate._lockOwnerType);
-    item->_lockEditorApp = rec._lockstate._lockEditorApp;
-    item->_lockTime = rec._lockstate._lockTime;
-    item->_lockTimeout = rec._lockstate._lockTimeout;
-    item->_lockToken = rec._lockstate._lockToken;
+    item->setLockOwnerDisplayName(rec._lockstate._lockOwnerDisplayName);
+    item->setLockOwnerId(rec._lockstate._lockOwnerId);
+    item->setLockOwnerType(static_cast<LockOwnerType>(rec._lockstate._lockOwnerType));
+    item->setLockEditorApp(rec._lockstate._lockEditorApp);
+    item->setLockTime(rec._lockstate._lockTime);
+    item->setLockTimeout(rec._lockstate._lockTimeout);
+    item->setLockToken(rec._lockstate._lockToken);
     item->_sharedByMe = rec._sharedByMe;
     item->_isShared = rec._isShared;
     item->_lastShareStateFetchedTimestamp = rec._lastShareStateFetchedTimestamp;
     item->_isLivePhoto = rec._isLivePhoto;
-    item->_livePhotoFile = rec._livePhotoFile;
+    item->setLivePhotoFile(rec._livePhotoFile);
     return item;
 }
 
@@ -205,29 +205,29 @@ SyncFileItemPtr SyncFileItem::fromProperties(const QString &filePath, const QMap
     }
     item->_locked =
         properties.value(QStringLiteral("lock")) == QStringLiteral("1") ? SyncFileItem::LockStatus::LockedItem : SyncFileItem::LockStatus::UnlockedItem;
-    item->_lockOwnerDisplayName = properties.value(QStringLiteral("lock-owner-displayname"));
-    item->_lockOwnerId = properties.value(QStringLiteral("lock-owner"));
-    item->_lockEditorApp = properties.value(QStringLiteral("lock-owner-editor"));
+    item->setLockOwnerDisplayName(properties.value(QStringLiteral("lock-owner-displayname")));
+    item->setLockOwnerId(properties.value(QStringLiteral("lock-owner")));
+    item->setLockEditorApp(properties.value(QStringLiteral("lock-owner-editor")));
 
     {
         auto ok = false;
         const auto intConvertedValue = properties.value(QStringLiteral("lock-owner-type")).toULongLong(&ok);
-        item->_lockOwnerType = ok ? static_cast<SyncFileItem::LockOwnerType>(intConvertedValue) : SyncFileItem::LockOwnerType::UserLock;
+        item->setLockOwnerType(ok ? static_cast<SyncFileItem::LockOwnerType>(intConvertedValue) : SyncFileItem::LockOwnerType::UserLock);
     }
 
     {
         auto ok = false;
         const auto intConvertedValue = properties.value(QStringLiteral("lock-time")).toULongLong(&ok);
-        item->_lockTime = ok ? intConvertedValue : 0;
+        item->setLockTime(ok ? intConvertedValue : 0);
     }
 
     {
         auto ok = false;
         const auto intConvertedValue = properties.value(QStringLiteral("lock-timeout")).toULongLong(&ok);
-        item->_lockTimeout = ok ? intConvertedValue : 0;
+        item->setLockTimeout(ok ? intConvertedValue : 0);
     }
 
-    item->_lockToken = properties.value(QStringLiteral("lock-token"));
+    item->setLockToken(properties.value(QStringLiteral("lock-token")));
 
     const auto date = QDateTime::fromString(properties.value(QStringLiteral("getlastmodified")), Qt::RFC2822Date);
     Q_ASSERT(date.isValid());
@@ -245,7 +245,7 @@ SyncFileItemPtr SyncFileItem::fromProperties(const QString &filePath, const QMap
 
     if (properties.contains(QStringLiteral("metadata-files-live-photo"))) {
         item->_isLivePhoto = true;
-        item->_livePhotoFile = properties.value(QStringLiteral("metadata-files-live-photo"));
+        item->setLivePhotoFile(properties.value(QStringLiteral("metadata-files-live-photo")));
     }
 
     // direction and instruction are decided later
@@ -258,13 +258,13 @@ SyncFileItemPtr SyncFileItem::fromProperties(const QString &filePath, const QMap
 void SyncFileItem::updateLockStateFromDbRecord(const SyncJournalFileRecord &dbRecord)
 {
     _locked = dbRecord._lockstate._locked ? LockStatus::LockedItem : LockStatus::UnlockedItem;
-    _lockOwnerId = dbRecord._lockstate._lockOwnerId;
-    _lockOwnerDisplayName = dbRecord._lockstate._lockOwnerDisplayName;
-    _lockOwnerType = static_cast<LockOwnerType>(dbRecord._lockstate._lockOwnerType);
-    _lockEditorApp = dbRecord._lockstate._lockEditorApp;
-    _lockTime = dbRecord._lockstate._lockTime;
-    _lockTimeout = dbRecord._lockstate._lockTimeout;
-    _lockToken = dbRecord._lockstate._lockToken;
+    setLockOwnerId(dbRecord._lockstate._lockOwnerId);
+    setLockOwnerDisplayName(dbRecord._lockstate._lockOwnerDisplayName);
+    setLockOwnerType(static_cast<LockOwnerType>(dbRecord._lockstate._lockOwnerType));
+    setLockEditorApp(dbRecord._lockstate._lockEditorApp);
+    setLockTime(dbRecord._lockstate._lockTime);
+    setLockTimeout(dbRecord._lockstate._lockTimeout);
+    setLockToken(dbRecord._lockstate._lockToken);
 }
 
 }
@@ -19,6 +19,7 @@
 #include <QString>
 #include <QDateTime>
 #include <QMetaType>
+#include <QSharedData>
 #include <QSharedPointer>
 
 #include <csync.h>
@@ -238,6 +239,73 @@ public:
 
     void updateLockStateFromDbRecord(const SyncJournalFileRecord &dbRecord);
 
+    /** Fields that are only set for a few items of a sync run
+     *
+     * They live in a side struct that is allocated when the first of them gets a
+     * non-default value and released when all of them are back to their defaults,
+     * which keeps the items of large sync plans small.
+     */
+    struct Extras : public QSharedData
+    {
+        QString _errorExceptionName;
+        QString _errorExceptionMessage;
+        QString _directDownloadUrl;
+        QString _directDownloadCookies;
+        QString _lockOwnerId;
+        QString _lockOwnerDisplayName;
+        LockOwnerType _lockOwnerType = LockOwnerType::UserLock;
+        QString _lockEditorApp;
+        qint64 _lockTime = 0;
+        qint64 _lockTimeout = 0;
+        QString _lockToken;
+        QString _livePhotoFile;
+        QString _discoveryResult;
+
+        [[nodiscard]] bool isDefault() const
+        {
+            return _errorExceptionName.isEmpty() && _errorExceptionMessage.isEmpty() && _directDownloadUrl.isEmpty() && _directDownloadCookies.isEmpty()
+                && _lockOwnerId.isEmpty() && _lockOwnerDisplayName.isEmpty() && _lockOwnerType == LockOwnerType::UserLock && _lockEditorApp.isEmpty()
+                && _lockTime == 0 && _lockTimeout == 0 && _lockToken.isEmpty() && _livePhotoFile.isEmpty() && _discoveryResult.isEmpty();
+        }
+    };
+
+    /// Whether the side struct of the rarely set fields is allocated
+    [[nodiscard]] bool hasExtras() const { return _extras.constData() != nullptr; }
+
+    /// Contains a server exception string only in case of error
+    [[nodiscard]] QString errorExceptionName() const { return _extras ? _extras->_errorExceptionName : QString(); }
+    void setErrorExceptionName(const QString &name) { setExtra(&Extras::_errorExceptionName, name); }
+    /// Contains a server exception message string only in case of error
+    [[nodiscard]] QString errorExceptionMessage() const { return _extras ? _extras->_errorExceptionMessage : QString(); }
+    void setErrorExceptionMessage(const QString &message) { setExtra(&Extras::_errorExceptionMessage, message); }
+
+    [[nodiscard]] QString directDownloadUrl() const { return _extras ? _extras->_directDownloadUrl : QString(); }
+    void setDirectDownloadUrl(const QString &url) { setExtra(&Extras::_directDownloadUrl, url); }
+    [[nodiscard]] QString directDownloadCookies() const { return _extras ? _extras->_directDownloadCookies : QString(); }
+    void setDirectDownloadCookies(const QString &cookies) { setExtra(&Extras::_directDownloadCookies, cookies); }
+
+    [[nodiscard]] QString lockOwnerId() const { return _extras ? _extras->_lockOwnerId : QString(); }
+    void setLockOwnerId(const QString &id) { setExtra(&Extras::_lockOwnerId, id); }
+    [[nodiscard]] QString lockOwnerDisplayName() const { return _extras ? _extras->_lockOwnerDisplayName : QString(); }
+    void setLockOwnerDisplayName(const QString &name) { setExtra(&Extras::_lockOwnerDisplayName, name); }
+    [[nodiscard]] LockOwnerType lockOwnerType() const { return _extras ? _extras->_lockOwnerType : LockOwnerType::UserLock; }
+    void setLockOwnerType(LockOwnerType type) { setExtra(&Extras::_lockOwnerType, type); }
+    [[nodiscard]] QString lockEditorApp() const { return _extras ? _extras->_lockEditorApp : QString(); }
+    void setLockEditorApp(const QString &app) { setExtra(&Extras::_lockEditorApp, app); }
+    [[nodiscard]] qint64 lockTime() const { return _extras ? _extras->_lockTime : 0; }
+    void setLockTime(qint64 time) { setExtra(&Extras::_lockTime, time); }
+    [[nodiscard]] qint64 lockTimeout() const { return _extras ? _extras->_lockTimeout : 0; }
+    void setLockTimeout(qint64 timeout) { setExtra(&Extras::_lockTimeout, timeout); }
+    [[nodiscard]] QString lockToken() const { return _extras ? _extras->_lockToken : QString(); }
+    void setLockToken(const QString &token) { setExtra(&Extras::_lockToken, token); }
+
+    [[nodiscard]] QString livePhotoFile() const { return _extras ? _extras->_livePhotoFile : QString(); }
+    void setLivePhotoFile(const QString &file) { setExtra(&Extras::_livePhotoFile, file); }
+
+    /// How discovery came to its decision, kept for logging removals
+    [[nodiscard]] QString discoveryResult() const { return _extras ? _extras->_discoveryResult : QString(); }
+    void setDiscoveryResult(const QString &result) { setExtra(&Extras::_discoveryResult, result); }
+
     // Variables useful for everybody
 
     /** The syncfolder-relative filesystem path that the operation is about
@@ -290,8 +358,6 @@ public:
     quint16 _httpErrorCode = 0;
     RemotePermissions _remotePerm;
     QString _errorString; // Contains a string only in case of error
-    QString _errorExceptionName; // Contains a server exception string only in case of error
-    QString _errorExceptionMessage; // Contains a server exception message string only in case of error
     QByteArray _responseTimeStamp;
     QByteArray _requestId; // X-Request-Id of the failed request
     quint32 _affectedItems = 1; // the number of affected items by the operation on this item.
@@ -317,17 +383,7 @@ public:
     qint64 _previousSize = 0;
     time_t _previousModtime = 0;
 
-    QString _directDownloadUrl;
-    QString _directDownloadCookies;
-
     LockStatus _locked = LockStatus::UnlockedItem;
-    QString _lockOwnerId;
-    QString _lockOwnerDisplayName;
-    LockOwnerType _lockOwnerType = LockOwnerType::UserLock;
-    QString _lockEditorApp;
-    qint64 _lockTime = 0;
-    qint64 _lockTimeout = 0;
-    QString _lockToken;
 
     bool _isShared = false;
     time_t _lastShareStateFetchedTimestamp = 0;
@@ -342,15 +398,30 @@ public:
     bool _isAnyCaseClashChild = false;
 
     bool _isLivePhoto = false;
-    QString _livePhotoFile;
 
     bool isPermissionsInvalid = false;
 
-    QString _discoveryResult;
-
     /// if true, requests the file to be permanently deleted instead of moved to the trashbin
     /// only relevant for when `_instruction` is set to `CSYNC_INSTRUCTION_REMOVE`
     bool _wantsPermanentDeletion = false;
+
+private:
+    template <typename T>
+    void setExtra(T Extras::*field, const T &value)
+    {
+        if (!_extras) {
+            if (value == T{}) {
+                return;
+            }
+            _extras = new Extras;
+        }
+        _extras.data()->*field = value;
+        if (value == T{} && std::as_const(_extras)->isDefault()) {
+            _extras.reset();
+        }
+    }
+
+    QSharedDataPointer<Extras> _extras;
 };
 
 inline bool operator<(const SyncFileItemPtr &item1, const SyncFileItemPtr &item2)
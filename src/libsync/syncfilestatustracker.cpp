@@ -21,6 +21,9 @@
 #include "csync_exclude.h"
 
 #include <QLoggingCategory>
+#include <QStringTokenizer>
+
+#include <algorithm>
 
 namespace OCC {
 
@@ -38,15 +41,14 @@ static int pathCompare( const QString& lhs, const QString& rhs )
         );
 }
 
-static bool pathStartsWith( const QString& lhs, const QString& rhs )
+static QString pathKey(QStringView component)
 {
-    return lhs.startsWith(rhs,
+    // Should match pathCompare()
 #if defined(Q_OS_WIN) || defined(Q_OS_MAC)
-        Qt::CaseInsensitive
+    return component.toString().toCaseFolded();
 #else
-        Qt::CaseSensitive
+    return component.toString();
 #endif
-        );
 }
 
 bool SyncFileStatusTracker::PathComparator::operator()( const QString& lhs, const QString& rhs ) const
@@ -55,30 +57,167 @@ bool SyncFileStatusTracker::PathComparator::operator()( const QString& lhs, cons
     return pathCompare(lhs, rhs) < 0;
 }
 
-SyncFileStatus::SyncFileStatusTag SyncFileStatusTracker::lookupProblem(const QString &pathToMatch, const SyncFileStatusTracker::ProblemsMap &problemMap)
-{
-    auto lower = problemMap.lower_bound(pathToMatch);
-    for (auto it = lower; it != problemMap.cend(); ++it) {
-        const QString &problemPath = it->first;
-        SyncFileStatus::SyncFileStatusTag severity = it->second;
-
-        if (pathCompare(problemPath, pathToMatch) == 0) {
-            return severity;
-        } else if (severity == SyncFileStatus::StatusError
-            && pathStartsWith(problemPath, pathToMatch)
-            && (pathToMatch.isEmpty() || problemPath.at(pathToMatch.size()) == '/')) {
-            return SyncFileStatus::StatusWarning;
-        } else if (!pathStartsWith(problemPath, pathToMatch)) {
-            // Starting at lower_bound we get the first path that is not smaller,
-            // since: "a/" < "a/aa" < "a/aa/aaa" < "a/ab/aba"
-            // If problemMap keys are ["a/aa/aaa", "a/ab/aba"] and pathToMatch == "a/aa",
-            // lower_bound(pathToMatch) will point to "a/aa/aaa", and the moment that
-            // problemPath.startsWith(pathToMatch) == false, we know that we've looked
-            // at everything that interest us.
-            break;
+const SyncFileStatusTracker::PathTree::Node *SyncFileStatusTracker::PathTree::find(const QString &path) const
+{
+    const Node *node = &_root;
+    for (const auto component : qTokenize(path, u'/', Qt::SkipEmptyParts)) {
+        const auto it = node->_children.find(pathKey(component));
+        if (it == node->_children.end()) {
+            return nullptr;
+        }
+        node = it->second.get();
+    }
+    return node;
+}
+
+QVector<SyncFileStatusTracker::PathTree::Node *> SyncFileStatusTracker::PathTree::findOrCreate(const QString &path)
+{
+    QVector<Node *> nodes{&_root};
+    for (const auto component : qTokenize(path, u'/', Qt::SkipEmptyParts)) {
+        auto &child = nodes.last()->_children[pathKey(component)];
+        if (!child) {
+            child = std::make_unique<Node>();
+            child->_name = component.toString();
+        }
+        nodes.append(child.get());
+    }
+    return nodes;
+}
+
+void SyncFileStatusTracker::PathTree::prune(const QVector<Node *> &nodes)
+{
+    // Drop the nodes that don't hold anything anymore, from the leaf up
+    for (auto i = nodes.size() - 1; i > 0; --i) {
+        const auto node = nodes.at(i);
+        if (node->_problem != SyncFileStatus::StatusNone || node->_errorsBelow || node->_syncCount || !node->_children.empty()) {
+            return;
+        }
+        nodes.at(i - 1)->_children.erase(pathKey(node->_name));
+    }
+}
+
+template <typename Visitor>
+void SyncFileStatusTracker::PathTree::visit(const Node &node, const QString &path, Visitor &&visitor)
+{
+    visitor(node, path);
+    for (const auto &[key, child] : node._children) {
+        visit(*child, path.isEmpty() ? child->_name : path + QLatin1Char('/') + child->_name, visitor);
+    }
+}
+
+void SyncFileStatusTracker::PathTree::clear(Node &node, bool problems)
+{
+    if (problems) {
+        node._problem = SyncFileStatus::StatusNone;
+        node._errorsBelow = 0;
+    } else {
+        node._syncCount = 0;
+    }
+    for (auto it = node._children.begin(); it != node._children.end();) {
+        auto &child = *it->second;
+        clear(child, problems);
+        if (child._problem == SyncFileStatus::StatusNone && !child._errorsBelow && !child._syncCount && child._children.empty()) {
+            it = node._children.erase(it);
+        } else {
+            ++it;
         }
     }
-    return SyncFileStatus::StatusNone;
+}
+
+SyncFileStatus::SyncFileStatusTag SyncFileStatusTracker::PathTree::problem(const QString &path) const
+{
+    const auto node = find(path);
+    return node ? node->_problem : SyncFileStatus::StatusNone;
+}
+
+SyncFileStatus::SyncFileStatusTag SyncFileStatusTracker::PathTree::lookupProblem(const QString &path) const
+{
+    const auto node = find(path);
+    if (!node) {
+        return SyncFileStatus::StatusNone;
+    }
+    if (node->_problem != SyncFileStatus::StatusNone) {
+        return node->_problem;
+    }
+    return node->_errorsBelow > 0 ? SyncFileStatus::StatusWarning : SyncFileStatus::StatusNone;
+}
+
+void SyncFileStatusTracker::PathTree::setProblem(const QString &path, SyncFileStatus::SyncFileStatusTag problem)
+{
+    if (problem == SyncFileStatus::StatusNone && !find(path)) {
+        return;
+    }
+
+    const auto nodes = findOrCreate(path);
+    const auto node = nodes.last();
+    const auto wasError = node->_problem == SyncFileStatus::StatusError;
+    const auto isError = problem == SyncFileStatus::StatusError;
+    if (wasError != isError) {
+        for (auto i = 0; i < nodes.size() - 1; ++i) {
+            nodes.at(i)->_errorsBelow += isError ? 1 : -1;
+        }
+    }
+    node->_problem = problem;
+    prune(nodes);
+}
+
+QVector<QPair<QString, SyncFileStatus::SyncFileStatusTag>> SyncFileStatusTracker::PathTree::problems() const
+{
+    QVector<QPair<QString, SyncFileStatus::SyncFileStatusTag>> result;
+    visit(_root, QString(), [&result](const Node &node, const QString &path) {
+        if (node._problem != SyncFileStatus::StatusNone) {
+            result.append({path, node._problem});
+        }
+    });
+    return result;
+}
+
+void SyncFileStatusTracker::PathTree::clearProblems()
+{
+    clear(_root, true);
+}
+
+int SyncFileStatusTracker::PathTree::syncCount(const QString &path) const
+{
+    const auto node = find(path);
+    return node ? node->_syncCount : 0;
+}
+
+int SyncFileStatusTracker::PathTree::incSyncCount(const QString &path)
+{
+    const auto nodes = findOrCreate(path);
+    const auto node = nodes.last();
+    const auto count = node->_syncCount++;
+    _syncingNodes += int(node->_syncCount != 0) - int(count != 0);
+    prune(nodes);
+    return count;
+}
+
+int SyncFileStatusTracker::PathTree::decSyncCount(const QString &path)
+{
+    const auto nodes = findOrCreate(path);
+    const auto node = nodes.last();
+    const auto count = --node->_syncCount;
+    _syncingNodes += int(count != 0) - int(count + 1 != 0);
+    prune(nodes);
+    return count;
+}
+
+QStringList SyncFileStatusTracker::PathTree::syncingPaths() const
+{
+    QStringList result;
+    visit(_root, QString(), [&result](const Node &node, const QString &path) {
+        if (node._syncCount != 0) {
+            result.append(path);
+        }
+    });
+    return result;
+}
+
+void SyncFileStatusTracker::PathTree::clearSyncCounts()
+{
+    clear(_root, false);
+    _syncingNodes = 0;
 }
 
 /**
@@ -171,7 +310,7 @@ void SyncFileStatusTracker::slotPathTouched(const QString &fileName)
 
 void SyncFileStatusTracker::slotAddSilentlyExcluded(const QString &folderPath)
 {
-    _syncProblems[folderPath] = SyncFileStatus::StatusExcluded;
+    _pathTree.setProblem(folderPath, SyncFileStatus::StatusExcluded);
     _syncSilentExcludes[folderPath] = SyncFileStatus::StatusExcluded;
     emit fileStatusChanged(getSystemDestination(folderPath), resolveSyncAndErrorStatus(folderPath, NotShared));
 }
@@ -188,7 +327,7 @@ void SyncFileStatusTracker::slotCheckAndRemoveSilentlyExcluded(const QString &fo
 void SyncFileStatusTracker::incSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedFlag)
 {
     // Will return 0 (and increase to 1) if the path wasn't in the map yet
-    int count = _syncCount[relativePath]++;
+    int count = _pathTree.incSyncCount(relativePath);
     if (!count) {
         SyncFileStatus status = sharedFlag == UnknownShared
             ? fileStatus(relativePath)
@@ -208,11 +347,8 @@ void SyncFileStatusTracker::incSyncCountAndEmitStatusChanged(const QString &rela
 
 void SyncFileStatusTracker::decSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedFlag)
 {
-    int count = --_syncCount[relativePath];
+    int count = _pathTree.decSyncCount(relativePath);
     if (!count) {
-        // Remove from the map, same as 0
-        _syncCount.remove(relativePath);
-
         SyncFileStatus status = sharedFlag == UnknownShared
             ? fileStatus(relativePath)
             : resolveSyncAndErrorStatus(relativePath, sharedFlag);
@@ -230,27 +366,28 @@ void SyncFileStatusTracker::decSyncCountAndEmitStatusChanged(const QString &rela
 
 void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
 {
-    ASSERT(_syncCount.isEmpty());
+    ASSERT(!_pathTree.hasSyncCounts());
 
-    ProblemsMap oldProblems;
-    std::swap(_syncProblems, oldProblems);
+    const auto oldProblems = _pathTree.problems();
+    _pathTree.clearProblems();
+    _collectInvalidatedParentPaths = true;
 
     for (const auto &item : std::as_const(items)) {
         qCInfo(lcStatusTracker) << "Investigating" << item->destination() << item->_status << item->_instruction << item->_direction;
         _dirtyPaths.remove(item->destination());
 
         if (hasErrorStatus(*item)) {
-            _syncProblems[item->destination()] = SyncFileStatus::StatusError;
+            _pathTree.setProblem(item->destination(), SyncFileStatus::StatusError);
             _syncSilentExcludes.erase(item->destination());
             invalidateParentPaths(item->destination());
         } else if (hasExcludedStatus(*item)) {
-            _syncProblems[item->destination()] = SyncFileStatus::StatusExcluded;
+            _pathTree.setProblem(item->destination(), SyncFileStatus::StatusExcluded);
             _syncSilentExcludes.erase(item->destination());
         }
 
         SharedFlag sharedFlag = item->_remotePerm.hasPermission(RemotePermissions::IsShared) ? Shared : NotShared;
         if (item->_instruction != CSyncEnums::CSYNC_INSTRUCTION_REMOVE) {
-            item->_discoveryResult.clear();
+            item->setDiscoveryResult({});
         }
         if (item->_instruction != CSYNC_INSTRUCTION_NONE
             && item->_instruction != CSYNC_INSTRUCTION_UPDATE_METADATA
@@ -273,15 +410,16 @@ void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
 
     // Make sure to push any status that might have been resolved indirectly since the last sync
     // (like an error file being deleted from disk)
-    for (const auto &syncProblem : _syncProblems)
-        oldProblems.erase(syncProblem.first);
-    for (const auto &oldProblem : oldProblems) {
-        const QString &path = oldProblem.first;
-        SyncFileStatus::SyncFileStatusTag severity = oldProblem.second;
+    for (const auto &[path, severity] : oldProblems) {
+        if (_pathTree.problem(path) != SyncFileStatus::StatusNone)
+            continue;
         if (severity == SyncFileStatus::StatusError)
             invalidateParentPaths(path);
         emit fileStatusChanged(getSystemDestination(path), fileStatus(path));
     }
+
+    _collectInvalidatedParentPaths = false;
+    emitInvalidatedParentPaths();
 }
 
 void SyncFileStatusTracker::slotItemCompleted(const SyncFileItemPtr &item)
@@ -289,12 +427,12 @@ void SyncFileStatusTracker::slotItemCompleted(const SyncFileItemPtr &item)
     qCDebug(lcStatusTracker) << "Item completed" << item->destination() << item->_status << item->_instruction;
 
     if (hasErrorStatus(*item)) {
-        _syncProblems[item->destination()] = SyncFileStatus::StatusError;
+        _pathTree.setProblem(item->destination(), SyncFileStatus::StatusError);
         invalidateParentPaths(item->destination());
     } else if (hasExcludedStatus(*item)) {
-        _syncProblems[item->destination()] = SyncFileStatus::StatusExcluded;
+        _pathTree.setProblem(item->destination(), SyncFileStatus::StatusExcluded);
     } else {
-        _syncProblems.erase(item->destination());
+        _pathTree.setProblem(item->destination(), SyncFileStatus::StatusNone);
     }
     _syncSilentExcludes.erase(item->destination());
 
@@ -313,15 +451,10 @@ void SyncFileStatusTracker::slotItemCompleted(const SyncFileItemPtr &item)
 void SyncFileStatusTracker::slotSyncFinished()
 {
     // Clear the sync counts to reduce the impact of unsymetrical inc/dec calls (e.g. when directory job abort)
-    QHash<QString, int> oldSyncCount;
-    std::swap(_syncCount, oldSyncCount);
-    for (auto it = oldSyncCount.begin(); it != oldSyncCount.end(); ++it) {
-        // Don't announce folders, fileStatus expect only paths without '/', otherwise it asserts
-        if (it.key().endsWith('/')) {
-            continue;
-        }
-
-        emit fileStatusChanged(getSystemDestination(it.key()), fileStatus(it.key()));
+    const auto syncingPaths = _pathTree.syncingPaths();
+    _pathTree.clearSyncCounts();
+    for (const auto &path : syncingPaths) {
+        emit fileStatusChanged(getSystemDestination(path), fileStatus(path));
     }
 }
 
@@ -335,12 +468,12 @@ SyncFileStatus SyncFileStatusTracker::resolveSyncAndErrorStatus(const QString &r
     // If it's a new file and that we're not syncing it yet,
     // don't show any icon and wait for the filesystem watcher to trigger a sync.
     SyncFileStatus status(isPathKnown ? SyncFileStatus::StatusUpToDate : SyncFileStatus::StatusNone);
-    if (_syncCount.value(relativePath)) {
+    if (_pathTree.syncCount(relativePath)) {
         status.set(SyncFileStatus::StatusSync);
     } else {
         // After a sync finished, we need to show the users issues from that last sync like the activity list does.
         // Also used for parent directories showing a warning for an error child.
-        SyncFileStatus::SyncFileStatusTag problemStatus = lookupProblem(relativePath, _syncProblems);
+        SyncFileStatus::SyncFileStatusTag problemStatus = _pathTree.lookupProblem(relativePath);
         if (problemStatus != SyncFileStatus::StatusNone)
             status.set(problemStatus);
     }
@@ -355,9 +488,30 @@ SyncFileStatus SyncFileStatusTracker::resolveSyncAndErrorStatus(const QString &r
 
 void SyncFileStatusTracker::invalidateParentPaths(const QString &path)
 {
-    QStringList splitPath = path.split('/', Qt::SkipEmptyParts);
-    for (int i = 0; i < splitPath.size(); ++i) {
-        QString parentPath = QStringList(splitPath.mid(0, i)).join(QLatin1String("/"));
+    if (path.isEmpty()) {
+        return;
+    }
+    for (auto slash = path.lastIndexOf(QLatin1Char('/')); slash > 0; slash = path.lastIndexOf(QLatin1Char('/'), slash - 1)) {
+        _invalidatedParentPaths.insert(path.left(slash));
+    }
+    _invalidatedParentPaths.insert(QString());
+
+    if (!_collectInvalidatedParentPaths) {
+        emitInvalidatedParentPaths();
+    }
+}
+
+void SyncFileStatusTracker::emitInvalidatedParentPaths()
+{
+    auto parentPaths = _invalidatedParentPaths.values();
+    _invalidatedParentPaths.clear();
+
+    // Push the deepest directories first, a parent may depend on the status of its children
+    const auto depth = [](const QString &path) { return path.isEmpty() ? 0 : path.count(QLatin1Char('/')) + 1; };
+    std::sort(parentPaths.begin(), parentPaths.end(), [&depth](const QString &lhs, const QString &rhs) {
+        return depth(lhs) > depth(rhs);
+    });
+    for (const auto &parentPath : std::as_const(parentPaths)) {
         emit fileStatusChanged(getSystemDestination(parentPath), fileStatus(parentPath));
     }
 }
@@ -20,6 +20,8 @@
 #include "syncfileitem.h"
 #include "common/syncfilestatus.h"
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <QSet>
 
 namespace OCC {
@@ -58,7 +60,53 @@ private:
         bool operator()( const QString& lhs, const QString& rhs ) const;
     };
     using ProblemsMap = std::map<QString, SyncFileStatus::SyncFileStatusTag, PathComparator>;
-    SyncFileStatus::SyncFileStatusTag lookupProblem(const QString &pathToMatch, const ProblemsMap &problemMap);
+
+    /** Problems and sync counts of the tracked paths, one node per path component
+     *
+     * Every node also counts the errors below it, so the state of a path and the
+     * warning of its parent directories are found by walking the path once.
+     */
+    class PathTree
+    {
+    public:
+        /// The problem recorded for exactly this path
+        [[nodiscard]] SyncFileStatus::SyncFileStatusTag problem(const QString &path) const;
+        /// The problem of this path, or a warning if there is an error below it
+        [[nodiscard]] SyncFileStatus::SyncFileStatusTag lookupProblem(const QString &path) const;
+        /// StatusNone removes the problem
+        void setProblem(const QString &path, SyncFileStatus::SyncFileStatusTag problem);
+        [[nodiscard]] QVector<QPair<QString, SyncFileStatus::SyncFileStatusTag>> problems() const;
+        void clearProblems();
+
+        [[nodiscard]] int syncCount(const QString &path) const;
+        /// Returns the count before the change
+        int incSyncCount(const QString &path);
+        /// Returns the count after the change
+        int decSyncCount(const QString &path);
+        [[nodiscard]] QStringList syncingPaths() const;
+        [[nodiscard]] bool hasSyncCounts() const { return _syncingNodes > 0; }
+        void clearSyncCounts();
+
+    private:
+        struct Node {
+            QString _name; // the path component as first seen
+            SyncFileStatus::SyncFileStatusTag _problem = SyncFileStatus::StatusNone;
+            int _errorsBelow = 0;
+            int _syncCount = 0;
+            std::unordered_map<QString, std::unique_ptr<Node>> _children;
+        };
+
+        [[nodiscard]] const Node *find(const QString &path) const;
+        /// Returns the nodes from the root down to the path, creating the missing ones
+        QVector<Node *> findOrCreate(const QString &path);
+        static void prune(const QVector<Node *> &nodes);
+        template <typename Visitor>
+        static void visit(const Node &node, const QString &path, Visitor &&visitor);
+        static void clear(Node &node, bool problems);
+
+        Node _root;
+        int _syncingNodes = 0;
+    };
 
     enum SharedFlag { UnknownShared,
         NotShared,
@@ -68,19 +116,25 @@ private:
     SyncFileStatus resolveSyncAndErrorStatus(const QString &relativePath, SharedFlag sharedState, PathKnownFlag isPathKnown = PathKnown);
 
     void invalidateParentPaths(const QString &path);
+    void emitInvalidatedParentPaths();
     QString getSystemDestination(const QString &relativePath);
     void incSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedState);
     void decSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedState);
 
     SyncEngine *_syncEngine;
 
-    ProblemsMap _syncProblems;
-    ProblemsMap _syncSilentExcludes;
-    QSet<QString> _dirtyPaths;
-    // Counts the number direct children currently being synced (has unfinished propagation jobs).
+    // Problems of the last sync run and, per path, the number of direct children
+    // currently being synced (has unfinished propagation jobs).
     // We'll show a file/directory as SYNC as long as its sync count is > 0.
     // A directory that starts/ends propagation will in turn increase/decrease its own parent by 1.
-    QHash<QString, int> _syncCount;
+    PathTree _pathTree;
+    ProblemsMap _syncSilentExcludes;
+    QSet<QString> _dirtyPaths;
+
+    // Parents whose status needs to be pushed again; bursts of changes below the
+    // same directory only push it once
+    QSet<QString> _invalidatedParentPaths;
+    bool _collectInvalidatedParentPaths = false;
 };
 }
 
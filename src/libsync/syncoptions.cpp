@@ -68,6 +68,22 @@ void SyncOptions::fillFromEnvironmentVariables()
     int maxParallel = qgetenv("OWNCLOUD_MAX_PARALLEL").toInt();
     if (maxParallel > 0)
         _parallelNetworkJobs = maxParallel;
+
+    int maxParallelLocalDiscovery = qgetenv("OWNCLOUD_MAX_PARALLEL_LOCAL_DISCOVERY").toInt();
+    if (maxParallelLocalDiscovery > 0)
+        _parallelLocalDiscoveryJobs = maxParallelLocalDiscovery;
+
+    int maxParallelChunkUploads = qgetenv("OWNCLOUD_MAX_PARALLEL_CHUNK_UPLOADS").toInt();
+    if (maxParallelChunkUploads > 0)
+        _parallelChunkUploads = maxParallelChunkUploads;
+
+    int downloadSegments = qgetenv("OWNCLOUD_DOWNLOAD_SEGMENTS").toInt();
+    if (downloadSegments > 0)
+        _downloadSegments = downloadSegments;
+
+    QByteArray minSegmentedDownloadSizeEnv = qgetenv("OWNCLOUD_MIN_SEGMENTED_DOWNLOAD_SIZE");
+    if (!minSegmentedDownloadSizeEnv.isEmpty())
+        _minSegmentedDownloadSize = minSegmentedDownloadSizeEnv.toLongLong();
 }
 
 void SyncOptions::verifyChunkSizes()
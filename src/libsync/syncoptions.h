@@ -66,6 +66,26 @@ public:
     /** The maximum number of active jobs in parallel  */
     int _parallelNetworkJobs = 6;
 
+    /** The maximum number of local directories listed in parallel during discovery
+     *
+     * Independent of _parallelNetworkJobs: subdirectory listings are prefetched
+     * ahead of the discovery recursion.
+     */
+    int _parallelLocalDiscoveryJobs = 8;
+
+    /** The maximum number of chunks of one file that chunking NG uploads in parallel
+     *
+     * Capped by the server's max_parallel_count; servers that don't advertise it
+     * get one chunk at a time.
+     */
+    int _parallelChunkUploads = 4;
+
+    /** The number of ranged GETs that download a large file in parallel, 1 disables segmented downloads */
+    int _downloadSegments = 4;
+
+    /** Files of at least this size (in bytes) get downloaded in segments */
+    qint64 _minSegmentedDownloadSize = 1024LL * 1024LL * 1024LL; // 1GiB
+
     static constexpr auto chunkV2MinChunkSize = 5LL * 1000LL * 1000LL; // 5 MB
     static constexpr auto chunkV2MaxChunkSize = 5LL * 1000LL * 1000LL * 1000LL; // 5 GB
 
@@ -80,7 +100,8 @@ public:
     /** Reads settings from env vars where available.
      *
      * Currently reads _initialChunkSize, _minChunkSize, _maxChunkSize,
-     * _targetChunkUploadDuration, _parallelNetworkJobs.
+     * _targetChunkUploadDuration, _parallelNetworkJobs, _parallelLocalDiscoveryJobs,
+     * _parallelChunkUploads, _downloadSegments, _minSegmentedDownloadSize.
      */
     void fillFromEnvironmentVariables();
 
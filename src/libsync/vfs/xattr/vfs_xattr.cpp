@@ -16,6 +16,7 @@
 
 #include "syncfileitem.h"
 #include "filesystem.h"
+#include "configfile.h"
 #include "common/syncjournaldb.h"
 #include "xattrwrapper.h"
 
@@ -49,6 +50,8 @@ QString VfsXAttr::fileSuffix() const
 
 void VfsXAttr::startImpl(const VfsSetupParams &)
 {
+    _sparsePlaceholders = ConfigFile().xattrVfsSparsePlaceholders();
+    qCInfo(lcVfsXAttr) << "Sparse placeholders" << (_sparsePlaceholders ? "enabled" : "disabled");
 }
 
 void VfsXAttr::stop()
@@ -69,12 +72,19 @@ bool VfsXAttr::isHydrating() const
     return false;
 }
 
-Result<void, QString> VfsXAttr::updateMetadata(const QString &filePath, time_t modtime, qint64, const QByteArray &)
+Result<void, QString> VfsXAttr::updateMetadata(const QString &filePath, time_t modtime, qint64 size, const QByteArray &)
 {
     if (modtime <= 0) {
         return {tr("Error updating metadata due to invalid modification time")};
     }
 
+    if (_sparsePlaceholders && xattr::hasNextcloudPlaceholderAttributes(filePath)) {
+        // keep reporting the size of the remote file
+        if (!QFile::resize(filePath, size)) {
+            return {tr("Error updating the size of the placeholder")};
+        }
+    }
+
     qCDebug(lcVfsXAttr()) << "setModTime" << filePath << modtime;
     FileSystem::setModTime(filePath, modtime);
     return {};
@@ -88,11 +98,18 @@ Result<void, QString> VfsXAttr::createPlaceholder(const SyncFileItem &item)
 
     const auto path = QString(_setupParams.filesystemPath + item._file);
     QFile file(path);
+    // sparse placeholders have the real size, they may be replaced like any other placeholder
     if (file.exists() && file.size() > 1
+        && !xattr::hasNextcloudPlaceholderAttributes(path)
         && !FileSystem::verifyFileUnchanged(path, item._size, item._modtime)) {
         return QStringLiteral("Cannot create a placeholder because a file with the placeholder name already exist");
     }
 
+    if (_sparsePlaceholders) {
+        qCDebug(lcVfsXAttr()) << "createSparsePlaceholder" << path << item._size << item._modtime;
+        return xattr::createSparsePlaceholder(path, item._size, item._modtime);
+    }
+
     if (!file.open(QFile::ReadWrite | QFile::Truncate)) {
         return file.errorString();
     }
@@ -151,19 +168,27 @@ bool VfsXAttr::statTypeVirtualFile(csync_file_stat_t *stat, void *statData)
         return false;
     }
 
-    const auto parentPath = static_cast<QByteArray *>(statData);
-    Q_ASSERT(!parentPath->endsWith('/'));
+    const auto directory = static_cast<LocalDirectoryStatData *>(statData);
+    Q_ASSERT(!directory->path.endsWith('/'));
     Q_ASSERT(!stat->path.startsWith('/'));
 
-    const auto path = QByteArray(*parentPath + '/' + stat->path);
-    const auto pin = [=, this] {
-        const auto absolutePath = QString::fromUtf8(path);
-        Q_ASSERT(absolutePath.startsWith(params().filesystemPath.toUtf8()));
+    if (!directory->pinStatesLoaded) {
+        // one lookup per listed directory instead of one per entry
+        directory->pinStatesLoaded = true;
+        const auto absolutePath = QString::fromUtf8(directory->path);
+        Q_ASSERT(absolutePath.startsWith(params().filesystemPath.chopped(1)));
         const auto folderPath = absolutePath.mid(params().filesystemPath.length());
-        return pinState(folderPath);
-    }();
+        if (const auto childPinStates = childPinStatesInDb(folderPath)) {
+            directory->pinState = pinState(folderPath);
+            directory->childPinStates = *childPinStates;
+        }
+    }
+    const auto pin = directory->pinState
+        ? Optional<PinState>(directory->childPinStates.value(stat->path, *directory->pinState))
+        : Optional<PinState>();
 
-    if (xattr::hasNextcloudPlaceholderAttributes(path)) {
+    // A single path based getxattr(), it also works for entries that can't be opened and follows symlinks
+    if (xattr::hasNextcloudPlaceholderAttributes(QString::fromUtf8(directory->path + '/' + stat->path))) {
         const auto shouldDownload = pin && (*pin == PinState::AlwaysLocal);
         stat->type = shouldDownload ? ItemTypeVirtualFileDownload : ItemTypeVirtualFile;
         return true;
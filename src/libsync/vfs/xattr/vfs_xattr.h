@@ -62,6 +62,10 @@ public slots:
 
 protected:
     void startImpl(const VfsSetupParams &params) override;
+
+private:
+    // placeholders are sparse files of the real size instead of a single byte
+    bool _sparsePlaceholders = false;
 };
 
 class XattrVfsPluginFactory : public QObject, public DefaultPluginFactory<VfsXAttr>
@@ -15,6 +15,8 @@
 
 #include <QString>
 
+#include <ctime>
+
 #include "owncloudlib.h"
 #include "common/result.h"
 
@@ -27,6 +29,11 @@ namespace XAttrWrapper
 
 OWNCLOUDSYNC_EXPORT bool hasNextcloudPlaceholderAttributes(const QString &path);
 OWNCLOUDSYNC_EXPORT Result<void, QString> addNextcloudPlaceholderAttributes(const QString &path);
+/** Creates or replaces path with a sparse placeholder of the given size and mtime.
+ *
+ * Everything happens on one file descriptor and no data gets written.
+ */
+OWNCLOUDSYNC_EXPORT Result<void, QString> createSparsePlaceholder(const QString &path, qint64 size, time_t modtime);
 
 }
 
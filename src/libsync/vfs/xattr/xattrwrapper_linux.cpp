@@ -18,7 +18,14 @@
 
 #include <QLoggingCategory>
 
+#include <QFile>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/xattr.h>
+#include <unistd.h>
 
 Q_LOGGING_CATEGORY(lcXAttrWrapper, "nextcloud.sync.vfs.xattr.wrapper", QtInfoMsg)
 
@@ -67,3 +74,36 @@ OCC::Result<void, QString> OCC::XAttrWrapper::addNextcloudPlaceholderAttributes(
         return {};
     }
 }
+
+OCC::Result<void, QString> OCC::XAttrWrapper::createSparsePlaceholder(const QString &path, qint64 size, time_t modtime)
+{
+    const auto fd = open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return QStringLiteral("Could not create the placeholder: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+    }
+
+    const auto fail = [fd](const QString &what) {
+        const auto error = QString::fromLocal8Bit(strerror(errno));
+        close(fd);
+        qCWarning(lcXAttrWrapper) << what << error;
+        return QStringLiteral("%1: %2").arg(what, error);
+    };
+
+    // Extending the file only allocates blocks once something is written
+    if (ftruncate(fd, size) != 0) {
+        return fail(QStringLiteral("Failed to set the placeholder size"));
+    }
+
+    const timespec times[2] = {{modtime, 0}, {modtime, 0}};
+    if (futimens(fd, times) != 0) {
+        return fail(QStringLiteral("Failed to set the placeholder modification time"));
+    }
+
+    const QByteArray value(APPLICATION_EXECUTABLE);
+    if (fsetxattr(fd, hydrateExecAttributeName, value.constData(), value.size() + 1, 0) != 0) {
+        return fail(QStringLiteral("Failed to set the extended attribute"));
+    }
+
+    close(fd);
+    return {};
+}
@@ -0,0 +1,113 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "benchmarkutils.h"
+#include "account.h"
+#include "owncloudpropagator.h"
+#include "propagateupload.h"
+#include "common/syncjournaldb.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace OCC;
+
+namespace {
+
+using Benchmark::networkReadSize;
+constexpr qint64 uploadLimit = 2 * 1000 * 1000;
+constexpr qint64 largeFileSize = 4 * 1000 * 1000;
+constexpr qint64 smallFileSize = 10 * 1000;
+constexpr auto smallFileCount = 50;
+
+QString createFile(const QTemporaryDir &dir, const QString &name, qint64 size)
+{
+    const auto path = dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QByteArray(size, 'x')) != size) {
+        qFatal("Could not create %s", qPrintable(path));
+    }
+    return path;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir dir;
+    SyncJournalDb journal(dir.filePath(QStringLiteral(".sync_journal.db")));
+    QSet<QString> bulkUploadBlackList;
+    OwncloudPropagator propagator(Account::create(), dir.path(), QStringLiteral("/"), &journal, bulkUploadBlackList);
+    propagator._uploadLimit = uploadLimit;
+    // the bandwidth manager picks the limit up from its event loop
+    QCoreApplication::processEvents();
+
+    const auto largeFile = createFile(dir, QStringLiteral("large"), largeFileSize);
+    const auto smallFile = createFile(dir, QStringLiteral("small"), smallFileSize);
+
+    // One large upload and many small ones all start at once, like a sync with parallel jobs
+    std::vector<std::unique_ptr<UploadDevice>> devices;
+    devices.push_back(std::make_unique<UploadDevice>(largeFile, 0, largeFileSize, &propagator._bandwidthManager));
+    for (auto i = 0; i < smallFileCount; ++i) {
+        devices.push_back(std::make_unique<UploadDevice>(smallFile, 0, smallFileSize, &propagator._bandwidthManager));
+    }
+    for (const auto &device : devices) {
+        if (!device->open(QIODevice::ReadOnly)) {
+            qFatal("Could not open upload device: %s", qPrintable(device->errorString()));
+        }
+    }
+
+    QByteArray buffer(networkReadSize, Qt::Uninitialized);
+    qint64 total = 0;
+    qint64 lastSmallFileDone = 0;
+    qint64 largeFileDone = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (std::any_of(devices.cbegin(), devices.cend(), [](const auto &device) { return !device->atEnd(); })) {
+        auto readSomething = false;
+        for (const auto &device : devices) {
+            if (device->atEnd()) {
+                continue;
+            }
+            const auto c = device->read(buffer.data(), buffer.size());
+            if (c > 0) {
+                total += c;
+                readSomething = true;
+            }
+            if (device->atEnd()) {
+                (device == devices.front() ? largeFileDone : lastSmallFileDone) = timer.elapsed();
+            }
+        }
+        // wait for the bandwidth manager to hand out new quota
+        QCoreApplication::processEvents(readSomething ? QEventLoop::AllEvents : QEventLoop::WaitForMoreEvents);
+    }
+    const auto elapsed = timer.elapsed();
+
+    const auto expectedMsec = 1000 * total / uploadLimit;
+    qDebug() << "UPLOADED" << total << "BYTES IN" << elapsed << "MS, EXPECTED ABOUT" << expectedMsec << "MS";
+    qDebug() << "ACHIEVED RATE" << 1000 * total / qMax<qint64>(elapsed, 1) << "BYTES/SEC FOR A LIMIT OF" << uploadLimit;
+    qDebug() << "LAST SMALL FILE DONE AFTER" << lastSmallFileDone << "MS, LARGE FILE AFTER" << largeFileDone << "MS";
+
+    auto result = 0;
+    // Only the initial burst of the bucket may exceed the limit
+    if (elapsed < expectedMsec * 8 / 10 || elapsed > expectedMsec * 12 / 10) {
+        qWarning() << "The achieved rate is off by more than 20%";
+        result = 1;
+    }
+    if (lastSmallFileDone > largeFileDone / 2) {
+        qWarning() << "The small files were held back by the large one";
+        result = 1;
+    }
+    return result;
+}
@@ -31,6 +31,23 @@ void addBunchOfFiles(int depth, const QString &path, FileModifier &fi) {
     }
 }
 
+// Rough memory an item of the sync plan takes: the item itself, its side struct
+// and the text it keeps besides the path strings
+qint64 itemBytes(const SyncFileItem &item)
+{
+    const QString extraStrings[] = {item.errorExceptionName(), item.errorExceptionMessage(), item.directDownloadUrl(),
+        item.directDownloadCookies(), item.lockOwnerId(), item.lockOwnerDisplayName(), item.lockEditorApp(), item.lockToken(),
+        item.livePhotoFile(), item.discoveryResult()};
+    qint64 bytes = sizeof(SyncFileItem);
+    for (const auto &string : extraStrings) {
+        bytes += string.size() * sizeof(QChar);
+    }
+    if (item.hasExtras()) {
+        bytes += sizeof(SyncFileItem::Extras);
+    }
+    return bytes;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
@@ -39,11 +56,43 @@ int main(int argc, char *argv[])
 
     qDebug() << "NUMFILES" << numFiles;
     qDebug() << "NUMDIRS" << numDirs;
+    qint64 planItems = 0;
+    qint64 planBytes = 0;
+    auto planConnection = QObject::connect(&fakeFolder.syncEngine(), &SyncEngine::aboutToPropagate, [&](SyncFileItemVector &items) {
+        for (const auto &item : std::as_const(items)) {
+            ++planItems;
+            planBytes += itemBytes(*item);
+        }
+    });
+
     QElapsedTimer timer;
     timer.start();
     bool result1 = fakeFolder.syncOnce();
     qDebug() << "FIRST SYNC: " << result1 << timer.restart();
+    QObject::disconnect(planConnection);
+    qDebug() << "SYNCFILEITEM SIZE" << sizeof(SyncFileItem) << "EXTRAS SIZE" << sizeof(SyncFileItem::Extras);
+    qDebug() << "SYNC PLAN ITEMS" << planItems << "BYTES PER ITEM" << (planItems > 0 ? planBytes / planItems : 0);
     bool result2 = fakeFolder.syncOnce();
     qDebug() << "SECOND SYNC: " << result2 << timer.restart();
-    return (result1 && result2) ? 0 : -1;
+
+    // No-change syncs with full local discovery: serial vs. parallel local directory listing
+    auto options = fakeFolder.syncEngine().syncOptions();
+    const auto parallelLocalDiscoveryJobs = options._parallelLocalDiscoveryJobs;
+
+    options._parallelLocalDiscoveryJobs = 1;
+    fakeFolder.syncEngine().setSyncOptions(options);
+    timer.restart();
+    bool result3 = fakeFolder.syncOnce();
+    const auto serialElapsed = timer.restart();
+    qDebug() << "NO-CHANGE SYNC, 1 LOCAL DISCOVERY JOB: " << result3 << serialElapsed;
+
+    options._parallelLocalDiscoveryJobs = parallelLocalDiscoveryJobs;
+    fakeFolder.syncEngine().setSyncOptions(options);
+    timer.restart();
+    bool result4 = fakeFolder.syncOnce();
+    const auto parallelElapsed = timer.restart();
+    qDebug() << "NO-CHANGE SYNC," << parallelLocalDiscoveryJobs << "LOCAL DISCOVERY JOBS: " << result4 << parallelElapsed;
+    qDebug() << "LOCAL DISCOVERY SPEEDUP: " << (parallelElapsed > 0 ? double(serialElapsed) / parallelElapsed : 0.0);
+
+    return (result1 && result2 && result3 && result4) ? 0 : -1;
 }
@@ -0,0 +1,91 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "logger.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace OCC;
+
+Q_LOGGING_CATEGORY(lcBenchLogger, "nextcloud.bench.logger", QtInfoMsg)
+
+namespace {
+
+// All runs together stay below the line count at which the logger rotates its file
+constexpr auto linesPerThread = 1500;
+
+/// Returns the average time a logging thread spends per line, in nanoseconds
+qint64 logFromThreads(int threadCount)
+{
+    std::vector<qint64> elapsed(threadCount, 0);
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < threadCount; ++t) {
+        threads.emplace_back([t, &elapsed] {
+            QElapsedTimer timer;
+            timer.start();
+            for (auto i = 0; i < linesPerThread; ++i) {
+                if (i % 100 == 0) {
+                    qCWarning(lcBenchLogger) << "thread" << t << "warning line" << i;
+                } else {
+                    qCInfo(lcBenchLogger) << "thread" << t << "line" << i << "of a sync that logs a lot";
+                }
+            }
+            elapsed[t] = timer.nsecsElapsed();
+        });
+    }
+    qint64 total = 0;
+    for (auto t = 0; t < threadCount; ++t) {
+        threads[t].join();
+        total += elapsed[t];
+    }
+    return total / (threadCount * linesPerThread);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir dir;
+    auto logger = Logger::instance();
+    logger->setLogFile(dir.filePath(QStringLiteral("bench.log")));
+
+    for (const auto threadCount : {1, 4, 8}) {
+        logger->setAsyncLogging(false);
+        const auto syncNsecs = logFromThreads(threadCount);
+        logger->setAsyncLogging(true);
+        const auto asyncNsecs = logFromThreads(threadCount);
+        std::cout << threadCount << " THREADS: SYNC " << syncNsecs << " NS/LINE, ASYNC " << asyncNsecs << " NS/LINE" << std::endl;
+    }
+    logger->setAsyncLogging(false);
+
+    // Every line has to be in the file once the writer is stopped
+    logger->setLogFile(QString());
+    QFile log(dir.filePath(QStringLiteral("bench.log")));
+    if (!log.open(QIODevice::ReadOnly)) {
+        std::cerr << "Could not open the log file" << std::endl;
+        return 1;
+    }
+    auto lines = 0;
+    while (!log.readLine().isEmpty()) {
+        ++lines;
+    }
+    const auto expectedLines = 2 * (1 + 4 + 8) * linesPerThread;
+    if (lines < expectedLines) {
+        std::cerr << "Lost log lines: " << lines << " of " << expectedLines << std::endl;
+        return 1;
+    }
+    return 0;
+}
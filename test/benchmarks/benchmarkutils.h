@@ -0,0 +1,19 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#pragma once
+
+#include <QtGlobal>
+
+namespace OCC {
+namespace Benchmark {
+
+// The network stack pulls upload data in pieces of about this size
+constexpr qint64 networkReadSize = 16 * 1024;
+
+}
+}
@@ -0,0 +1,167 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "benchmarkutils.h"
+#include "propagateupload.h"
+#include "clientsideencryption.h"
+#include "filesystem.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+
+#include <ctime>
+#include <memory>
+
+using namespace OCC;
+
+namespace {
+
+using Benchmark::networkReadSize;
+constexpr qint64 chunkSize = 10LL * 1000LL * 1000LL;
+
+/* Reads straight from the QFile, like UploadDevice did before it had a read-ahead buffer */
+class PlainFileDevice : public QIODevice
+{
+public:
+    PlainFileDevice(const QString &fileName, qint64 start, qint64 size)
+        : _file(fileName)
+        , _start(start)
+        , _size(size)
+    {
+    }
+
+    bool open(QIODevice::OpenMode mode) override
+    {
+        QString openError;
+        if (!FileSystem::openAndSeekFileSharedRead(&_file, &openError, _start)) {
+            setErrorString(openError);
+            return false;
+        }
+        return QIODevice::open(mode);
+    }
+
+    [[nodiscard]] bool atEnd() const override { return _read >= _size; }
+    [[nodiscard]] qint64 size() const override { return _size; }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override
+    {
+        maxlen = qMin(maxlen, _size - _read);
+        if (maxlen <= 0) {
+            return -1;
+        }
+        const auto c = _file.read(data, maxlen);
+        if (c > 0) {
+            _read += c;
+        }
+        return c;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    QFile _file;
+    qint64 _start = 0;
+    qint64 _size = 0;
+    qint64 _read = 0;
+};
+
+/* Taken before the upload is prepared, so that the preparation counts as well */
+struct Start
+{
+    Start() { timer.start(); }
+
+    QElapsedTimer timer;
+    std::clock_t cpu = std::clock();
+};
+
+/* Reads all chunks of the upload like the network stack does */
+template <typename DeviceFactory>
+void measure(const char *name, qint64 uploadSize, const Start &since, DeviceFactory makeDevice)
+{
+    QByteArray buffer(networkReadSize, Qt::Uninitialized);
+    qint64 total = 0;
+    qint64 firstByteMsec = -1;
+
+    for (qint64 start = 0; start < uploadSize; start += chunkSize) {
+        std::unique_ptr<QIODevice> device = makeDevice(start, qMin(chunkSize, uploadSize - start));
+        if (!device->open(QIODevice::ReadOnly)) {
+            qFatal("Could not open upload device: %s", qPrintable(device->errorString()));
+        }
+        qint64 c = 0;
+        while ((c = device->read(buffer.data(), buffer.size())) > 0) {
+            if (firstByteMsec < 0) {
+                firstByteMsec = since.timer.elapsed();
+            }
+            total += c;
+        }
+    }
+    const auto cpuMsec = 1000.0 * static_cast<double>(std::clock() - since.cpu) / CLOCKS_PER_SEC;
+
+    Q_ASSERT(total == uploadSize);
+    qDebug() << name << "CPU MS PER GB:" << cpuMsec * 1e9 / static_cast<double>(total) << "TIME TO FIRST BYTE MS:" << firstByteMsec
+             << "WALL MS:" << since.timer.elapsed();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const auto fileSize = app.arguments().size() > 1 ? app.arguments().at(1).toLongLong() : 1000LL * 1000LL * 1000LL;
+
+    QTemporaryFile file;
+    if (!file.open()) {
+        qFatal("Could not create the test file");
+    }
+    const QByteArray block(1024 * 1024, 'x');
+    for (qint64 written = 0; written < fileSize; written += block.size()) {
+        file.write(block.constData(), qMin<qint64>(block.size(), fileSize - written));
+    }
+    file.close();
+    qDebug() << "FILE SIZE" << fileSize << "CHUNK SIZE" << chunkSize;
+
+    // Both devices read from the page cache, so this compares the CPU spent on reading
+    const auto fileName = file.fileName();
+    measure("WARMUP", fileSize, Start{}, [&](qint64 start, qint64 size) { return std::make_unique<PlainFileDevice>(fileName, start, size); });
+    measure("PLAIN QFILE", fileSize, Start{}, [&](qint64 start, qint64 size) { return std::make_unique<PlainFileDevice>(fileName, start, size); });
+    measure("UPLOAD DEVICE", fileSize, Start{}, [&](qint64 start, qint64 size) { return std::make_unique<UploadDevice>(fileName, start, size, nullptr); });
+
+    // End-to-end encrypted uploads: encrypting into a temporary file first, or while the chunks are read
+    const auto key = EncryptionHelper::generateRandom(16);
+    const auto iv = EncryptionHelper::generateRandom(16);
+    {
+        const Start since;
+        QFile input(fileName);
+        QTemporaryFile output;
+        if (!output.open()) {
+            qFatal("Could not create the encrypted file");
+        }
+        output.close();
+        QByteArray tag;
+        if (!EncryptionHelper::fileEncryption(key, iv, &input, &output, tag)) {
+            qFatal("Could not encrypt the file");
+        }
+        const auto outputName = output.fileName();
+        measure("ENCRYPTED TEMPORARY FILE", output.size(), since, [&](qint64 start, qint64 size) {
+            return std::make_unique<UploadDevice>(outputName, start, size, nullptr);
+        });
+    }
+    {
+        const Start since;
+        QSharedPointer<EncryptionHelper::StreamingEncryptor> encryptor(new EncryptionHelper::StreamingEncryptor(fileName, key, iv));
+        if (!encryptor->open()) {
+            qFatal("Could not open the file for encryption: %s", qPrintable(encryptor->errorString()));
+        }
+        measure("STREAMING ENCRYPTION", encryptor->size(), since, [&](qint64 start, qint64 size) {
+            return std::make_unique<UploadDevice>(encryptor, start, size, nullptr);
+        });
+    }
+
+    return 0;
+}
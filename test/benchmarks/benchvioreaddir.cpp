@@ -0,0 +1,69 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "csync/csync.h"
+#include "csync/vio/csync_vio_local.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+
+namespace {
+
+constexpr int filesPerDir = 1000;
+
+qint64 entries = 0;
+
+void traverse(const QString &path)
+{
+    auto dh = csync_vio_local_opendir(path);
+    if (!dh) {
+        qFatal("Could not open %s", qPrintable(path));
+    }
+    while (auto dirent = csync_vio_local_readdir(dh, nullptr)) {
+        ++entries;
+        if (dirent->type == ItemTypeDirectory) {
+            traverse(path + QLatin1Char('/') + QString::fromUtf8(dirent->path));
+        }
+    }
+    csync_vio_local_closedir(dh);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const auto fileCount = app.arguments().size() > 1 ? app.arguments().at(1).toInt() : 1000 * 1000;
+
+    QTemporaryDir tree;
+    if (!tree.isValid()) {
+        qFatal("Could not create the test directory");
+    }
+    for (int file = 0; file < fileCount; ++file) {
+        const auto dirPath = tree.path() + QStringLiteral("/dir%1").arg(file / filesPerDir);
+        if (file % filesPerDir == 0) {
+            QDir().mkdir(dirPath);
+        }
+        QFile f(dirPath + QStringLiteral("/file%1").arg(file));
+        if (!f.open(QIODevice::WriteOnly)) {
+            qFatal("Could not create %s", qPrintable(f.fileName()));
+        }
+    }
+    qDebug() << "FILES" << fileCount << "FILES PER DIR" << filesPerDir;
+
+    QElapsedTimer timer;
+    timer.start();
+    traverse(tree.path());
+    const auto msec = qMax<qint64>(timer.elapsed(), 1);
+    qDebug() << "ENTRIES" << entries << "WALL MS:" << msec << "ENTRIES PER SECOND:" << entries * 1000 / msec;
+
+    return 0;
+}
@@ -713,6 +713,16 @@ FakeGetReply::FakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::
     }
     Q_ASSERT_X(fileInfo, Q_FUNC_INFO, "Could not find file on the remote");
     QMetaObject::invokeMethod(this, &FakeGetReply::respond, Qt::QueuedConnection);
+
+    if (request.hasRawHeader("Range")) {
+        const QString range = QString::fromUtf8(request.rawHeader("Range"));
+        const QRegularExpression bytesPattern(QStringLiteral("^bytes=(?<start>\\d+)-(?<end>\\d+)$"));
+        const QRegularExpressionMatch match = bytesPattern.match(range);
+        if (match.hasMatch()) {
+            rangeStart = match.captured(QStringLiteral("start")).toLongLong();
+            rangeEnd = match.captured(QStringLiteral("end")).toLongLong();
+        }
+    }
 }
 
 void FakeGetReply::respond()
@@ -731,8 +741,14 @@ void FakeGetReply::respond()
     }
     payload = fileInfo->contentChar;
     size = fileInfo->size;
+    if (rangeStart >= 0 && rangeStart <= rangeEnd && rangeEnd < fileInfo->size) {
+        size = static_cast<int>(rangeEnd - rangeStart + 1);
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 206);
+        setRawHeader("Content-Range", "bytes " + QByteArray::number(rangeStart) + '-' + QByteArray::number(rangeEnd) + '/' + QByteArray::number(fileInfo->size));
+    } else {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+    }
     setHeader(QNetworkRequest::ContentLengthHeader, size);
-    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
     setRawHeader("OC-ETag", fileInfo->etag);
     setRawHeader("ETag", fileInfo->etag);
     setRawHeader("OC-FileId", fileInfo->fileId);
@@ -337,6 +337,9 @@ public:
     char payload = 0;
     int size = 0;
     bool aborted = false;
+    /// Requested closed byte range, only "bytes=start-end" is answered partially
+    qint64 rangeStart = -1;
+    qint64 rangeEnd = -1;
 
     FakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
@@ -123,6 +123,25 @@ private slots:
         QCOMPARE(sSum, sum);
     }
 
+    void testMultipleChecksumsInOnePass()
+    {
+        QString file(_root.path() + "/file_c.bin");
+        QVERIFY(writeRandomFile(file, 3 * 1024 * 1024));
+
+        const QList<QByteArray> types = {OCC::checkSumSHA1C, OCC::checkSumMD5C, OCC::checkSumSHA3C, OCC::checkSumAdlerC};
+        ChecksumCalculator checksumCalculator(file, types);
+        const auto sums = checksumCalculator.calculateAll();
+        QCOMPARE(sums.size(), types.size());
+        for (int i = 0; i < types.size(); ++i) {
+            ChecksumCalculator singleCalculator(file, types.at(i));
+            QCOMPARE(sums.at(i), singleCalculator.calculate());
+        }
+
+        // One unknown type makes the whole calculation fail
+        ChecksumCalculator unknownCalculator(file, QList<QByteArray>{OCC::checkSumSHA1C, "Klaas32"});
+        QVERIFY(unknownCalculator.calculateAll().isEmpty());
+    }
+
     void testUploadChecksummingAdler() {
 #ifndef ZLIB_FOUND
         QSKIP("ZLIB not found.", SkipSingle);
@@ -186,6 +205,22 @@ private slots:
         delete vali;
     }
 
+    void testUploadChecksummingAdditionalTypes()
+    {
+        ComputeChecksum computeChecksum;
+        computeChecksum.setChecksumType(OCC::checkSumSHA1C);
+        computeChecksum.setAdditionalChecksumTypes({OCC::checkSumMD5C});
+        QSignalSpy doneSpy(&computeChecksum, &ComputeChecksum::done);
+        computeChecksum.start(_testfile);
+        QVERIFY(doneSpy.wait());
+
+        QCOMPARE(doneSpy.first().at(0).toByteArray(), QByteArray(OCC::checkSumSHA1C));
+        QCOMPARE(doneSpy.first().at(1).toByteArray(), ComputeChecksum::computeNow(_testfile, OCC::checkSumSHA1C));
+        QCOMPARE(computeChecksum.checksum(OCC::checkSumSHA1C), ComputeChecksum::computeNow(_testfile, OCC::checkSumSHA1C));
+        QCOMPARE(computeChecksum.checksum(OCC::checkSumMD5C), ComputeChecksum::computeNow(_testfile, OCC::checkSumMD5C));
+        QVERIFY(computeChecksum.checksum(OCC::checkSumAdlerC).isEmpty());
+    }
+
     void testDownloadChecksummingAdler() {
 #ifndef ZLIB_FOUND
         QSKIP("ZLIB not found.", SkipSingle);
@@ -124,6 +124,43 @@ private slots:
         QCOMPARE(fakeFolder.uploadState().children.count(), 2); // the transfer was done with chunking
     }
 
+    void testParallelChunkUpload()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.syncEngine().account()->setCapabilities({{"dav", QVariantMap{{"chunking", "1.0"}}},
+            {"files", QVariantMap{{"chunked_upload", QVariantMap{{"max_parallel_count", 3}}}}}});
+        setChunkSize(fakeFolder.syncEngine(), 1 * 1000 * 1000);
+        const int size = 20 * 1000 * 1000; // 20 MB
+
+        // The PUTs started before the event loop runs again are in flight together
+        QObject parent;
+        int putsInFlight = 0;
+        int maxPutsInFlight = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation) {
+                if (putsInFlight++ == 0) {
+                    QTimer::singleShot(0, &parent, [&]() { putsInFlight = 0; });
+                }
+                maxPutsInFlight = qMax(maxPutsInFlight, putsInFlight);
+            }
+            return nullptr;
+        });
+
+        fakeFolder.localModifier().insert("A/a0", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.currentRemoteState().find("A/a0")->size, size);
+        QCOMPARE(maxPutsInFlight, 3);
+
+        // Without the capability the chunks go one by one
+        fakeFolder.syncEngine().account()->setCapabilities({{"dav", QVariantMap{{"chunking", "1.0"}}}});
+        maxPutsInFlight = 0;
+        fakeFolder.localModifier().appendByte("A/a0");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(maxPutsInFlight, 1);
+    }
+
     // Test resuming when there's a confusing chunk added
     void testResume1() {
         FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
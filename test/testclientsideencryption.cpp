@@ -12,6 +12,8 @@
 #include <common/constants.h>
 
 #include "clientsideencryption.h"
+#include "filesystem.h"
+#include "propagateupload.h"
 #include "logger.h"
 
 using namespace OCC;
@@ -257,6 +259,127 @@ private slots:
         chunkedOutputDecrypted.close();
     }
 
+    void testStreamingEncryptor_data()
+    {
+        QTest::addColumn<int>("totalBytes");
+        QTest::addColumn<int>("bytesToRead");
+
+        QTest::newRow("empty") << 0 << 7;
+        QTest::newRow("small reads") << 1000 << 7;
+        QTest::newRow("multiple blocks") << 200 * 1000 << 16 * 1024;
+        QTest::newRow("large reads") << 200 * 1000 << 1000 * 1000;
+    }
+
+    void testStreamingEncryptor()
+    {
+        QFETCH(int, totalBytes);
+        QFETCH(int, bytesToRead);
+
+        QTemporaryFile inputFile;
+        QVERIFY(inputFile.open());
+        QCOMPARE(inputFile.write(EncryptionHelper::generateRandom(totalBytes)), qint64(totalBytes));
+        inputFile.close();
+
+        const auto encryptionKey = EncryptionHelper::generateRandom(16);
+        const auto initializationVector = EncryptionHelper::generateRandom(16);
+
+        QTemporaryFile encryptedFile;
+        QByteArray tag;
+        QVERIFY(EncryptionHelper::fileEncryption(encryptionKey, initializationVector, &inputFile, &encryptedFile, tag));
+        QVERIFY(encryptedFile.open());
+        const auto expected = encryptedFile.readAll();
+
+        EncryptionHelper::StreamingEncryptor encryptor(inputFile.fileName(), encryptionKey, initializationVector);
+        QVERIFY(encryptor.open());
+        QCOMPARE(encryptor.size(), qint64(expected.size()));
+
+        const auto readAt = [&](qint64 pos, qint64 size) {
+            QByteArray result(size, '\0');
+            qint64 done = 0;
+            while (done < size) {
+                const auto c = encryptor.read(pos + done, result.data() + done, qMin<qint64>(bytesToRead, size - done));
+                if (c <= 0) {
+                    break;
+                }
+                done += c;
+            }
+            result.truncate(done);
+            return result;
+        };
+
+        // sequential
+        QCOMPARE(readAt(0, encryptor.size()), expected);
+        QCOMPARE(encryptor.tag(), tag);
+        QCOMPARE(encryptor.read(encryptor.size(), nullptr, 1), qint64(0));
+
+        // going back restarts the encryption, skipping ahead encrypts the data in between
+        const auto middle = encryptor.size() / 2;
+        QCOMPARE(readAt(middle, encryptor.size() - middle), expected.mid(middle));
+        QCOMPARE(readAt(0, middle), expected.left(middle));
+        QCOMPARE(encryptor.tag(), tag);
+    }
+
+    void testStreamingEncryptorUploadRetry()
+    {
+        constexpr auto chunkSize = 100 * 1000;
+        constexpr auto totalBytes = 250 * 1000;
+
+        QTemporaryFile inputFile;
+        QVERIFY(inputFile.open());
+        QCOMPARE(inputFile.write(EncryptionHelper::generateRandom(totalBytes)), qint64(totalBytes));
+        inputFile.close();
+
+        const auto encryptionKey = EncryptionHelper::generateRandom(16);
+        const auto initializationVector = EncryptionHelper::generateRandom(16);
+
+        QTemporaryFile encryptedFile;
+        QByteArray tag;
+        QVERIFY(EncryptionHelper::fileEncryption(encryptionKey, initializationVector, &inputFile, &encryptedFile, tag));
+        QVERIFY(encryptedFile.open());
+        const auto expected = encryptedFile.readAll();
+
+        QSharedPointer<EncryptionHelper::StreamingEncryptor> encryptor(
+            new EncryptionHelper::StreamingEncryptor(inputFile.fileName(), encryptionKey, initializationVector));
+        QVERIFY(encryptor->open());
+
+        const auto uploadChunk = [&encryptor](qint64 start) {
+            UploadDevice device(encryptor, start, chunkSize, nullptr);
+            if (!device.open(QIODevice::ReadOnly)) {
+                return QByteArray();
+            }
+            return device.readAll();
+        };
+
+        QCOMPARE(uploadChunk(0), expected.mid(0, chunkSize));
+        QCOMPARE(uploadChunk(chunkSize), expected.mid(chunkSize, chunkSize));
+
+        // The network stack rewinds the device of a request it sends again
+        {
+            UploadDevice device(encryptor, 2 * chunkSize, chunkSize, nullptr);
+            QVERIFY(device.open(QIODevice::ReadOnly));
+            QCOMPARE(device.read(1000), expected.mid(2 * chunkSize, 1000));
+            QVERIFY(device.reset());
+            QCOMPARE(device.readAll(), expected.mid(2 * chunkSize));
+        }
+        QCOMPARE(encryptor->tag(), tag);
+
+        // A retry of an earlier chunk continues from the start of that chunk
+        QCOMPARE(uploadChunk(chunkSize), expected.mid(chunkSize, chunkSize));
+        QCOMPARE(uploadChunk(0), expected.mid(0, chunkSize));
+
+        // The file is modified while it is uploaded, a retry must not encrypt the new data with the same key and IV
+        QVERIFY(inputFile.open());
+        QVERIFY(inputFile.seek(0));
+        QCOMPARE(inputFile.write("modified"), qint64(8));
+        inputFile.close();
+        QVERIFY(FileSystem::setModTime(inputFile.fileName(), FileSystem::getModTime(inputFile.fileName()) + 10));
+
+        UploadDevice device(encryptor, 0, chunkSize, nullptr);
+        QVERIFY(device.open(QIODevice::ReadOnly));
+        QVERIFY(device.read(1000).isEmpty());
+        QVERIFY(!device.errorString().isEmpty());
+    }
+
     void testGzipThenEncryptDataAndBack()
     {
         const auto metadataKeySize = 16;
@@ -14,6 +14,7 @@
 #include "syncenginetestutils.h"
 #include "clientsideencryption.h"
 #include "foldermetadata.h"
+#include "encryptedfoldermetadatahandler.h"
 #include <QtTest>
 
 using namespace OCC;
@@ -421,6 +422,33 @@ private slots:
         }
         QVERIFY(isFirstUserPresentAndCanDecrypt);
     }
+
+    void testMetadataCipherTextEncryptThenDecrypt()
+    {
+        EncryptedFolderMetadataHandler::setMetadataCacheEnabled(true);
+
+        const auto metadataKey = EncryptionHelper::generateRandom(16);
+        const QJsonObject cipherText{{QStringLiteral("counter"), 1}, {QStringLiteral("folders"), QJsonObject{{QStringLiteral("encrypted"), QStringLiteral("folder")}}}};
+
+        auto encryptFuture = EncryptedFolderMetadataHandler::encryptMetadataCipherText(metadataKey, QJsonDocument(cipherText));
+        const auto encrypted = encryptFuture.result();
+        QVERIFY(!encrypted.cipherText.isEmpty());
+        QVERIFY(!encrypted.nonce.isEmpty());
+        QVERIFY(!encrypted.authenticationTag.isEmpty());
+
+        auto decryptFuture = EncryptedFolderMetadataHandler::decryptMetadataCipherText(metadataKey, encrypted.cipherText, encrypted.nonce);
+        // what was just uploaded is served from the cache
+        QVERIFY(decryptFuture.isFinished());
+        QCOMPARE(decryptFuture.result().object(), cipherText);
+
+        // not cached, the decryption must actually run and fail
+        EncryptedFolderMetadataHandler::setMetadataCacheEnabled(false);
+        auto wrongKeyFuture = EncryptedFolderMetadataHandler::decryptMetadataCipherText(EncryptionHelper::generateRandom(16), encrypted.cipherText, encrypted.nonce);
+        QVERIFY(wrongKeyFuture.result().isNull());
+
+        decryptFuture = EncryptedFolderMetadataHandler::decryptMetadataCipherText(metadataKey, encrypted.cipherText, encrypted.nonce);
+        QCOMPARE(decryptFuture.result().object(), cipherText);
+    }
 };
 
 QTEST_GUILESS_MAIN(TestClientSideEncryptionV2)
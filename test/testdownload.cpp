@@ -98,6 +98,47 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    void testSegmentedDownload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto opts = fakeFolder.syncEngine().syncOptions();
+        opts._downloadSegments = 4;
+        opts._minSegmentedDownloadSize = 1000;
+        fakeFolder.syncEngine().setSyncOptions(opts);
+        fakeFolder.remoteModifier().insert("A/big", 10'000);
+
+        QList<QByteArray> ranges;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith("A/big")) {
+                ranges.append(request.rawHeader("Range"));
+            }
+            return nullptr;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        std::sort(ranges.begin(), ranges.end());
+        QCOMPARE(ranges, (QList<QByteArray>{ "bytes=0-2499", "bytes=2500-4999", "bytes=5000-7499", "bytes=7500-9999" }));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // A server ignoring the ranges gets the file requested in one stream
+        fakeFolder.remoteModifier().appendByte("A/big");
+        ranges.clear();
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith("A/big")) {
+                ranges.append(request.rawHeader("Range"));
+                auto wholeFileRequest = request;
+                wholeFileRequest.setRawHeader("Range", {});
+                return new FakeGetReply(fakeFolder.remoteModifier(), op, wholeFileRequest, this);
+            }
+            return nullptr;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(ranges.size() > 1);
+        QCOMPARE(ranges.constLast(), QByteArray());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void testErrorMessage () {
         // This test's main goal is to test that the error string from the server is shown in the UI
 
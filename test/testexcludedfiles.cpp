@@ -109,7 +109,8 @@ private slots:
         QVERIFY(!excludedFiles->_bnameTraversalRegexFile[QStringLiteral("/")].pattern().contains("csync1"));
 
         excludedFiles->addManualExclude("foo");
-        QVERIFY(excludedFiles->_bnameTraversalRegexFile[QStringLiteral("/")].pattern().contains("foo"));
+        QVERIFY(excludedFiles->_bnameLookupFile[QStringLiteral("/")]._names[ExcludedFiles::BnameLookup::Exclude].contains("foo"));
+        QVERIFY(!excludedFiles->_bnameTraversalRegexFile[QStringLiteral("/")].pattern().contains("foo"));
         QVERIFY(excludedFiles->_fullRegexFile[QStringLiteral("/")].pattern().contains("foo"));
         QVERIFY(!excludedFiles->_fullTraversalRegexFile[QStringLiteral("/")].pattern().contains("foo"));
     }
@@ -291,6 +292,85 @@ private slots:
         QCOMPARE(check_file_traversal("latex/songbook/my_manuscript.tex.tmp"), CSYNC_FILE_EXCLUDE_LIST);
     }
 
+    void check_csync_excluded_traversal_lookup()
+    {
+        setup();
+        excludedFiles->addManualExclude("plain");
+        excludedFiles->addManualExclude("]removed");
+        excludedFiles->addManualExclude("dironly/");
+        excludedFiles->addManualExclude("*.suffix");
+        excludedFiles->addManualExclude("prefix.*");
+        excludedFiles->addManualExclude("gl?b");
+        excludedFiles->addManualExclude("sub/*.trig");
+
+        const auto &lookupFile = excludedFiles->_bnameLookupFile[QStringLiteral("/")];
+        QVERIFY(lookupFile._names[ExcludedFiles::BnameLookup::Exclude].contains("plain"));
+        QVERIFY(lookupFile._names[ExcludedFiles::BnameLookup::ExcludeRemove].contains("removed"));
+        QVERIFY(!lookupFile._names[ExcludedFiles::BnameLookup::Exclude].contains("dironly"));
+        QVERIFY(lookupFile._suffixes[ExcludedFiles::BnameLookup::Exclude].contains(".suffix"));
+        QVERIFY(lookupFile._prefixes[ExcludedFiles::BnameLookup::Exclude].contains("prefix."));
+        QVERIFY(lookupFile._suffixes[ExcludedFiles::BnameLookup::Trigger].contains(".trig"));
+        QVERIFY(lookupFile._hasGlobs);
+        QVERIFY(excludedFiles->_bnameTraversalRegexFile[QStringLiteral("/")].pattern().contains("gl"));
+
+        QCOMPARE(check_file_traversal("plain"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("a/plain"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("plainer"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_file_traversal("removed"), CSYNC_FILE_EXCLUDE_AND_REMOVE);
+        QCOMPARE(check_file_traversal("dironly"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_dir_traversal("dironly"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("a/b.suffix"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal(".suffix"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("a/b.suffixx"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_dir_traversal("prefix."), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("prefix.txt"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("a/prefi.txt"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_file_traversal("glob"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("gloob"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_file_traversal("sub/x.trig"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("other/x.trig"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_file_traversal("sub/deeper/x.trig"), CSYNC_NOT_EXCLUDED);
+
+        // The cached directory verdicts must be dropped when patterns change
+        excludedFiles->addManualExclude("other/*.trig");
+        QCOMPARE(check_file_traversal("other/x.trig"), CSYNC_FILE_EXCLUDE_LIST);
+
+        // The lookups must agree with the regex based full matcher
+        const char *paths[] = { "plain", "x/plain", "removed", "dironly", "a.suffix", "prefix.a", "prefixa",
+            "glb", "glab", "sub/x.trig", "sub", "other/y.trig", "nothing" };
+        for (const auto path : paths) {
+            QCOMPARE(check_file_traversal(path), check_file_full(path));
+            QCOMPARE(check_dir_traversal(path), check_dir_full(path));
+        }
+    }
+
+    void check_csync_excluded_traversal_loads_dir_exclude_file()
+    {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        const auto localPath = QString(tempDir.path() + '/');
+        excludedFiles.reset(new ExcludedFiles(localPath));
+        excludedFiles->setWildcardsMatchSlash(false);
+        excludedFiles->addManualExclude("A");
+
+        QVERIFY(QDir(localPath).mkpath("sub"));
+        QFile excludeList(localPath + "sub/.sync-exclude.lst");
+        QVERIFY(excludeList.open(QFile::WriteOnly));
+        QCOMPARE(excludeList.write("bar"), 3);
+        excludeList.close();
+
+        QCOMPARE(check_file_traversal("bar"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_dir_traversal("sub"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_file_traversal("sub/bar"), CSYNC_FILE_EXCLUDE_LIST);
+        QCOMPARE(check_file_traversal("sub/baz"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(check_dir_traversal("A"), CSYNC_FILE_EXCLUDE_LIST);
+
+        // Visiting the directory again does not load its exclude file twice
+        QCOMPARE(check_dir_traversal("sub"), CSYNC_NOT_EXCLUDED);
+        QCOMPARE(excludedFiles->_allExcludes[localPath + "sub/"].size(), 1);
+        QCOMPARE(excludedFiles->_excludeFiles[localPath + "sub/"].size(), 1);
+    }
+
     void check_csync_excluded_traversal()
     {
         setup_init();
@@ -669,6 +749,47 @@ private slots:
         }
     }
 
+    void check_csync_excluded_performance_many_patterns_data()
+    {
+        QTest::addColumn<bool>("traversal");
+        QTest::newRow("traversal lookup") << true;
+        QTest::newRow("full regex") << false;
+    }
+
+    void check_csync_excluded_performance_many_patterns()
+    {
+        QFETCH(bool, traversal);
+
+        // Roughly what a large corporate exclude list looks like
+        setup();
+        for (int i = 0; i < 200; ++i)
+            excludedFiles->addManualExclude(QStringLiteral("Corporate Name %1").arg(i));
+        for (int i = 0; i < 100; ++i)
+            excludedFiles->addManualExclude(QStringLiteral("*.ext%1").arg(i));
+        for (int i = 0; i < 50; ++i)
+            excludedFiles->addManualExclude(QStringLiteral("~tmp%1-*").arg(i));
+        for (int i = 0; i < 40; ++i)
+            excludedFiles->addManualExclude(QStringLiteral("*.b%1?k").arg(i));
+        for (int i = 0; i < 10; ++i)
+            excludedFiles->addManualExclude(QStringLiteral("project%1/build/").arg(i));
+
+        QStringList paths;
+        for (int i = 0; i < 1000; ++i)
+            paths.append(QStringLiteral("documents/reports/%1/report-%2.txt").arg(i % 10).arg(i));
+
+        const int N = 100;
+        int totalRc = 0;
+        QBENCHMARK {
+            for (int i = 0; i < N; ++i) {
+                for (const auto &path : std::as_const(paths)) {
+                    totalRc += traversal ? excludedFiles->traversalPatternMatch(path, ItemTypeFile)
+                                         : excludedFiles->fullPatternMatch(path, ItemTypeFile);
+                }
+            }
+            QCOMPARE(totalRc, 0); // mainly to avoid optimization
+        }
+    }
+
     void check_csync_exclude_expand_escapes()
     {
         extern void csync_exclude_expand_escapes(QByteArray &input);
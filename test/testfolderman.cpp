@@ -389,6 +389,117 @@ private slots:
         QVERIFY(!folderman->checkPathValidityForNewFolder(dirPath + "/ownCloud2/sub/subsub/sub").second.isNull());
     }
 
+    void testConcurrentSyncSlots()
+    {
+        _fm.reset({});
+        _fm.reset(new FolderMan{});
+
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+        QVERIFY(dir.isValid());
+        QDir dir2(dir.path());
+        QVERIFY(dir2.mkpath("a1/nested"));
+        QVERIFY(dir2.mkpath("a2"));
+        QVERIFY(dir2.mkpath("a3"));
+        QVERIFY(dir2.mkpath("b1"));
+        QVERIFY(dir2.mkpath("b2"));
+        const auto dirPath = dir2.canonicalPath();
+
+        const auto createAccountState = [](const QString &url) {
+            AccountPtr account = Account::create();
+            account->setCredentials(new HttpCredentialsTest("testuser", "secret"));
+            account->setUrl(QUrl(url));
+            return AccountStatePtr(new AccountState(account));
+        };
+        const auto accountA = createAccountState("http://example.de");
+        const auto accountB = createAccountState("http://anotherexample.org");
+
+        FolderMan *folderman = FolderMan::instance();
+        folderman->_maxConcurrentSyncs = 3;
+        folderman->_maxConcurrentSyncsPerAccount = 2;
+        const auto a1 = folderman->addFolder(accountA.data(), folderDefinition(dirPath + "/a1"));
+        const auto a2 = folderman->addFolder(accountA.data(), folderDefinition(dirPath + "/a2"));
+        const auto a3 = folderman->addFolder(accountA.data(), folderDefinition(dirPath + "/a3"));
+        const auto b1 = folderman->addFolder(accountB.data(), folderDefinition(dirPath + "/b1"));
+        const auto b2 = folderman->addFolder(accountB.data(), folderDefinition(dirPath + "/b2"));
+        const auto bNested = folderman->addFolder(accountB.data(), folderDefinition(dirPath + "/a1/nested"));
+        QVERIFY(a1 && a2 && a3 && b1 && b2 && bNested);
+
+        // Nothing is running
+        QVERIFY(folderman->hasFreeSyncSlot(a1));
+        QVERIFY(folderman->hasFreeSyncSlot(bNested));
+
+        // The account limit only holds back the folders of that account
+        folderman->_currentSyncFolders = {a1, a2};
+        QVERIFY(!folderman->hasFreeSyncSlot(a1));
+        QVERIFY(!folderman->hasFreeSyncSlot(a3));
+        QVERIFY(folderman->hasFreeSyncSlot(b1));
+        // Overlapping local paths never sync at the same time, even for different accounts
+        QVERIFY(!folderman->hasFreeSyncSlot(bNested));
+        QCOMPARE(folderman->currentSyncFolders().size(), 2);
+        QVERIFY(folderman->isAnySyncRunning());
+
+        // The global limit holds back everything
+        folderman->_currentSyncFolders = {a1, b1, b2};
+        QVERIFY(!folderman->hasFreeSyncSlot(a2));
+        folderman->_currentSyncFolders = {a1, b1};
+        QVERIFY(folderman->hasFreeSyncSlot(a2));
+        QVERIFY(folderman->hasFreeSyncSlot(b2));
+
+        folderman->_currentSyncFolders.clear();
+        QVERIFY(!folderman->isAnySyncRunning());
+    }
+
+    void testLargeDownloadDoesNotTriggerAnotherSync()
+    {
+#ifdef Q_OS_MAC
+        QSKIP("The macOS folder watcher doesn't report the changes of the client itself");
+#endif
+        _fm.reset({});
+        _fm.reset(new FolderMan{});
+
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolder{FileInfo{}};
+        fakeFolder.remoteModifier().mkdir("A");
+
+        AccountStatePtr accountState(new FakeAccountState(fakeFolder.account()));
+        auto folderDef = folderDefinition(fakeFolder.localPath());
+        folderDef.targetPath = "";
+        const auto folder = FolderMan::instance()->addFolder(accountState.data(), folderDef);
+        QVERIFY(folder);
+
+        qRegisterMetaType<OCC::SyncResult>("SyncResult");
+        const auto syncFolder = [folder] {
+            QSignalSpy finishedSpy(folder, &Folder::syncFinished);
+            if (!folder->isBusy()) {
+                folder->startSync();
+            }
+            return finishedSpy.wait(10000);
+        };
+        QVERIFY(syncFolder());
+        QVERIFY(QFileInfo(fakeFolder.localPath() + "A").isDir());
+
+        QStringList changedExternally;
+        connect(folder, &Folder::watchedFileChangedExternally, this, [&](const QString &path) {
+            if (path.startsWith(fakeFolder.localPath() + "A")) {
+                changedExternally.append(path);
+            }
+        });
+
+        // More new files in an existing directory than the folder watcher reports one by one
+        for (int i = 0; i < 150; ++i) {
+            fakeFolder.remoteModifier().insert(QStringLiteral("A/file%1").arg(i));
+        }
+        QVERIFY(syncFolder());
+        QVERIFY(QFileInfo::exists(fakeFolder.localPath() + "A/file149"));
+
+        // Give the watcher time to report the downloaded files
+        QTest::qWait(1000);
+        QVERIFY2(changedExternally.isEmpty(), qPrintable(changedExternally.join(QStringLiteral(", "))));
+    }
+
     void testFindGoodPathForNewSyncFolder()
     {
         _fm.reset({});
@@ -98,7 +98,8 @@ class TestFolderWatcher : public QObject
     }
 
 #ifdef Q_OS_LINUX
-#define CHECK_WATCH_COUNT(n) QCOMPARE(_watcher->testLinuxWatchCount(), (n))
+// inotify watches are registered in the background, fanotify needs none
+#define CHECK_WATCH_COUNT(n) do { if (_watcher->testLinuxWatchCount() != -1) QTRY_COMPARE(_watcher->testLinuxWatchCount(), (n)); } while (false)
 #else
 #define CHECK_WATCH_COUNT(n) do {} while (false)
 #endif
@@ -272,6 +273,51 @@ private slots:
         QVERIFY(waitForPathChanged(dir));
     }
 
+    void testTemporaryFileChurnIsDropped()
+    {
+        if (_watcher->testLinuxWatchCount() == -1) {
+            QSKIP("Only inotify reports creations and removals separately");
+        }
+        const auto droppedBefore = _watcher->statistics().droppedEvents;
+
+        // Created and removed again before the watcher processes any event
+        const QString tempFile(_rootPath + "/a2/churn.tmp");
+        {
+            QFile file(tempFile);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+        }
+        QVERIFY(QFile::remove(tempFile));
+
+        const QString marker(_rootPath + "/a2/marker");
+        touch(marker);
+        QVERIFY(waitForPathChanged(marker));
+        for (const auto &args : std::as_const(*_pathChangedSpy)) {
+            QVERIFY(args.first().toString() != tempFile);
+        }
+        QVERIFY(_watcher->statistics().droppedEvents > droppedBefore);
+        rm(marker);
+    }
+
+    void testManyChangesInOneDirectoryAreCoalesced()
+    {
+        const QString directory(_rootPath + "/a1/b2");
+        QStringList files;
+        for (int i = 0; i < 150; ++i) {
+            files.append(directory + "/many" + QString::number(i));
+            Utility::writeRandomFile(files.last(), 10);
+        }
+
+        QVERIFY(waitForPathChanged(directory));
+        for (const auto &args : std::as_const(*_pathChangedSpy)) {
+            QVERIFY(!files.contains(args.first().toString()));
+        }
+        QVERIFY(_watcher->statistics().coalescedEvents >= 149);
+
+        for (const auto &file : std::as_const(files)) {
+            QFile::remove(file);
+        }
+    }
+
     void testDetectLockFiles()
     {
         QStringList listOfOfficeFiles = {QString(_rootPath + "/document.docx"), QString(_rootPath + "/document.odt")};
@@ -386,6 +432,41 @@ private slots:
             rm(officeLockFile);
         }
     }
+
+    void testQueueOverflowSchedulesBusyDirectories()
+    {
+        _watcher.reset(new FolderWatcher);
+        _watcher->init(_rootPath);
+        _pathChangedSpy.reset(new QSignalSpy(_watcher.data(), &FolderWatcher::pathChanged));
+        QSignalSpy lostChangesBelowSpy(_watcher.data(), &FolderWatcher::lostChangesBelow);
+        if (_watcher->testLinuxWatchCount() == -1) {
+            QSKIP("Only the inotify backend can be overflowed reliably");
+        }
+        CHECK_WATCH_COUNT(countFolders(_rootPath) + 1);
+
+        QFile maxQueuedEventsFile(QStringLiteral("/proc/sys/fs/inotify/max_queued_events"));
+        QVERIFY(maxQueuedEventsFile.open(QIODevice::ReadOnly));
+        const auto maxQueuedEvents = maxQueuedEventsFile.readAll().trimmed().toInt();
+        if (maxQueuedEvents > 100000) {
+            QSKIP("The inotify queue is too large to overflow it quickly");
+        }
+
+        const QString busyFile(_rootPath + "/a1/random.bin");
+        touch(busyFile);
+        QVERIFY(waitForPathChanged(busyFile));
+
+        // Don't process events while writing, alternate between two files
+        // because identical consecutive events get merged by the kernel
+        const QStringList files = {busyFile, _rootPath + "/a1/busy.bin"};
+        for (int i = 0; i <= maxQueuedEvents; ++i) {
+            QFile file(files.at(i % 2));
+            QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+        }
+
+        QVERIFY(lostChangesBelowSpy.wait());
+        QCOMPARE(lostChangesBelowSpy.first().first().toStringList(), QStringList(_rootPath + "/a1"));
+        QFile::remove(_rootPath + "/a1/busy.bin");
+    }
 };
 
 #ifdef Q_OS_MAC
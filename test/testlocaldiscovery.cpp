@@ -274,6 +274,78 @@ private slots:
         QCOMPARE(fakeFolder.currentRemoteState(), expectedState);
     }
 
+    // Directories whose listing matches the digest of the last in-sync run only get their subdirectories processed
+    void testUnchangedDirectoryDigest()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+
+        QStringList discovered;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::itemDiscovered, this, [&discovered](const SyncFileItemPtr &item) {
+            discovered.append(item->_file);
+        });
+
+        // The first no-op sync stores the digests
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(discovered.contains("A/a1"));
+
+        discovered.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(discovered.contains("A"));
+        QVERIFY(discovered.contains("B"));
+        QVERIFY(!discovered.contains("A/a1"));
+        QVERIFY(!discovered.contains("B/b2"));
+
+        // A modified file is still found
+        fakeFolder.localModifier().appendByte("A/a1");
+        discovered.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(discovered.contains("A/a1"));
+        QVERIFY(!discovered.contains("B/b1"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // So is a new file
+        fakeFolder.localModifier().insert("B/b3");
+        discovered.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(discovered.contains("B/b3"));
+        QVERIFY(fakeFolder.currentRemoteState().find("B/b3"));
+
+        // Paths reported by the folder watcher are processed in full
+        QVERIFY(fakeFolder.syncOnce());
+        fakeFolder.syncEngine().setLocalDiscoveryOptions(LocalDiscoveryStyle::FilesystemOnly, {"C/c1"});
+        discovered.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(discovered.contains("C/c1"));
+        QVERIFY(!discovered.contains("B/b1"));
+    }
+
+    // Unresolved conflicts keep being reported although their directory is unchanged
+    void testUnchangedDirectoryDigestWithConflictFile()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().account()->setCapabilities({ { "uploadConflictFiles", true } });
+        const auto conflictName = QStringLiteral("A/a1 (conflicted copy 1234)");
+        fakeFolder.remoteModifier().insert(conflictName);
+        QVERIFY(fakeFolder.syncOnce());
+
+        QStringList discovered;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::itemDiscovered, this, [&discovered](const SyncFileItemPtr &item) {
+            discovered.append(item->_file);
+        });
+
+        for (int i = 0; i < 2; ++i) {
+            ItemCompletedSpy completeSpy(fakeFolder);
+            discovered.clear();
+            QVERIFY(fakeFolder.syncOnce());
+            QVERIFY(discovered.contains(conflictName));
+            QVERIFY(discovered.contains("A/a2"));
+            QCOMPARE(completeSpy.findItem(conflictName)->_status, SyncFileItem::Conflict);
+            QVERIFY(fakeFolder.syncJournal().conflictRecord(conflictName.toUtf8()).isValid());
+        }
+        // Directories without conflicts still take the shortcut
+        QVERIFY(!discovered.contains("B/b1"));
+    }
+
     // Tests the behavior of invalid filename detection
     void testServerBlacklist()
     {
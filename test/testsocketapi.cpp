@@ -0,0 +1,193 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+
+#include "account.h"
+#include "accountstate.h"
+#include "configfile.h"
+#include "folderman.h"
+#include "socketapi/socketapi.h"
+#include "testhelper.h"
+
+using namespace OCC;
+
+namespace {
+
+const auto recordSeparator = QLatin1Char('\x1e');
+
+/* Reads the lines the client received until lastLine arrives */
+QStringList readUntil(QLocalSocket &socket, const QString &lastLine)
+{
+    QStringList lines;
+    QDeadlineTimer deadline(5000);
+    while (!deadline.hasExpired()) {
+        while (socket.canReadLine()) {
+            lines.append(QString::fromUtf8(socket.readLine()).chopped(1));
+            if (lines.last() == lastLine) {
+                return lines;
+            }
+        }
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+    return lines;
+}
+
+QString statusLine(const QString &status, const QString &path)
+{
+    return QStringLiteral("STATUS:%1:%2").arg(status, QDir::toNativeSeparators(path));
+}
+
+}
+
+class TestSocketApi : public QObject
+{
+    Q_OBJECT
+
+    std::unique_ptr<FolderMan> _fm;
+    QTemporaryDir _confDir;
+    QTemporaryDir _dir;
+    AccountStatePtr _accountState;
+    Folder *_folder = nullptr;
+    QString _subPath;
+
+    SocketApi *socketApi() const { return _fm->socketApi(); }
+
+    /* Connects a client, which has to ask for statuses before it gets pushes */
+    void connectClient(QLocalSocket &socket)
+    {
+        const auto listenerCount = socketApi()->_listeners.size();
+        socket.connectToServer(socketApi()->_localServer.fullServerName());
+        QVERIFY(socket.waitForConnected());
+        QTRY_COMPARE(socketApi()->_listeners.size(), listenerCount + 1);
+    }
+
+    void monitorSubDirectory(QLocalSocket &socket)
+    {
+        socket.write(QStringLiteral("RETRIEVE_DIRECTORY_STATUS:%1\n").arg(_subPath).toUtf8());
+        QCOMPARE(readUntil(socket, QStringLiteral("RETRIEVE_DIRECTORY_STATUS:END")).first(), QStringLiteral("RETRIEVE_DIRECTORY_STATUS:BEGIN"));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        QVERIFY(_confDir.isValid());
+        ConfigFile::setConfDir(_confDir.path()); // we don't want to pollute the user's config file
+
+        _fm.reset(new FolderMan{});
+        QVERIFY(socketApi()->_localServer.isListening());
+
+        QVERIFY(_dir.isValid());
+        QDir dir(_dir.path());
+        QVERIFY(dir.mkpath("folder/sub"));
+        const auto folderPath = dir.canonicalPath() + QStringLiteral("/folder");
+        _subPath = folderPath + QStringLiteral("/sub");
+        for (const auto &name : {QStringLiteral("a.txt"), QStringLiteral("b.txt")}) {
+            QFile file(_subPath + QLatin1Char('/') + name);
+            QVERIFY(file.open(QFile::WriteOnly));
+        }
+
+        auto account = Account::create();
+        account->setCredentials(new HttpCredentialsTest("testuser", "secret"));
+        account->setUrl(QUrl("http://example.de"));
+        _accountState = AccountStatePtr(new AccountState(account));
+        _folder = _fm->addFolder(_accountState.data(), folderDefinition(folderPath));
+        QVERIFY(_folder);
+
+        // a.txt is about to be synced, b.txt is new and not known yet
+        _folder->syncEngine().syncFileStatusTracker().slotPathTouched(_subPath + QStringLiteral("/a.txt"));
+    }
+
+    void cleanupTestCase()
+    {
+        _fm.reset();
+    }
+
+    void testRetrieveFileStatuses()
+    {
+        QLocalSocket socket;
+        connectClient(socket);
+
+        const auto outside = _dir.path() + QStringLiteral("/outside.txt");
+        const QStringList files{_subPath + QStringLiteral("/a.txt"), _subPath + QStringLiteral("/b.txt"), outside};
+        socket.write(QStringLiteral("RETRIEVE_FILE_STATUSES:%1\n").arg(files.join(recordSeparator)).toUtf8());
+
+        const QStringList expected{
+            QStringLiteral("RETRIEVE_FILE_STATUSES:BEGIN"),
+            statusLine(QStringLiteral("SYNC"), files.at(0)),
+            statusLine(QStringLiteral("NOP"), files.at(1)),
+            statusLine(QStringLiteral("NOP"), outside),
+            QStringLiteral("RETRIEVE_FILE_STATUSES:END"),
+        };
+        QCOMPARE(readUntil(socket, expected.last()), expected);
+    }
+
+    void testRetrieveDirectoryStatus()
+    {
+        QLocalSocket socket;
+        connectClient(socket);
+
+        socket.write(QStringLiteral("RETRIEVE_DIRECTORY_STATUS:%1\n").arg(_subPath).toUtf8());
+        const QStringList expected{
+            QStringLiteral("RETRIEVE_DIRECTORY_STATUS:BEGIN"),
+            statusLine(QStringLiteral("SYNC"), _subPath + QStringLiteral("/a.txt")),
+            statusLine(QStringLiteral("NOP"), _subPath + QStringLiteral("/b.txt")),
+            QStringLiteral("RETRIEVE_DIRECTORY_STATUS:END"),
+        };
+        QCOMPARE(readUntil(socket, expected.last()), expected);
+
+        // Outside of any sync folder the reply is empty
+        socket.write(QStringLiteral("RETRIEVE_DIRECTORY_STATUS:%1\n").arg(_dir.path()).toUtf8());
+        const QStringList empty{QStringLiteral("RETRIEVE_DIRECTORY_STATUS:BEGIN"), QStringLiteral("RETRIEVE_DIRECTORY_STATUS:END")};
+        QCOMPARE(readUntil(socket, empty.last()), empty);
+    }
+
+    void testStatusPushesAreCoalesced()
+    {
+        QLocalSocket socket;
+        connectClient(socket);
+        monitorSubDirectory(socket);
+
+        const auto a = _subPath + QStringLiteral("/a.txt");
+        const auto b = _subPath + QStringLiteral("/b.txt");
+        socketApi()->broadcastStatusPushMessage(a, SyncFileStatus::StatusSync);
+        socketApi()->broadcastStatusPushMessage(b, SyncFileStatus::StatusSync);
+        socketApi()->broadcastStatusPushMessage(a, SyncFileStatus::StatusUpToDate);
+        QVERIFY(socketApi()->_statusPushTimer.isActive());
+        QCOMPARE(socketApi()->_pendingStatusPushes.size(), 2);
+
+        // Only the latest status of a path gets sent, in the order of the last change
+        const QStringList expected{statusLine(QStringLiteral("SYNC"), b), statusLine(QStringLiteral("OK"), a)};
+        QCOMPARE(readUntil(socket, expected.last()), expected);
+        QVERIFY(socketApi()->_pendingStatusPushes.isEmpty());
+    }
+
+    void testBroadcastFlushesPendingPushes()
+    {
+        QLocalSocket socket;
+        connectClient(socket);
+        monitorSubDirectory(socket);
+
+        const auto a = _subPath + QStringLiteral("/a.txt");
+        socketApi()->broadcastStatusPushMessage(a, SyncFileStatus::StatusSync);
+        QVERIFY(socketApi()->_statusPushTimer.isActive());
+
+        const auto updateView = QStringLiteral("UPDATE_VIEW:%1").arg(QDir::toNativeSeparators(_subPath));
+        socketApi()->broadcastMessage(updateView);
+        QVERIFY(!socketApi()->_statusPushTimer.isActive());
+        QVERIFY(socketApi()->_pendingStatusPushes.isEmpty());
+
+        const QStringList expected{statusLine(QStringLiteral("SYNC"), a), updateView};
+        QCOMPARE(readUntil(socket, expected.last()), expected);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSocketApi)
+#include "testsocketapi.moc"
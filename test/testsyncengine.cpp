@@ -1196,6 +1196,33 @@ private slots:
         QCOMPARE(nPOST, 0);
     }
 
+    void testBulkUploadBatchesAreLimitedByBytes()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ {"bulkupload", "1.0"} } } });
+
+        int nPUT = 0;
+        int nPOST = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PostOperation) {
+                ++nPOST;
+            } else if (op == QNetworkAccessManager::PutOperation) {
+                ++nPUT;
+            }
+            return nullptr;
+        });
+
+        // Far less than 100 files, but more than the bytes of the first batch
+        for (auto i = 0; i < 30; ++i) {
+            fakeFolder.localModifier().insert(QStringLiteral("A/medium%1").arg(i), 4 * 1000 * 1000);
+        }
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 0);
+        QCOMPARE(nPOST, 2);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void testRemoteMoveFailedInsufficientStorageLocalMoveRolledBack()
     {
         FakeFolder fakeFolder{FileInfo{}};
@@ -7,6 +7,7 @@
 #include <QtTest>
 
 #include "syncfileitem.h"
+#include "common/syncjournalfilerecord.h"
 #include "logger.h"
 
 using namespace OCC;
@@ -69,6 +70,57 @@ private slots:
         QVERIFY(!(b < b));
         QVERIFY(!(c < c));
     }
+
+    void testExtras()
+    {
+        SyncFileItem item;
+        QVERIFY(item.lockOwnerId().isEmpty());
+        QCOMPARE(item.lockOwnerType(), SyncFileItem::LockOwnerType::UserLock);
+        QCOMPARE(item.lockTime(), qint64(0));
+
+        // Default values don't need the side struct and read back the same
+        item.setLockToken({});
+        item.setLockTimeout(0);
+        QVERIFY(item.lockToken().isEmpty());
+        QCOMPARE(item.lockTimeout(), qint64(0));
+        QVERIFY(!item.hasExtras());
+
+        // The side struct goes away again once all of its fields are back to their defaults
+        item.setDiscoveryResult(QStringLiteral("discovered"));
+        item.setLockTime(5);
+        QVERIFY(item.hasExtras());
+        item.setDiscoveryResult({});
+        QVERIFY(item.hasExtras());
+        item.setLockTime(0);
+        QVERIFY(!item.hasExtras());
+        QVERIFY(item.discoveryResult().isEmpty());
+
+        item.setLockOwnerId(QStringLiteral("alice"));
+        item.setLockOwnerType(SyncFileItem::LockOwnerType::TokenLock);
+        item.setLockTime(1234);
+        QCOMPARE(item.lockOwnerId(), QStringLiteral("alice"));
+        QCOMPARE(item.lockOwnerType(), SyncFileItem::LockOwnerType::TokenLock);
+        QCOMPARE(item.lockTime(), qint64(1234));
+
+        // Copies don't share changes
+        auto copy = item;
+        copy.setLockOwnerId(QStringLiteral("bob"));
+        copy.setDirectDownloadUrl(QStringLiteral("https://example.com/file"));
+        QCOMPARE(item.lockOwnerId(), QStringLiteral("alice"));
+        QVERIFY(item.directDownloadUrl().isEmpty());
+        QCOMPARE(copy.lockOwnerId(), QStringLiteral("bob"));
+        QCOMPARE(copy.lockTime(), qint64(1234));
+
+        SyncJournalFileRecord record;
+        record._path = "file";
+        record._lockstate._locked = true;
+        record._lockstate._lockOwnerId = QStringLiteral("carol");
+        record._lockstate._lockToken = QStringLiteral("token");
+        const auto fromRecord = SyncFileItem::fromSyncJournalFileRecord(record);
+        QCOMPARE(fromRecord->lockOwnerId(), QStringLiteral("carol"));
+        QCOMPARE(fromRecord->lockToken(), QStringLiteral("token"));
+        QVERIFY(fromRecord->lockEditorApp().isEmpty());
+    }
 };
 
 QTEST_APPLESS_MAIN(TestSyncFileItem)
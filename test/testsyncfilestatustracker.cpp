@@ -31,6 +31,16 @@ public:
         return {};
     }
 
+    [[nodiscard]] int pushCount(const QString &relativePath) const {
+        QFileInfo file(_syncEngine.localPath(), relativePath);
+        int count = 0;
+        for (int i = 0; i < size(); ++i) {
+            if (QFileInfo(at(i)[0].toString()) == file)
+                ++count;
+        }
+        return count;
+    }
+
     [[nodiscard]] bool statusEmittedBefore(const QString &firstPath, const QString &secondPath) const {
         QFileInfo firstFile(_syncEngine.localPath(), firstPath);
         QFileInfo secondFile(_syncEngine.localPath(), secondPath);
@@ -415,6 +425,32 @@ private slots:
         QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A/a"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
     }
 
+    void parentsPushedOnceForManyErrors() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        const int errorCount = 10;
+        for (int i = 0; i < errorCount; ++i) {
+            const auto path = QStringLiteral("A/e%1").arg(i);
+            fakeFolder.localModifier().insert(path);
+            fakeFolder.serverErrorPaths().append(path);
+        }
+        fakeFolder.syncOnce();
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A"), SyncFileStatus(SyncFileStatus::StatusWarning));
+
+        // The errors are blacklisted now and all show up before the propagation at once
+        StatusPushSpy statusSpy(fakeFolder.syncEngine());
+        fakeFolder.scheduleSync();
+        fakeFolder.execUntilBeforePropagation();
+        verifyThatPushMatchesPull(fakeFolder, statusSpy);
+        QCOMPARE(statusSpy.statusOf("A/e0"), SyncFileStatus(SyncFileStatus::StatusError));
+        QCOMPARE(statusSpy.statusOf("A"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(statusSpy.statusOf(""), SyncFileStatus(SyncFileStatus::StatusWarning));
+        // At most once for the directory item itself and once for the errors below it
+        QVERIFY(statusSpy.pushCount("A") <= 2);
+        QVERIFY(statusSpy.pushCount("") <= 2);
+        QVERIFY(statusSpy.statusEmittedBefore("A", ""));
+        fakeFolder.execUntilFinished();
+    }
+
     // Even for status pushes immediately following each other, macOS
     // can sometimes have 1s delays between updates, so make sure that
     // children are marked as OK before their parents do.
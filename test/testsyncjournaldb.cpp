@@ -161,6 +161,9 @@ private slots:
         record._transferid = 812974891;
         record._size = 12894789147;
         record._modtime = dropMsecs(QDateTime::currentDateTime());
+        record._e2eEncryptionKey = QByteArray(16, '\x01');
+        record._e2eInitializationVector = QByteArray(16, '\0');
+        record._e2eEncryptedFileName = "8a2ee59a0d7e4b1d9c5b4b3f1d0c6a2e";
         record._valid = true;
         _db.setUploadInfo("foo", record);
 
@@ -324,6 +327,92 @@ private slots:
         QVERIFY(checkElements());
     }
 
+    void testBatchedFileRecordLookup()
+    {
+        // More records than fit into one batch, so the short last batch is exercised too
+        QVector<quint64> inodes;
+        QVector<QByteArray> fileIds;
+        for (int i = 0; i < 150; ++i) {
+            SyncJournalFileRecord record;
+            record._path = "batch/file" + QByteArray::number(i);
+            record._inode = 5000 + i;
+            record._fileId = "batchid" + QByteArray::number(i);
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            QVERIFY(_db.setFileRecord(record));
+            if (i % 2 == 0) {
+                inodes.append(record._inode);
+            } else {
+                fileIds.append(record._fileId);
+            }
+        }
+        // unknown keys and keys that are skipped
+        inodes << 4999 << 0;
+        fileIds << "batchidunknown" << QByteArray();
+
+        QSet<QByteArray> found;
+        QVERIFY(_db.getFileRecordsByInodes(inodes, [&](const SyncJournalFileRecord &rec) {
+            QVERIFY(rec.isValid());
+            found.insert(rec._path);
+        }));
+        QCOMPARE(found.size(), 75);
+        QVERIFY(found.contains("batch/file0"));
+        QVERIFY(found.contains("batch/file148"));
+
+        found.clear();
+        QVERIFY(_db.getFileRecordsByFileIds(fileIds, [&](const SyncJournalFileRecord &rec) {
+            QCOMPARE(rec._fileId, QByteArray("batchid" + rec._path.mid(10)));
+            found.insert(rec._path);
+        }));
+        QCOMPARE(found.size(), 75);
+        QVERIFY(found.contains("batch/file1"));
+        QVERIFY(found.contains("batch/file149"));
+
+        QVERIFY(_db.getFileRecordsByInodes({}, [&](const SyncJournalFileRecord &) { QFAIL("no records expected"); }));
+
+        QVERIFY(_db.deleteFileRecord("batch", true));
+    }
+
+    void testGroupCommit()
+    {
+        // Counts the records another connection can see, i.e. the committed ones
+        const auto committedRecords = [this] {
+            SqlDatabase db;
+            if (!db.openReadOnly(_db.databaseFilePath())) {
+                return -1;
+            }
+            SqlQuery query(db);
+            query.prepare("SELECT COUNT(*) FROM metadata WHERE path LIKE 'group/%'");
+            if (!query.exec() || !query.next().hasData) {
+                return -1;
+            }
+            return query.intValue(0);
+        };
+        const auto addRecords = [this](int first, int count) {
+            for (int i = first; i < first + count; ++i) {
+                SyncJournalFileRecord record;
+                record._path = QByteArray("group/file") + QByteArray::number(i);
+                record._type = ItemTypeFile;
+                QVERIFY(_db.setFileRecord(record));
+                _db.commit(QStringLiteral("item"));
+            }
+        };
+
+        _db.commit(QStringLiteral("before group commit"));
+        _db.setGroupCommit(true);
+
+        addRecords(0, 10);
+        QCOMPARE(committedRecords(), 0);
+        // The latency bound commits them without further requests
+        QTRY_COMPARE(committedRecords(), 10);
+
+        addRecords(10, 10);
+        _db.setGroupCommit(false);
+        QCOMPARE(committedRecords(), 20);
+
+        QVERIFY(_db.deleteFileRecord("group", true));
+        _db.commit(QStringLiteral("after group commit"));
+    }
+
     void testPinState()
     {
         auto make = [&](const QByteArray &path, PinState state) {
@@ -426,6 +515,23 @@ private slots:
         QCOMPARE(getRecursive("local/local/local"), PinState::AlwaysLocal);
         QCOMPARE(getRecursive("local/local/local/local"), PinState::AlwaysLocal);
 
+        // Direct children, as used when listing a directory
+        auto children = _db.internalPinStates().rawForChildren("");
+        QVERIFY(children);
+        QCOMPARE(children->size(), 2);
+        QCOMPARE(children->value("local"), PinState::AlwaysLocal);
+        QCOMPARE(children->value("online"), PinState::OnlineOnly);
+        children = _db.internalPinStates().rawForChildren("inherit/online");
+        QVERIFY(children);
+        QCOMPARE(children->size(), 2);
+        QCOMPARE(children->value("local"), PinState::AlwaysLocal);
+        QCOMPARE(children->value("online"), PinState::OnlineOnly);
+        QVERIFY(!children->contains("inherit"));
+        children = _db.internalPinStates().rawForChildren("local/local/local");
+        QVERIFY(children);
+        QCOMPARE(children->size(), 1);
+        QCOMPARE(children->value("local"), PinState::AlwaysLocal);
+
         // Check changing the root pin state
         make("", PinState::OnlineOnly);
         QCOMPARE(get("local"), PinState::AlwaysLocal);
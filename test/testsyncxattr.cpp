@@ -10,6 +10,9 @@
 #include "common/vfs.h"
 #include "config.h"
 #include <syncengine.h>
+#include "configfile.h"
+
+#include <sys/stat.h>
 
 #include "vfs/xattr/xattrwrapper.h"
 
@@ -91,7 +94,14 @@ class TestSyncXAttr : public QObject
 {
     Q_OBJECT
 
+    QTemporaryDir _configDir;
+
 private slots:
+    void initTestCase()
+    {
+        ConfigFile::setConfDir(_configDir.path()); // we don't want to pollute the user's config file
+    }
+
     void testVirtualFileLifecycle_data()
     {
         QTest::addColumn<bool>("doLocalDiscovery");
@@ -325,6 +335,51 @@ private slots:
         cleanup();
     }
 
+    void testSparsePlaceholders()
+    {
+        ConfigFile().setXattrVfsSparsePlaceholders(true);
+
+        FakeFolder fakeFolder{ FileInfo() };
+        setupVfs(fakeFolder);
+        ConfigFile().setXattrVfsSparsePlaceholders(false);
+
+        const auto localInfo = [&](const QString &path) {
+            struct stat buf {};
+            [[maybe_unused]] const auto result = stat(QFile::encodeName(fakeFolder.localPath() + path).constData(), &buf);
+            return buf;
+        };
+
+        // Placeholders report the remote size without using any disk space
+        fakeFolder.remoteModifier().mkdir("A");
+        fakeFolder.remoteModifier().insert("A/a1", 1024 * 1024);
+        auto someDate = QDateTime(QDate(1984, 07, 30), QTime(1,3,2));
+        fakeFolder.remoteModifier().setModTime("A/a1", someDate);
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(xattr::hasNextcloudPlaceholderAttributes(fakeFolder.localPath() + "A/a1"));
+        QCOMPARE(dbRecord(fakeFolder, "A/a1")._type, ItemTypeVirtualFile);
+        QCOMPARE(qint64(localInfo("A/a1").st_size), qint64(1024 * 1024));
+        QVERIFY(qint64(localInfo("A/a1").st_blocks) * 512 < qint64(localInfo("A/a1").st_size));
+        QCOMPARE(QFileInfo(fakeFolder.localPath() + "A/a1").lastModified(), someDate);
+
+        // Another sync keeps the placeholder
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(dbRecord(fakeFolder, "A/a1")._type, ItemTypeVirtualFile);
+
+        // A remote change updates the size
+        fakeFolder.remoteModifier().appendByte("A/a1");
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(xattr::hasNextcloudPlaceholderAttributes(fakeFolder.localPath() + "A/a1"));
+        QCOMPARE(dbRecord(fakeFolder, "A/a1")._type, ItemTypeVirtualFile);
+        QCOMPARE(qint64(localInfo("A/a1").st_size), qint64(1024 * 1024 + 1));
+        QVERIFY(qint64(localInfo("A/a1").st_blocks) * 512 < qint64(localInfo("A/a1").st_size));
+
+        // Hydration replaces it with the real content
+        triggerDownload(fakeFolder, "A/a1");
+        QVERIFY(fakeFolder.syncOnce());
+        XAVERIFY_NONVIRTUAL(fakeFolder, "A/a1");
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void testVirtualFileDownload()
     {
         FakeFolder fakeFolder{ FileInfo() };
@@ -132,6 +132,103 @@ private slots:
         QVERIFY(_subdirs.size() == 1);
     }
 
+    void testParserIncremental() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/oc/remote.php/dav/sharefolder/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004213ocobzus5kn6s</oc:id>"
+              "<oc:size>121780</oc:size>"
+              "<d:resourcetype>"
+              "<d:collection/>"
+              "</d:resourcetype>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/oc/remote.php/dav/sharefolder/quitte%20&amp;%20fini.pdf</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004215ocobzus5kn6s</oc:id>"
+              "<d:resourcetype/>"
+              "<d:getcontentlength>121780</d:getcontentlength>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "</d:multistatus>";
+
+        LsColXMLParser parser;
+
+        connect( &parser, &LsColXMLParser::directoryListingSubfolders,
+                 this, &TestXmlParse::slotDirectoryListingSubFolders );
+        connect( &parser, &LsColXMLParser::finishedWithoutError,
+                 this, &TestXmlParse::slotFinishedSuccessfully );
+
+        QMap<QString, QString> lastProperties;
+        connect(&parser, &LsColXMLParser::directoryListingIterated, this, [&](const QString &item, const QMap<QString, QString> &properties) {
+            _items.append(item);
+            lastProperties = properties;
+        });
+
+        QHash <QString, ExtraFolderInfo> sizes;
+        parser.beginParse(&sizes, "/oc/remote.php/dav/sharefolder");
+
+        // Feed the body in tiny chunks, as a slow network would deliver it
+        const auto firstResponseEnd = testXml.indexOf("</d:response>") + qstrlen("</d:response>");
+        for (int i = 0; i < testXml.size(); i += 7) {
+            QVERIFY(parser.addData(testXml.mid(i, 7)));
+            if (i + 7 < firstResponseEnd) {
+                QVERIFY(_items.isEmpty());
+            }
+            if (i >= firstResponseEnd) {
+                // entries are reported before the body is complete
+                QVERIFY(!_items.isEmpty());
+            }
+        }
+        QVERIFY(!_success);
+        QVERIFY(parser.endParse());
+        QVERIFY(_success);
+
+        QCOMPARE(_items, QStringList({"/oc/remote.php/dav/sharefolder", "/oc/remote.php/dav/sharefolder/quitte & fini.pdf"}));
+        QCOMPARE(lastProperties.value("id"), QStringLiteral("00004215ocobzus5kn6s"));
+        QCOMPARE(lastProperties.value("resourcetype"), QString());
+        QCOMPARE(lastProperties.value("getcontentlength"), QStringLiteral("121780"));
+        QCOMPARE(sizes.value("/oc/remote.php/dav/sharefolder/").size, qint64(121780));
+        QCOMPARE(_subdirs, QStringList{"/oc/remote.php/dav/sharefolder/"});
+    }
+
+    void testParserIncrementalTruncated() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/oc/remote.php/dav/sharefolder/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004213ocobzus5kn6s</oc:id>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"; // no proper end here
+
+        LsColXMLParser parser;
+
+        connect( &parser, &LsColXMLParser::directoryListingIterated,
+                 this, &TestXmlParse::slotDirectoryListingIterated );
+        connect( &parser, &LsColXMLParser::finishedWithoutError,
+                 this, &TestXmlParse::slotFinishedSuccessfully );
+
+        QHash <QString, ExtraFolderInfo> sizes;
+        parser.beginParse(&sizes, "/oc/remote.php/dav/sharefolder");
+        QVERIFY(parser.addData(testXml));
+        QCOMPARE(_items.size(), 1);
+        QVERIFY(!parser.endParse());
+        QVERIFY(!_success);
+    }
+
     void testParserBrokenXml() {
         const QByteArray testXml = "X<?xml version='1.0' encoding='utf-8'?>"
               "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"